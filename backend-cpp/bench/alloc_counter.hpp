@@ -0,0 +1,7 @@
+#pragma once
+#include <cstdint>
+
+// Alocações do processo desde o início (operator new substituído em alloc_counter.cpp).
+// Os operadores ficam numa unidade de tradução própria: inlinados no bench, o compilador
+// via malloc/free no lugar do par new/delete e acusava -Wmismatched-new-delete.
+uint64_t allocation_count();
@@ -0,0 +1,87 @@
+// Microbenchmark dos codecs de mensagem (message_codec.hpp): o caminho de eco completo,
+// decode do pedido + encode da resposta + decode da resposta, em json e binary.
+// Mede bytes/s codificados e alocações por mensagem (operator new contado neste binário).
+// Uso: ra1_codec_bench [tamanho_texto=64] [mensagens=1000000]
+#include "message_codec.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+namespace {
+std::atomic<uint64_t> g_allocs{ 0 };
+}
+
+void* operator new(std::size_t n) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+void run(CodecKind kind, const std::string& text, size_t count) {
+    MessageCodec sender(kind), echo(kind), reader(kind);
+    std::string request, reply, reply_text;
+    Message in, out;
+    size_t bytes = 0;
+    uint64_t checksum = 0;
+
+    // pedido como o send() produz: json = texto cru embrulhado em {"text":...}; binary = esquema
+    Message req;
+    req.text = text;
+    sender.encode(req, request);
+
+    auto one = [&](size_t i) {
+        if (!echo.decode(request, in)) return;
+        reply_text.assign("ECHO: ").append(in.text);
+        Message resp;
+        resp.event = "received";
+        resp.mechanism = "shm";
+        resp.from = "shm_server";
+        resp.text = reply_text;
+        resp.message_number = static_cast<int64_t>(i + 1);
+        resp.ts = 1700000000 + static_cast<int64_t>(i);
+        reply.clear();
+        echo.encode(resp, reply);
+        if (reader.decode(reply, out)) checksum += out.text.size() + static_cast<uint64_t>(out.message_number);
+        bytes += request.size() + reply.size();
+    };
+
+    for (size_t i = 0; i < count / 10 + 1; ++i) one(i); // aquecimento (buffers já no tamanho final)
+    bytes = 0;
+    checksum = 0;
+
+    const uint64_t a0 = g_allocs.load();
+    const auto t0 = Clock::now();
+    for (size_t i = 0; i < count; ++i) one(i);
+    const double s = std::chrono::duration<double>(Clock::now() - t0).count();
+    const uint64_t allocs = g_allocs.load() - a0;
+
+    std::printf("{\"codec\":\"%s\",\"messages\":%zu,\"request_bytes\":%zu,\"reply_bytes\":%zu,\"seconds\":%.6f,"
+                "\"mb_s\":%.3f,\"kmsg_s\":%.3f,\"allocs_per_msg\":%.3f,\"checksum\":%llu}\n",
+                codec_name(kind), count, request.size(), reply.size(), s, bytes / s / 1e6, count / s / 1e3,
+                static_cast<double>(allocs) / count, static_cast<unsigned long long>(checksum));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t text_len = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 64;
+    const size_t count = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000000;
+    if (count == 0) {
+        std::fprintf(stderr, "uso: %s [tamanho_texto] [mensagens>0]\n", argv[0]);
+        return 2;
+    }
+
+    const std::string text(text_len, 'm');
+    run(CodecKind::json, text, count);
+    run(CodecKind::binary, text, count);
+    return 0;
+}
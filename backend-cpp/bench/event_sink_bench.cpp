@@ -0,0 +1,89 @@
+// Microbenchmark da saída de eventos (event_sink.hpp): N threads emitindo eventos
+// "received" do tamanho típico, comparando
+//   endl  std::cout << linha << std::endl (um flush por evento, como era nos módulos; aqui
+//         sob um mutex, sem o qual o cout dessincronizado mistura linhas entre threads)
+//   sink  EventSink::emit (fila MPSC + escritas em lote pela thread escritora)
+// Os eventos vão para o stdout: redirecione para /dev/null ou um pipe (| cat > /dev/null).
+// Resultados saem no stderr. Uso: ra1_event_sink_bench [eventos=1000000] [threads=4]
+#include "event_sink.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::string sample_event(size_t i) {
+    nlohmann::json j;
+    j["event"] = "received";
+    j["mechanism"] = "pipe";
+    j["from"] = "child";
+    j["text"] = "ECHO: m" + std::to_string(i);
+    j["message_number"] = i;
+    j["id"] = i;
+    j["rtt_us"] = 42;
+    return j.dump();
+}
+
+// Linhas já serializadas (o custo do dump é o mesmo nos dois modos; aqui só conta a saída)
+const std::vector<std::string>& sample_lines() {
+    static const std::vector<std::string> lines = [] {
+        std::vector<std::string> v;
+        for (size_t i = 0; i < 1024; ++i) v.push_back(sample_event(i));
+        return v;
+    }();
+    return lines;
+}
+
+template <class Emit>
+double run(size_t events, size_t threads, Emit emit) {
+    const auto& lines = sample_lines();
+    const auto t0 = Clock::now();
+    std::vector<std::thread> ts;
+    for (size_t t = 0; t < threads; ++t) {
+        ts.emplace_back([&, t] {
+            for (size_t i = t; i < events; i += threads) emit(std::string(lines[i % lines.size()]));
+        });
+    }
+    for (auto& th : ts) th.join();
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+void report(const char* mode, size_t events, size_t threads, double s, uint64_t writes) {
+    std::fprintf(stderr, "{\"mode\":\"%s\",\"events\":%zu,\"threads\":%zu,\"seconds\":%.6f,\"kevents_s\":%.1f,\"writes\":%llu}\n",
+                 mode, events, threads, s, events / s / 1e3, static_cast<unsigned long long>(writes));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t events = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    const size_t threads = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 4;
+    if (events == 0 || threads == 0) {
+        std::fprintf(stderr, "uso: %s [eventos>0] [threads>0] > /dev/null\n", argv[0]);
+        return 2;
+    }
+
+    std::ios_base::sync_with_stdio(false); // como no main do backend
+    std::mutex cout_mtx;
+    const double endl_s = run(events, threads, [&](const std::string& line) {
+        std::lock_guard<std::mutex> lk(cout_mtx);
+        std::cout << line << std::endl;
+    });
+    report("endl", events, threads, endl_s, events); // um flush (write) por evento
+
+    EventSink& sink = EventSink::instance();
+    // inclui o tempo até a fila chegar inteira ao stdout
+    const auto t0 = Clock::now();
+    run(events, threads, [&](std::string line) { sink.emit(std::move(line), true); });
+    sink.flush(60000);
+    const double sink_s = std::chrono::duration<double>(Clock::now() - t0).count();
+    report("sink", events, threads, sink_s, sink.stats().value("writes", uint64_t(0)));
+    return 0;
+}
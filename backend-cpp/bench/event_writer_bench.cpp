@@ -0,0 +1,138 @@
+// Serialização dos eventos por mensagem (event_writer.hpp) contra o caminho antigo
+// (nlohmann::json montado campo a campo + dump()):
+//   compat  a saída do EventWriter é idêntica à do dump() para os mesmos campos, com
+//           textos que passam por todo o escape (controle, aspas, UTF-8 de 1 a 4 bytes)
+//   allocs  alocações por evento em regime (operator new contado), incluindo o
+//           EventSink::emit; o EventWriter deve dar 0
+//   ns      custo por evento só da serialização
+// Os eventos vão para o stdout: redirecione para /dev/null ou um pipe (| cat > /dev/null).
+// Resultados saem no stderr. Uso: ra1_event_writer_bench [eventos=200000]
+// Também roda no ctest (event_writer_allocs): falha com diferença no compat ou alocação
+// no writer / writer+emit.
+#include "alloc_counter.hpp"
+#include "event_writer.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Evento "sent" do PipeModule, nos dois caminhos
+nlohmann::json sent_json(const std::string& text, uint64_t id, int worker) {
+    nlohmann::json j;
+    j["event"] = "sent";
+    j["ts"] = "2026-01-01T00:00:00.000000Z";
+    j["pid"] = 4242;
+    j["mechanism"] = "pipe";
+    j["text"] = text;
+    j["bytes"] = text.size() + 8;
+    j["message_number"] = static_cast<int>(id);
+    j["worker"] = worker;
+    j["id"] = id;
+    j["sent_ns"] = id * 1000 + 7;
+    return j;
+}
+
+EventWriter& sent_writer(EventWriter&& w, const std::string& text, uint64_t id, int worker) {
+    return w.field("bytes", text.size() + 8)
+        .field("event", "sent")
+        .field("id", id)
+        .field("mechanism", "pipe")
+        .field("message_number", static_cast<int>(id))
+        .field("pid", 4242)
+        .field("sent_ns", id * 1000 + 7)
+        .field("text", text)
+        .field("ts", "2026-01-01T00:00:00.000000Z")
+        .field("worker", worker);
+}
+
+std::vector<std::string> sample_texts() {
+    std::vector<std::string> v = { "m1", "ECHO: hello", "", "aspas \" e \\ barra", "tab\tlinha\nfim\r",
+                                   "acentuação ção ü €", "emoji \xF0\x9F\x98\x80 4 bytes", std::string(300, 'x') };
+    std::string ctl;
+    for (int c = 0; c < 0x80; ++c) ctl += static_cast<char>(c);
+    v.push_back(ctl);
+    return v;
+}
+
+int check_compat() {
+    int bad = 0;
+    uint64_t id = 1;
+    for (const auto& t : sample_texts()) {
+        const std::string a = sent_json(t, id, 2).dump();
+        const std::string b(sent_writer(EventWriter(), t, id, 2).finish());
+        if (a != b) {
+            ++bad;
+            std::fprintf(stderr, "DIFF\n  dump:   %s\n  writer: %s\n", a.c_str(), b.c_str());
+        }
+        ++id;
+    }
+    // UTF-8 inválido: o dump() estrito lança; o writer troca por U+FFFD (como o modo replace)
+    const std::string invalid = "ok \xC3 fim \xED\xA0\x80 \xF0\x9F\x98";
+    const std::string a = nlohmann::json(invalid).dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+    std::string b;
+    EventWriter::append_json_string(b, invalid);
+    std::fprintf(stderr, "{\"compat_cases\":%zu,\"compat_diffs\":%d,\"invalid_utf8_same_as_replace\":%s}\n",
+                 sample_texts().size(), bad, a == b ? "true" : "false");
+    return bad + (a == b ? 0 : 1);
+}
+
+// Devolve as alocações da volta: no writer e no writer+emit precisam ser 0
+uint64_t report(const char* mode, size_t events, double s, uint64_t allocs) {
+    std::fprintf(stderr, "{\"mode\":\"%s\",\"events\":%zu,\"ns_event\":%.1f,\"allocs_event\":%.3f}\n",
+                 mode, events, s * 1e9 / events, static_cast<double>(allocs) / events);
+    return allocs;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t events = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    if (events == 0) {
+        std::fprintf(stderr, "uso: %s [eventos>0] > /dev/null\n", argv[0]);
+        return 2;
+    }
+    const int bad = check_compat();
+
+    const std::string text = "ECHO: mensagem de tamanho típico";
+    size_t sink = 0;
+
+    // Só serialização
+    uint64_t a0 = allocation_count();
+    auto t0 = Clock::now();
+    for (size_t i = 0; i < events; ++i) sink += sent_json(text, i, 1).dump().size();
+    report("json_dump", events, std::chrono::duration<double>(Clock::now() - t0).count(), allocation_count() - a0);
+
+    a0 = allocation_count();
+    t0 = Clock::now();
+    for (size_t i = 0; i < events; ++i) sink += sent_writer(EventWriter(), text, i, 1).finish().size();
+    uint64_t writer_allocs = report("writer", events, std::chrono::duration<double>(Clock::now() - t0).count(), allocation_count() - a0);
+
+    // Caminho completo até o stdout. Aquecimento: uma volta inteira no anel do EventSink
+    // para cada slot já ter a capacidade de uma linha
+    EventSink& out = EventSink::instance();
+    for (size_t i = 0; i < 2 * EventSink::SINK_SLOTS; ++i) sent_writer(EventWriter(), text, i, 1).emit(true);
+    out.flush(60000);
+
+    a0 = allocation_count();
+    t0 = Clock::now();
+    for (size_t i = 0; i < events; ++i) out.emit(sent_json(text, i, 1).dump(), true);
+    out.flush(60000);
+    report("json_dump+emit", events, std::chrono::duration<double>(Clock::now() - t0).count(), allocation_count() - a0);
+
+    for (size_t i = 0; i < 2 * EventSink::SINK_SLOTS; ++i) sent_writer(EventWriter(), text, i, 1).emit(true);
+    out.flush(60000);
+    a0 = allocation_count();
+    t0 = Clock::now();
+    for (size_t i = 0; i < events; ++i) sent_writer(EventWriter(), text, i, 1).emit(true);
+    out.flush(60000);
+    writer_allocs += report("writer+emit", events, std::chrono::duration<double>(Clock::now() - t0).count(), allocation_count() - a0);
+
+    if (writer_allocs > 0) std::fprintf(stderr, "FALHOU: o EventWriter alocou %llu vezes em regime\n",
+                                        static_cast<unsigned long long>(writer_allocs));
+    return bad == 0 && writer_allocs == 0 && sink > 0 ? 0 : 1;
+}
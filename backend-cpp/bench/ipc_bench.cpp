@@ -0,0 +1,423 @@
+// Benchmark nativo dos transportes: liga os módulos (PipeModule, SocketModule,
+// SharedMemoryModule) direto, sem o frontend Python, o stdin JSON e a fila de eventos
+// do tests/bench.py no meio. Por mecanismo:
+//   pingpong  uma mensagem por vez: envia e espera o eco (latência)
+//   stream    envios seguidos com até --inflight pedidos sem eco (vazão sob carga)
+// O RTT de cada mensagem vem da InflightWindow do módulo (mono_ns no envio e na chegada
+// do eco, na thread leitora), em ns. Os eventos sent/received continuam saindo no stdout
+// como no backend: redirecione para /dev/null ou um pipe.
+//
+//   sweep     stream em cada célula da grade tamanho x pedidos em voo x produtores, para
+//             achar onde cada mecanismo satura; por célula também o tempo de CPU
+//             (processo + filhos) e as trocas de contexto
+//
+// Saída: uma linha JSON por resultado no stderr e CSV com as colunas do tests/plot.py
+// (mechanism, n, lat_avg_ms, lat_p95_ms, throughput_msg_s) + detalhes em us:
+//   <out>.csv (pingpong), <out>_stream.csv (stream) e <out>_sweep.csv (sweep)
+//
+// Uso: ra1_ipc_bench [--mech pipe,socket,socket_unix,shm] [--mode pingpong|stream|both|sweep]
+//                    [--warmup 1000] [--iters 10000 | --duration s] [--size 64]
+//                    [--inflight 64] [--cpu N] [--opts '{"codec":"binary",...}'] [--out native]
+//                    [--sizes 16,...,16777216] [--depths 1,4,16,64,256] [--producers 1,2,4]
+//                    [--max-inflight-mb 256]
+//   --cpu fixa a thread que envia; as threads do módulo se fixam pelas opções dele
+//   (shm: reader_cpu/child_cpu). --opts vai para o start() de todos os mecanismos.
+//   No sweep cada célula roda --duration s (padrão 0,5) num start() novo do mecanismo, com
+//   aquecimento limitado a ~64 MB; células com tamanho x janela acima de --max-inflight-mb
+//   (padrão 256) são puladas, já que cada byte em voo existe em várias cópias.
+//   O send() dos módulos é de um produtor só (o IPCManager chama da thread de comandos):
+//   os produtores concorrentes passam por um mutex, como um frontend com várias threads
+//   teria de fazer. CPU de filhos (pipe, shm process) é a da vida inteira do filho e só
+//   existe fora do Windows, assim como as trocas de contexto.
+#include "ipc_manager.hpp"
+#include "log.hpp"
+#include "shm_platform.hpp"
+#include "timestamp.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+using json = nlohmann::json;
+
+// Interface mínima comum aos três módulos
+struct Transport {
+    virtual ~Transport() = default;
+    virtual bool start(const json& opts) = 0;
+    virtual bool send(const std::string& message) = 0;
+    virtual void stop() = 0;
+    virtual InflightWindow& inflight() = 0;
+};
+
+template <class Module>
+struct ModuleTransport : Transport {
+    Module m{ nullptr };
+    bool start(const json& opts) override { return m.start(opts); }
+    bool send(const std::string& message) override {
+        if constexpr (std::is_same_v<Module, PipeModule>) return m.send(message, std::string(), 0);
+        else return m.send(message, 0);
+    }
+    void stop() override { m.stop(); }
+    InflightWindow& inflight() override { return m.inflight(); }
+};
+
+std::unique_ptr<Transport> make_transport(const std::string& mech) {
+    if (mech == "pipe") return std::make_unique<ModuleTransport<PipeModule>>();
+    if (mech == "socket" || mech == "socket_unix") return std::make_unique<ModuleTransport<SocketModule>>();
+    if (mech == "shm") return std::make_unique<ModuleTransport<SharedMemoryModule>>();
+    return nullptr;
+}
+
+struct Options {
+    std::vector<std::string> mechs{ "pipe", "socket", "socket_unix", "shm" };
+    std::string mode = "both";
+    size_t warmup = 1000;
+    size_t iters = 10000;
+    double duration = 0; // > 0: roda por tempo em vez de iters
+    size_t size = 64;
+    size_t inflight = 64;
+    int cpu = -1;
+    json opts = json::object();
+    std::string out = "native";
+    // grade do sweep: 16 B a 16 MB (x4), janela 1 a 256, produtores 1 a N
+    std::vector<size_t> sizes{ 16, 64, 256, 1024, 4096, 16384, 65536, 262144, 1048576, 4194304, 16777216 };
+    std::vector<size_t> depths{ 1, 4, 16, 64, 256 };
+    std::vector<size_t> producers{ 1, 2, 4 };
+    size_t max_inflight_bytes = size_t(256) << 20; // células com size x depth acima disso são puladas
+};
+
+// Uma medida: pingpong (um por vez) ou stream (janela de 'inflight', 'producers' threads)
+struct Cell {
+    std::string mode;
+    size_t size = 64, inflight = 1, producers = 1;
+};
+
+// Tempo de CPU e trocas de contexto acumulados do processo ou dos filhos já colhidos
+struct Usage {
+    double cpu_s = 0;
+    uint64_t ctx_vol = 0, ctx_invol = 0;
+};
+
+Usage sample_usage(bool children) {
+    Usage u;
+#ifdef _WIN32
+    if (children) return u; // sem equivalente ao RUSAGE_CHILDREN; trocas de contexto idem
+    FILETIME created, exited, kernel, user;
+    if (GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user)) {
+        auto secs = [](const FILETIME& f) {
+            return static_cast<double>((static_cast<uint64_t>(f.dwHighDateTime) << 32) | f.dwLowDateTime) / 1e7;
+        };
+        u.cpu_s = secs(kernel) + secs(user);
+    }
+#else
+    struct rusage ru {};
+    if (getrusage(children ? RUSAGE_CHILDREN : RUSAGE_SELF, &ru) == 0) {
+        u.cpu_s = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+        u.ctx_vol = static_cast<uint64_t>(ru.ru_nvcsw);
+        u.ctx_invol = static_cast<uint64_t>(ru.ru_nivcsw);
+    }
+#endif
+    return u;
+}
+
+struct Result {
+    std::string mechanism;
+    Cell cell;
+    size_t n = 0, lost = 0;
+    double seconds = 0;
+    std::vector<uint64_t> rtt_ns; // amostras (observer da InflightWindow)
+    Usage self;                   // só o intervalo medido
+    Usage child;                  // filhos colhidos no stop() (vida inteira deles)
+};
+
+constexpr uint64_t REPLY_TIMEOUT_NS = 2'000'000'000;
+
+// Espera a janela chegar a 'target' respostas; false = prazo vencido
+bool wait_completed(InflightWindow& win, uint64_t target, uint64_t timeout_ns) {
+    const uint64_t t0 = mono_ns();
+    while (win.completed() < target) {
+        if (mono_ns() - t0 > timeout_ns) return false;
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+// O socket só ecoa depois que o cliente interno se registra como listener: tenta pings
+// até um voltar. No fim esquece os pendentes (pings sem eco não ocupam a janela).
+bool wait_ready(Transport& t, size_t limit, const std::string& payload) {
+    InflightWindow& win = t.inflight();
+    const uint64_t t0 = mono_ns();
+    while (mono_ns() - t0 < 5'000'000'000ull) {
+        const uint64_t target = win.completed() + 1;
+        if (t.send(payload) && wait_completed(win, target, 100'000'000)) {
+            win.reset(limit);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool keep_going(const Options& o, size_t i, uint64_t t0) {
+    return o.duration > 0 ? mono_ns() - t0 < static_cast<uint64_t>(o.duration * 1e9) : i < o.iters;
+}
+
+Result run(const std::string& mech, const Cell& cell, const Options& o) {
+    Result r;
+    r.mechanism = mech;
+    r.cell = cell;
+    auto t = make_transport(mech);
+    const bool stream = cell.mode == "stream";
+    const size_t limit = stream ? cell.inflight : 0;
+    const Usage child0 = sample_usage(true);
+
+    json opts = o.opts;
+    opts["inflight"] = limit;
+    if (mech == "socket_unix") opts["transport"] = "unix";
+    if (!t->start(opts)) {
+        std::fprintf(stderr, "%s: start falhou\n", mech.c_str());
+        return r;
+    }
+
+    const std::string payload(cell.size, 'x');
+    InflightWindow& win = t->inflight();
+    if (!wait_ready(*t, limit, payload)) {
+        std::fprintf(stderr, "%s: sem eco em 5 s\n", mech.c_str());
+        t->stop();
+        return r;
+    }
+
+    // Aquecimento: sempre ping-pong, fora das amostras (mensagens grandes: até ~64 MB)
+    const size_t warmup = std::min(o.warmup, std::max<size_t>(1, (size_t(64) << 20) / cell.size));
+    for (size_t i = 0; i < warmup; ++i) {
+        const uint64_t target = win.completed() + 1;
+        if (t->send(payload)) wait_completed(win, target, REPLY_TIMEOUT_NS);
+    }
+    win.reset(limit);
+
+    r.rtt_ns.reserve(o.duration > 0 ? size_t(1) << 20 : o.iters);
+    win.set_observer([&r](uint64_t rtt_ns) { r.rtt_ns.push_back(rtt_ns); });
+
+    const Usage self0 = sample_usage(false);
+    const uint64_t t0 = mono_ns();
+    size_t sent = 0;
+    if (!stream) {
+        for (size_t i = 0; keep_going(o, i, t0); ++i) {
+            const uint64_t target = win.completed() + 1;
+            if (!t->send(payload)) continue;
+            ++sent;
+            if (!wait_completed(win, target, REPLY_TIMEOUT_NS)) ++r.lost;
+        }
+    }
+    else {
+        // send() bloqueia com a janela cheia: o ritmo é o dos ecos. Com mais produtores,
+        // cada um disputa o mutex do send (a thread principal é um deles)
+        std::mutex send_mtx;
+        std::atomic<size_t> issued{ 0 }, ok{ 0 };
+        auto produce = [&] {
+            while (keep_going(o, issued.fetch_add(1, std::memory_order_relaxed), t0)) {
+                std::lock_guard<std::mutex> lk(send_mtx);
+                if (t->send(payload)) ok.fetch_add(1, std::memory_order_relaxed);
+            }
+        };
+        std::vector<std::thread> extra;
+        for (size_t p = 1; p < cell.producers; ++p) extra.emplace_back(produce);
+        produce();
+        for (auto& th : extra) th.join();
+        sent = ok.load();
+        const uint64_t drain_ns = REPLY_TIMEOUT_NS * 5 + static_cast<uint64_t>(cell.size) * cell.inflight; // ~1 ns/byte em voo
+        if (!wait_completed(win, sent, drain_ns)) r.lost = sent - win.completed();
+    }
+    r.seconds = static_cast<double>(mono_ns() - t0) / 1e9;
+    r.n = static_cast<size_t>(win.completed());
+    const Usage self1 = sample_usage(false);
+    r.self = { self1.cpu_s - self0.cpu_s, self1.ctx_vol - self0.ctx_vol, self1.ctx_invol - self0.ctx_invol };
+
+    t->stop();
+    win.set_observer(nullptr);
+    const Usage child1 = sample_usage(true);
+    r.child = { child1.cpu_s - child0.cpu_s, child1.ctx_vol - child0.ctx_vol, child1.ctx_invol - child0.ctx_invol };
+    return r;
+}
+
+double percentile(const std::vector<uint64_t>& sorted, double q) {
+    if (sorted.empty()) return 0;
+    const size_t idx = static_cast<size_t>(std::max(0.0, q * sorted.size() - 1e-9));
+    return static_cast<double>(sorted[std::min(idx, sorted.size() - 1)]);
+}
+
+json summarize(Result& r) {
+    std::sort(r.rtt_ns.begin(), r.rtt_ns.end());
+    double sum = 0;
+    for (uint64_t v : r.rtt_ns) sum += static_cast<double>(v);
+    const double avg_ns = r.rtt_ns.empty() ? 0 : sum / r.rtt_ns.size();
+    const bool stream = r.cell.mode == "stream";
+
+    json j;
+    j["mechanism"] = r.mechanism;
+    j["n"] = r.n;
+    j["lat_avg_ms"] = avg_ns / 1e6;
+    j["lat_p95_ms"] = percentile(r.rtt_ns, 0.95) / 1e6;
+    j["throughput_msg_s"] = r.seconds > 0 ? r.n / r.seconds : 0.0;
+    j["throughput_mb_s"] = r.seconds > 0 ? r.n * static_cast<double>(r.cell.size) / r.seconds / (1024.0 * 1024.0) : 0.0;
+    j["mode"] = r.cell.mode;
+    j["size"] = r.cell.size;
+    j["inflight"] = stream ? r.cell.inflight : 1;
+    j["producers"] = stream ? r.cell.producers : 1;
+    j["lat_avg_us"] = avg_ns / 1e3;
+    j["lat_p50_us"] = percentile(r.rtt_ns, 0.50) / 1e3;
+    j["lat_p90_us"] = percentile(r.rtt_ns, 0.90) / 1e3;
+    j["lat_p99_us"] = percentile(r.rtt_ns, 0.99) / 1e3;
+    j["lat_p999_us"] = percentile(r.rtt_ns, 0.999) / 1e3;
+    j["lat_max_us"] = r.rtt_ns.empty() ? 0.0 : r.rtt_ns.back() / 1e3;
+    j["lost"] = r.lost;
+    j["seconds"] = r.seconds;
+    j["cpu_s"] = r.self.cpu_s;
+    j["cpu_child_s"] = r.child.cpu_s;
+    j["cpu_us_msg"] = r.n ? (r.self.cpu_s + r.child.cpu_s) * 1e6 / r.n : 0.0;
+    j["ctx_vol"] = r.self.ctx_vol;
+    j["ctx_invol"] = r.self.ctx_invol;
+    j["ctx_child"] = r.child.ctx_vol + r.child.ctx_invol;
+    return j;
+}
+
+const std::vector<const char*> CSV_COLUMNS = { "mechanism", "n", "lat_avg_ms", "lat_p95_ms", "throughput_msg_s", "mode", "size",
+                                               "inflight", "lat_avg_us", "lat_p50_us", "lat_p99_us", "lat_max_us", "lost", "seconds" };
+// uma linha por célula; o tests/plot.py desenha as curvas de cruzamento a partir daqui
+const std::vector<const char*> SWEEP_COLUMNS = { "mechanism", "size", "inflight", "producers", "n", "lost", "seconds",
+                                                 "throughput_msg_s", "throughput_mb_s", "lat_avg_us", "lat_p50_us",
+                                                 "lat_p90_us", "lat_p99_us", "lat_p999_us", "lat_max_us", "cpu_s",
+                                                 "cpu_child_s", "cpu_us_msg", "ctx_vol", "ctx_invol", "ctx_child" };
+
+bool write_csv(const std::string& path, const std::vector<const char*>& columns, const std::vector<json>& rows) {
+    if (rows.empty()) return true;
+    std::ofstream f(path);
+    if (!f) return false;
+    for (const char* c : columns) f << (c == columns[0] ? "" : ",") << c;
+    f << '\n';
+    for (const auto& r : rows) {
+        for (const char* c : columns) {
+            f << (c == columns[0] ? "" : ",");
+            const json& v = r[c];
+            if (v.is_string()) f << v.get<std::string>();
+            else if (v.is_number_float()) f << std::round(v.get<double>() * 1e6) / 1e6; // ms com resolução de ns
+            else f << v;
+        }
+        f << '\n';
+    }
+    return static_cast<bool>(f);
+}
+
+bool parse_list(const std::string& v, std::vector<size_t>& out) {
+    out.clear();
+    std::stringstream ss(v);
+    for (std::string x; std::getline(ss, x, ',');) {
+        if (const size_t n = std::strtoull(x.c_str(), nullptr, 10); n > 0) out.push_back(n);
+    }
+    return !out.empty();
+}
+
+bool parse_args(int argc, char** argv, Options& o) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        if (i + 1 >= argc) return false;
+        const std::string v = argv[++i];
+        if (a == "--mech") {
+            o.mechs.clear();
+            std::stringstream ss(v);
+            for (std::string m; std::getline(ss, m, ',');) if (!m.empty()) o.mechs.push_back(m);
+        }
+        else if (a == "--mode") o.mode = v;
+        else if (a == "--warmup") o.warmup = std::strtoull(v.c_str(), nullptr, 10);
+        else if (a == "--iters") o.iters = std::strtoull(v.c_str(), nullptr, 10);
+        else if (a == "--duration") o.duration = std::strtod(v.c_str(), nullptr);
+        else if (a == "--size") o.size = std::max<size_t>(1, std::strtoull(v.c_str(), nullptr, 10));
+        else if (a == "--inflight") o.inflight = std::max<size_t>(1, std::strtoull(v.c_str(), nullptr, 10));
+        else if (a == "--cpu") o.cpu = std::atoi(v.c_str());
+        else if (a == "--out") o.out = v;
+        else if (a == "--sizes") { if (!parse_list(v, o.sizes)) return false; }
+        else if (a == "--depths") { if (!parse_list(v, o.depths)) return false; }
+        else if (a == "--producers") { if (!parse_list(v, o.producers)) return false; }
+        else if (a == "--max-inflight-mb") o.max_inflight_bytes = std::strtoull(v.c_str(), nullptr, 10) << 20;
+        else if (a == "--opts") {
+            o.opts = json::parse(v, nullptr, false);
+            if (!o.opts.is_object()) return false;
+        }
+        else return false;
+    }
+    return o.mode == "pingpong" || o.mode == "stream" || o.mode == "both" || o.mode == "sweep";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    // os módulos relançam este executável como filho (pipe_child, shm_child)
+    if (const int rc = IPCManager::run_child_process(argc, argv); rc >= 0) return rc;
+
+    Options o;
+    if (!parse_args(argc, argv, o)) {
+        std::fprintf(stderr, "uso: %s [--mech pipe,socket,socket_unix,shm] [--mode pingpong|stream|both|sweep] "
+                             "[--warmup N] [--iters N | --duration s] [--size bytes] [--inflight N] [--cpu N] "
+                             "[--opts json] [--out prefixo] [--sizes a,b,..] [--depths a,b,..] [--producers a,b,..] "
+                             "[--max-inflight-mb N] > /dev/null\n", argv[0]);
+        return 2;
+    }
+    pin_current_thread(o.cpu);
+    // diagnóstico por mensagem no stderr atrapalha a medida e o resultado: só erros,
+    // a menos que RA1_LOG_LEVEL peça outro nível
+    if (!std::getenv("RA1_LOG_LEVEL")) log_set_level(LogLevel::error);
+
+    if (o.mode == "sweep" && o.duration <= 0) o.duration = 0.5;
+
+    std::vector<json> pingpong, stream, sweep;
+    for (const auto& mech : o.mechs) {
+        if (!make_transport(mech)) {
+            std::fprintf(stderr, "%s: mecanismo desconhecido\n", mech.c_str());
+            continue;
+        }
+        if (o.mode == "sweep") {
+            for (const size_t size : o.sizes)
+                for (const size_t depth : o.depths)
+                    for (const size_t producers : o.producers) {
+                        if (size * depth > o.max_inflight_bytes) {
+                            std::fprintf(stderr, "%s: %zu B x %zu em voo acima de --max-inflight-mb, pulada\n",
+                                         mech.c_str(), size, depth);
+                            continue;
+                        }
+                        Result r = run(mech, { "stream", size, depth, producers }, o);
+                        json row = summarize(r);
+                        std::fprintf(stderr, "%s\n", row.dump().c_str());
+                        sweep.push_back(std::move(row));
+                    }
+            continue;
+        }
+        for (const char* mode : { "pingpong", "stream" }) {
+            if (o.mode != "both" && o.mode != mode) continue;
+            Result r = run(mech, { mode, o.size, o.inflight, 1 }, o);
+            json row = summarize(r);
+            std::fprintf(stderr, "%s\n", row.dump().c_str());
+            (r.cell.mode == "stream" ? stream : pingpong).push_back(std::move(row));
+        }
+    }
+
+    bool ok = write_csv(o.out + ".csv", CSV_COLUMNS, pingpong);
+    ok = write_csv(o.out + "_stream.csv", CSV_COLUMNS, stream) && ok;
+    ok = write_csv(o.out + "_sweep.csv", SWEEP_COLUMNS, sweep) && ok;
+    if (!ok) std::fprintf(stderr, "falha ao gravar %s*.csv\n", o.out.c_str());
+    return ok ? 0 : 1;
+}
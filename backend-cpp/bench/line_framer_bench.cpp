@@ -0,0 +1,86 @@
+// Microbenchmark do enquadramento por linha: LineFramer (string_view, sem cópia)
+// contra o esquema antigo find/substr/erase sobre std::string.
+// Uso: ra1_line_framer_bench [tamanho_linha=64] [MB=256] [chunk=16384]
+#include "line_framer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::vector<char> make_stream(size_t line_len, size_t total) {
+    std::vector<char> data(total);
+    for (size_t i = 0; i < total; ++i) {
+        data[i] = (i % line_len == line_len - 1) ? '\n' : static_cast<char>('a' + i % 26);
+    }
+    return data;
+}
+
+// Simula recv() em pedaços de 'chunk' bytes direto no buffer do framer
+size_t run_framer(const std::vector<char>& data, size_t chunk, size_t& checksum) {
+    LineFramer f;
+    size_t lines = 0;
+    std::string_view line;
+    for (size_t off = 0; off < data.size(); off += chunk) {
+        const size_t n = std::min(chunk, data.size() - off);
+        std::memcpy(f.prepare(n), data.data() + off, n);
+        f.commit(n);
+        while (f.next(line)) {
+            ++lines;
+            checksum += line.size();
+        }
+    }
+    return lines;
+}
+
+// Esquema anterior: append + find + substr + erase (cópia e alocação por linha)
+size_t run_substr(const std::vector<char>& data, size_t chunk, size_t& checksum) {
+    std::string acc;
+    size_t lines = 0;
+    for (size_t off = 0; off < data.size(); off += chunk) {
+        const size_t n = std::min(chunk, data.size() - off);
+        acc.append(data.data() + off, n);
+        size_t pos;
+        while ((pos = acc.find('\n')) != std::string::npos) {
+            std::string line = acc.substr(0, pos);
+            acc.erase(0, pos + 1);
+            ++lines;
+            checksum += line.size();
+        }
+    }
+    return lines;
+}
+
+template <class Fn>
+void report(const char* name, const std::vector<char>& data, size_t chunk, Fn fn) {
+    size_t checksum = 0;
+    fn(data, chunk, checksum); // aquecimento (páginas, caches)
+    checksum = 0;
+    const auto t0 = Clock::now();
+    const size_t lines = fn(data, chunk, checksum);
+    const double s = std::chrono::duration<double>(Clock::now() - t0).count();
+    std::printf("{\"impl\":\"%s\",\"bytes\":%zu,\"lines\":%zu,\"seconds\":%.6f,\"gb_s\":%.3f,\"mlines_s\":%.3f,\"checksum\":%zu}\n",
+                name, data.size(), lines, s, data.size() / s / 1e9, lines / s / 1e6, checksum);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t line_len = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 64;
+    const size_t mb = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 256;
+    const size_t chunk = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 16384;
+    if (line_len < 2 || mb == 0 || chunk == 0) {
+        std::fprintf(stderr, "uso: %s [tamanho_linha>=2] [MB>0] [chunk>0]\n", argv[0]);
+        return 2;
+    }
+
+    const auto data = make_stream(line_len, mb * 1024 * 1024);
+    report("line_framer", data, chunk, run_framer);
+    report("find_substr_erase", data, chunk, run_substr);
+    return 0;
+}
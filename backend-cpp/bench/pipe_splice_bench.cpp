@@ -0,0 +1,128 @@
+// Microbenchmark do caminho de cópia zero do PipeModule (pipe_platform.hpp), só Linux:
+// um pipe entre duas threads, medindo MB/s para transferências de 1, 16 e 256 MB em
+//   copy      write -> read (o caminho de sempre: usuário -> kernel -> usuário)
+//   vmsplice  PipeSplicer::write -> read (o escritor não copia: empresta as páginas de src)
+//   splice    PipeSplicer::write -> splice para /dev/null (nenhum lado copia o payload)
+// Uso: ra1_pipe_splice_bench [tamanhos_MB=1,16,256] [pipe_bytes=1048576] [repeticoes=3]
+#include "pipe_platform.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum class Mode { copy, vmsplice, splice };
+
+const char* mode_name(Mode m) {
+    return m == Mode::copy ? "copy" : m == Mode::vmsplice ? "vmsplice" : "splice";
+}
+
+// Move até n bytes do pipe 'in' para 'out' por splice, sem passar pelo espaço do usuário;
+// devolve quantos bytes moveu (< n = erro ou EOF)
+size_t splice_all(int in, int out, size_t n) {
+    size_t moved = 0;
+    while (moved < n) {
+        const ssize_t r = splice(in, nullptr, out, nullptr, n - moved, SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) break;
+        moved += static_cast<size_t>(r);
+    }
+    return moved;
+}
+
+// Uma transferência de src do escritor ao leitor; devolve segundos (< 0 = erro).
+// O splicer vem de fora e é reaproveitado, como no PipeModule.
+double transfer(Mode mode, const std::vector<char>& src, size_t pipe_bytes, PipeSplicer& splicer) {
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0) return -1;
+    fcntl(fds[1], F_SETPIPE_SZ, static_cast<int>(pipe_bytes));
+
+    PipeHandle rd = fds[0], wr = fds[1];
+    const size_t total = src.size();
+    size_t received = 0;
+
+    const auto t0 = Clock::now();
+    std::thread reader([&] {
+        if (mode == Mode::splice) {
+            const int sink = open("/dev/null", O_WRONLY | O_CLOEXEC);
+            received = splice_all(rd, sink, total);
+            close(sink);
+            return;
+        }
+        std::vector<char> dst(1 << 20);
+        while (received < total) {
+            const long n = pipe_read(rd, dst.data(), dst.size());
+            if (n <= 0) break;
+            received += static_cast<size_t>(n);
+        }
+    });
+
+    bool ok;
+    if (mode == Mode::copy) {
+        ok = pipe_write_all(wr, src.data(), total);
+    }
+    else {
+        ok = splicer.write(wr, src.data(), total);
+    }
+    reader.join();
+    const double s = std::chrono::duration<double>(Clock::now() - t0).count();
+    pipe_close(rd);
+    pipe_close(wr);
+    return ok && received == total ? s : -1;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::string sizes_arg = argc > 1 ? argv[1] : "1,16,256";
+    const size_t pipe_bytes = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1024 * 1024;
+    const int reps = argc > 3 ? std::atoi(argv[3]) : 3;
+    if (reps <= 0) {
+        std::fprintf(stderr, "uso: %s [tamanhos_MB] [pipe_bytes] [repeticoes>0]\n", argv[0]);
+        return 2;
+    }
+
+    // capacidade efetiva (arredondada pelo kernel); 0 = pipe inválido, splicer só com write
+    PipeSplicer splicer;
+    {
+        int fds[2];
+        if (pipe2(fds, O_CLOEXEC) != 0) return 1;
+        fcntl(fds[1], F_SETPIPE_SZ, static_cast<int>(pipe_bytes));
+        const int effective = fcntl(fds[1], F_GETPIPE_SZ);
+        close(fds[0]);
+        close(fds[1]);
+        splicer.reset(effective > 0 ? static_cast<size_t>(effective) : 0);
+    }
+    if (!splicer.active()) std::fprintf(stderr, "aviso: vmsplice indisponível, modos vmsplice/splice usam write\n");
+
+    for (size_t pos = 0; pos < sizes_arg.size();) {
+        const size_t comma = std::min(sizes_arg.find(',', pos), sizes_arg.size());
+        const size_t mb = std::strtoull(sizes_arg.substr(pos, comma - pos).c_str(), nullptr, 10);
+        pos = comma + 1;
+        if (mb == 0) continue;
+
+        std::vector<char> src(mb * 1024 * 1024);
+        for (size_t i = 0; i < src.size(); ++i) src[i] = static_cast<char>(i * 131);
+
+        for (Mode mode : { Mode::copy, Mode::vmsplice, Mode::splice }) {
+            double best = -1;
+            for (int r = 0; r < reps; ++r) {
+                const double s = transfer(mode, src, pipe_bytes, splicer);
+                if (s > 0 && (best < 0 || s < best)) best = s;
+            }
+            std::printf("{\"mode\":\"%s\",\"mb\":%zu,\"pipe_bytes\":%zu,\"seconds\":%.6f,\"mb_s\":%.1f}\n",
+                        mode_name(mode), mb, pipe_bytes, best, best > 0 ? mb / best : 0.0);
+        }
+    }
+    return 0;
+}
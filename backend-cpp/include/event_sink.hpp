@@ -0,0 +1,105 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <nlohmann/json.hpp>
+
+// Saída única dos eventos JSON para o frontend (stdout). Quem produz um evento só
+// enfileira a linha já serializada numa fila MPSC sem lock (anel limitado, um slot por
+// linha); uma thread escritora drena a fila em escritas grandes direto no descritor do
+// stdout (pipe_platform.hpp), sem o flush por evento do std::endl e sem linhas de threads
+// diferentes se misturando. A escrita sai quando a fila esvazia, quando o lote chega a
+// SINK_BATCH_BYTES ou quando o evento mais antigo do lote passa de SINK_DEADLINE.
+//
+// Frontend lento (fila cheia): eventos de controle (started, status, erros, ...) sempre
+// esperam vaga; os de dados (sent/received, alto volume) seguem a política:
+//   block  (padrão): esperam vaga, como antes (nada se perde, o backend desacelera)
+//   drop:   descartados só com a fila cheia
+//   sample: com a fila acima da metade, passa 1 a cada 'sample_every'; cheia, descarta
+// Depois de perdas, a escritora emite {"event":"events_dropped",...} com as contagens.
+enum class SinkPolicy { block, drop, sample };
+
+SinkPolicy parse_sink_policy(const std::string& s);
+const char* sink_policy_name(SinkPolicy p);
+
+class EventSink {
+public:
+    static constexpr size_t SINK_SLOTS = 1 << 15;           // linhas enfileiradas no máximo
+    static constexpr size_t SINK_BATCH_BYTES = 64 * 1024;   // tamanho alvo de uma escrita
+    static constexpr auto SINK_DEADLINE = std::chrono::milliseconds(2);
+    static constexpr size_t SINK_SLOT_KEEP = 512;           // capacidade que o slot guarda para reúso
+
+    // Instância do processo; a thread escritora nasce no primeiro uso e, no fim do
+    // processo, o destrutor escreve o que ainda estiver na fila
+    static EventSink& instance();
+
+    // line = um evento serializado, sem '\n'. data = evento de alto volume (descartável)
+    void emit(std::string line, bool data = false);
+    // Copia a linha para o slot, cuja string guarda a capacidade entre voltas do anel:
+    // em regime não aloca (caminho do EventWriter)
+    void emit(std::string_view line, bool data = false);
+    void configure(SinkPolicy policy, unsigned sample_every);
+    // Espera o que já foi enfileirado chegar ao stdout (até timeout_ms)
+    bool flush(int timeout_ms = 2000);
+    nlohmann::json stats() const;
+
+    ~EventSink();
+    EventSink(const EventSink&) = delete;
+    EventSink& operator=(const EventSink&) = delete;
+
+private:
+    EventSink();
+    struct Slot {
+        std::atomic<size_t> seq;
+        std::string line;
+    };
+
+    template <class Fill>
+    void push(bool data, std::string_view line, Fill fill);
+    template <class Fill>
+    bool try_push(Fill& fill);
+    bool pop_into(std::string& batch); // acrescenta a linha + '\n' ao lote
+    size_t backlog() const;
+    void wake();
+    void writer_loop();
+    void write_out(const std::string& bytes);
+    void drain_sync(); // escritora já saiu: quem emitiu escreve o resto da fila
+
+    std::unique_ptr<Slot[]> slots_;
+    alignas(64) std::atomic<size_t> head_{ 0 }; // próxima posição de escrita (produtores)
+    alignas(64) std::atomic<size_t> tail_{ 0 }; // próxima posição de leitura (só a escritora)
+
+    std::atomic<SinkPolicy> policy_{ SinkPolicy::block };
+    std::atomic<unsigned> sample_every_{ 10 };
+    std::atomic<uint64_t> sample_tick_{ 0 };
+
+    // contadores (stats e aviso de perdas)
+    std::atomic<uint64_t> queued_{ 0 };      // aceitos na fila
+    std::atomic<uint64_t> written_{ 0 };     // já entregues ao stdout
+    std::atomic<uint64_t> dropped_{ 0 };     // descartados com a fila cheia
+    std::atomic<uint64_t> sampled_out_{ 0 }; // descartados pela amostragem
+    std::atomic<uint64_t> writes_{ 0 };      // escritas no stdout (syscalls)
+    std::atomic<uint64_t> bytes_{ 0 };
+    std::atomic<bool> broken_{ false };      // stdout fechado: a fila só é drenada
+
+    // escritora dormindo: o produtor só toca o mutex se ela estiver esperando
+    std::atomic<bool> sleeping_{ false };
+    std::atomic<bool> stopping_{ false };
+    std::atomic<bool> done_{ false };        // escritora saiu (fim do processo)
+    mutable std::mutex mtx_;
+    std::condition_variable wake_cv_;
+    std::condition_variable written_cv_;
+    std::thread writer_;
+};
+
+// Atalhos usados pelos módulos
+inline void emit_event(std::string line) { EventSink::instance().emit(std::move(line)); }
+inline void emit_event(const nlohmann::json& j) { EventSink::instance().emit(j.dump()); }
+inline void emit_data_event(const nlohmann::json& j) { EventSink::instance().emit(j.dump(), true); }
@@ -0,0 +1,158 @@
+#pragma once
+#include <cassert>
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "event_sink.hpp"
+#include "timestamp.hpp"
+
+// Serialização direta dos eventos de formato fixo (sent, received, stopped, error): os
+// campos vão um a um para um buffer da thread, reaproveitado entre eventos, sem montar o
+// nlohmann::json. Em regime, nem o writer nem o EventSink::emit(string_view) alocam.
+//
+// A saída é a mesma do json::dump() para os mesmos campos, byte a byte, desde que as
+// chaves venham em ordem alfabética (o objeto do nlohmann é um std::map):
+//   EventWriter().field("bytes", n).field("event", "sent").field("id", id)
+//       .field("mechanism", "pipe").ts().emit(true);
+// Escape igual ao do dump(): \" \\ \b \f \n \r \t, demais < 0x20 como \u00xx, UTF-8 cru.
+// UTF-8 inválido (o dump() lançaria type_error) vira U+FFFD.
+// Um writer por vez em cada thread: o próximo construtor reinicia o buffer.
+class EventWriter {
+public:
+    EventWriter() : buf_(buffer()) {
+        buf_.clear();
+        buf_ += '{';
+    }
+
+    EventWriter& field(std::string_view key, std::string_view value) {
+        put_key(key);
+        append_json_string(buf_, value);
+        return *this;
+    }
+
+    template <class T>
+        requires std::is_integral_v<T>
+    EventWriter& field(std::string_view key, T value) {
+        put_key(key);
+        if constexpr (std::is_same_v<T, bool>) {
+            buf_ += value ? "true" : "false";
+        }
+        else {
+            char tmp[24];
+            const auto r = std::to_chars(tmp, tmp + sizeof(tmp), value);
+            buf_.append(tmp, static_cast<size_t>(r.ptr - tmp));
+        }
+        return *this;
+    }
+
+    // "ts": relógio de parede agora (timestamp.hpp), sem passar por std::string
+    EventWriter& ts() {
+        put_key("ts");
+        buf_ += '"';
+        const size_t at = buf_.size();
+        buf_.resize(at + ISO_TIMESTAMP_LEN);
+        format_iso_timestamp(wall_us(), buf_.data() + at);
+        buf_ += '"';
+        return *this;
+    }
+
+    // Fecha o objeto; a view vale até o próximo EventWriter desta thread
+    std::string_view finish() {
+        buf_ += '}';
+        return buf_;
+    }
+
+    // data = evento de alto volume (ver EventSink::emit)
+    void emit(bool data = false) { EventSink::instance().emit(finish(), data); }
+
+    // Escapa 's' como string JSON (com aspas) no fim de 'out'
+    static void append_json_string(std::string& out, std::string_view s);
+
+private:
+    static std::string& buffer() {
+        thread_local std::string buf;
+        return buf;
+    }
+
+    void put_key(std::string_view key) {
+#ifndef NDEBUG
+        assert(last_key_.empty() || last_key_ < key); // fora de ordem: sairia diferente do dump()
+        last_key_ = key;
+#endif
+        if (buf_.size() > 1) buf_ += ',';
+        buf_ += '"';
+        buf_.append(key); // chaves são literais do código: sem escape
+        buf_ += "\":";
+    }
+
+    std::string& buf_;
+#ifndef NDEBUG
+    std::string_view last_key_;
+#endif
+};
+
+inline void EventWriter::append_json_string(std::string& out, std::string_view s) {
+    static constexpr char hex[] = "0123456789abcdef";
+    const auto* p = reinterpret_cast<const unsigned char*>(s.data());
+    const auto* const end = p + s.size();
+    out += '"';
+    while (p < end) {
+        // trecho sem nada a escapar sai de uma vez
+        const auto* run = p;
+        while (p < end && *p >= 0x20 && *p < 0x80 && *p != '"' && *p != '\\') ++p;
+        out.append(reinterpret_cast<const char*>(run), static_cast<size_t>(p - run));
+        if (p == end) break;
+
+        const unsigned char c = *p;
+        if (c < 0x80) {
+            out += '\\';
+            switch (c) {
+            case '"':  out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '\b': out += 'b'; break;
+            case '\f': out += 'f'; break;
+            case '\n': out += 'n'; break;
+            case '\r': out += 'r'; break;
+            case '\t': out += 't'; break;
+            default:
+                out += "u00";
+                out += hex[c >> 4];
+                out += hex[c & 0xF];
+            }
+            ++p;
+            continue;
+        }
+
+        // UTF-8: faixa do 2o byte depende do 1o (sem overlong, surrogate ou > U+10FFFF)
+        size_t len = 0;
+        unsigned char lo = 0x80, hi = 0xBF;
+        if (c >= 0xC2 && c <= 0xDF) len = 2;
+        else if (c >= 0xE0 && c <= 0xEF) {
+            len = 3;
+            if (c == 0xE0) lo = 0xA0;
+            else if (c == 0xED) hi = 0x9F;
+        }
+        else if (c >= 0xF0 && c <= 0xF4) {
+            len = 4;
+            if (c == 0xF0) lo = 0x90;
+            else if (c == 0xF4) hi = 0x8F;
+        }
+        size_t ok = len ? 1 : 0;
+        while (ok > 0 && ok < len && p + ok < end) {
+            const unsigned char cc = p[ok];
+            if (ok == 1 ? (cc < lo || cc > hi) : (cc < 0x80 || cc > 0xBF)) break;
+            ++ok;
+        }
+        if (len && ok == len) {
+            out.append(reinterpret_cast<const char*>(p), len);
+            p += len;
+        }
+        else {
+            out += "\xEF\xBF\xBD"; // U+FFFD no lugar do trecho inválido
+            p += ok ? ok : 1;
+        }
+    }
+    out += '"';
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include "timestamp.hpp"
+
+// Pedidos em voo de um mecanismo: id de correlação -> instante do envio.
+// O send() não espera a resposta: begin() só reserva uma vaga na janela (bloqueia se
+// houver 'limit' pedidos sem resposta) e a thread leitora chama complete() quando o eco
+// com aquele id chega, em qualquer ordem. O RTT sai daí, medido dentro do backend com
+// os instantes de envio e recebimento em mono_ns() (timestamp.hpp).
+class InflightWindow {
+public:
+
+    // Chamado a cada resposta casada com o RTT em ns, dentro do lock (ra1_ipc_bench coleta as
+    // amostras por aqui). Trocar só com o mecanismo parado.
+    using Observer = std::function<void(uint64_t rtt_ns)>;
+    void set_observer(Observer obs) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        observer_ = std::move(obs);
+    }
+
+    // limit = máximo de pedidos sem resposta (0 = sem limite). Esquece os pendentes.
+    void reset(size_t limit) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        limit_ = limit;
+        pending_.clear();
+        size_.store(0, std::memory_order_relaxed);
+        completed_ = 0;
+        cv_.notify_all();
+    }
+
+    // Registra um pedido; id = 0 gera o próximo id sequencial. Com a janela cheia espera
+    // até 'timeout' por uma resposta. Devolve o id usado (0 = janela continuou cheia) e,
+    // em sent_ns, o instante registrado para o envio.
+    uint64_t begin(uint64_t id, uint64_t* sent_ns = nullptr, std::chrono::milliseconds timeout = std::chrono::seconds(5)) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (limit_ > 0 && !cv_.wait_for(lock, timeout, [&] { return pending_.size() < limit_; }))
+            return 0;
+        if (id == 0) id = ++next_id_;
+        const uint64_t now = mono_ns();
+        pending_[id] = now;
+        size_.store(pending_.size(), std::memory_order_relaxed);
+        if (sent_ns) *sent_ns = now;
+        return id;
+    }
+
+    // Resposta do pedido 'id', lida em recv_ns (mono_ns() tomado pela leitora assim que os
+    // bytes chegaram): libera a vaga e devolve o RTT em us (-1 = id desconhecido, repetido
+    // ou de antes do último reset). sent_ns recebe o instante do envio.
+    int64_t complete(uint64_t id, uint64_t recv_ns, uint64_t* sent_ns = nullptr) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = pending_.find(id);
+        if (it == pending_.end()) return -1;
+        const uint64_t sent = it->second;
+        const uint64_t rtt_ns = recv_ns > sent ? recv_ns - sent : 0;
+        pending_.erase(it);
+        size_.store(pending_.size(), std::memory_order_relaxed);
+        if (observer_) observer_(rtt_ns);
+        ++completed_;
+        cv_.notify_one();
+        if (sent_ns) *sent_ns = sent;
+        return static_cast<int64_t>(rtt_ns / 1000);
+    }
+
+    // O envio falhou depois do begin(): libera a vaga sem contar RTT
+    void cancel(uint64_t id) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (pending_.erase(id)) {
+            size_.store(pending_.size(), std::memory_order_relaxed);
+            cv_.notify_one();
+        }
+    }
+
+    size_t in_flight() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return pending_.size();
+    }
+    // O mesmo sem o lock (cópia gravada a cada mudança): para o scrape de métricas, que
+    // não pode disputar o mutex com o send e a leitora
+    size_t in_flight_relaxed() const { return size_.load(std::memory_order_relaxed); }
+    size_t limit() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return limit_;
+    }
+    uint64_t completed() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return completed_;
+    }
+
+private:
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    std::unordered_map<uint64_t, uint64_t> pending_; // id -> mono_ns() do envio
+    Observer observer_;
+    size_t limit_{ 0 };
+    uint64_t next_id_{ 0 };
+    uint64_t completed_{ 0 };
+    std::atomic<size_t> size_{ 0 }; // pending_.size(), lido sem lock
+};
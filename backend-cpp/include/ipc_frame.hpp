@@ -0,0 +1,147 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include "line_framer.hpp"
+
+// Formato de quadro comum a pipe, socket e shm:
+//   [u32 len][u16 type][u16 flags][u64 seq][payload: len bytes]
+// Ordem de bytes do host (IPC sempre local). O tamanho vem antes do payload, então o
+// receptor não varre byte a byte e o payload pode ser binário (inclusive '\n').
+//
+// FrameMode::line mantém o protocolo antigo (payload + '\n', sem type/seq) para
+// compatibilidade; o decodificador entrega os dois modos com a mesma interface.
+enum class FrameType : uint16_t {
+    data = 1,
+    ack = 2,
+    hello = 3, // 1a mensagem do listener interno do socket
+};
+
+enum class FrameMode { line, binary };
+
+constexpr size_t FRAME_HEADER_BYTES = 16;
+// Acima disso o fluxo é tratado como corrompido: 256 MiB de texto mais folga para o
+// cabeçalho do codec e o prefixo do eco
+constexpr size_t FRAME_MAX_PAYLOAD = 256u * 1024 * 1024 + 64 * 1024;
+
+// Flags de quadro
+constexpr uint16_t FRAME_FRAG_BEGIN = 0x1; // payload = u64 tamanho total da mensagem fragmentada
+constexpr uint16_t FRAME_FRAG_MORE = 0x2;  // há mais fragmentos depois deste
+
+struct Frame {
+    FrameType type{ FrameType::data };
+    uint16_t flags{ 0 };
+    uint64_t seq{ 0 };
+    std::string_view payload;
+};
+
+inline FrameMode parse_frame_mode(const std::string& s) {
+    return s == "binary" ? FrameMode::binary : FrameMode::line;
+}
+
+inline const char* frame_mode_name(FrameMode m) {
+    return m == FrameMode::binary ? "binary" : "line";
+}
+
+// ---------------------- Codificador ----------------------
+
+// Escreve o cabeçalho em dst (FRAME_HEADER_BYTES); o payload vai logo em seguida
+inline void write_frame_header(char* dst, FrameType type, uint16_t flags, uint64_t seq, size_t len) {
+    const uint32_t n = static_cast<uint32_t>(len);
+    const uint16_t t = static_cast<uint16_t>(type);
+    std::memcpy(dst, &n, 4);
+    std::memcpy(dst + 4, &t, 2);
+    std::memcpy(dst + 6, &flags, 2);
+    std::memcpy(dst + 8, &seq, 8);
+}
+
+// Acrescenta um quadro completo a out. No modo line, type/seq/flags não viajam.
+inline void encode_frame(std::string& out, FrameMode mode, FrameType type, uint64_t seq,
+                         std::string_view payload, uint16_t flags = 0) {
+    if (mode == FrameMode::line) {
+        out.append(payload);
+        if (payload.empty() || payload.back() != '\n') out += '\n';
+        return;
+    }
+    const size_t at = out.size();
+    out.resize(at + FRAME_HEADER_BYTES);
+    write_frame_header(out.data() + at, type, flags, seq, payload.size());
+    out.append(payload);
+}
+
+// ---------------------- Decodificador ----------------------
+
+// Lê o cabeçalho no início de src (que precisa ter pelo menos FRAME_HEADER_BYTES)
+inline uint32_t read_frame_header(const char* src, Frame& f) {
+    uint32_t n;
+    uint16_t t;
+    std::memcpy(&n, src, 4);
+    std::memcpy(&t, src + 4, 2);
+    std::memcpy(&f.flags, src + 6, 2);
+    std::memcpy(&f.seq, src + 8, 8);
+    f.type = static_cast<FrameType>(t);
+    return n;
+}
+
+// Um quadro binário que ocupa exatamente 'record' (ex.: um registro do anel shm)
+inline bool decode_frame(std::string_view record, Frame& f) {
+    if (record.size() < FRAME_HEADER_BYTES) return false;
+    const uint32_t n = read_frame_header(record.data(), f);
+    if (n != record.size() - FRAME_HEADER_BYTES) return false;
+    f.payload = record.substr(FRAME_HEADER_BYTES);
+    return true;
+}
+
+// Decodificador de fluxo (pipe/socket): o recv escreve direto no buffer (prepare/commit)
+// e next() devolve cada quadro com o payload apontando para o buffer, sem cópia.
+// Os payloads valem até a próxima chamada de prepare().
+class FrameDecoder {
+public:
+    explicit FrameDecoder(FrameMode mode = FrameMode::line) : mode_(mode) {}
+
+    char* prepare(size_t min_free) { return buf_.prepare(min_free); }
+    void commit(size_t n) { buf_.commit(n); }
+    void append(const char* data, size_t n) { buf_.append(data, n); }
+
+    bool next(Frame& f) {
+        if (mode_ == FrameMode::line) {
+            // linhas viram quadros "data" numerados na ordem de chegada
+            if (!buf_.next(f.payload)) return false;
+            f.type = FrameType::data;
+            f.flags = 0;
+            f.seq = ++line_seq_;
+            return true;
+        }
+
+        const std::string_view avail = buf_.peek();
+        if (avail.size() < FRAME_HEADER_BYTES) return false;
+        const uint32_t n = read_frame_header(avail.data(), f);
+        if (n > FRAME_MAX_PAYLOAD) {
+            corrupt_ = true;
+            return false;
+        }
+        if (avail.size() - FRAME_HEADER_BYTES < n) {
+            // já sabe o tamanho: reserva o quadro inteiro de uma vez (sem dobrar aos poucos)
+            want_ = FRAME_HEADER_BYTES + n - avail.size();
+            return false;
+        }
+        want_ = 0;
+        f.payload = avail.substr(FRAME_HEADER_BYTES, n);
+        buf_.consume(FRAME_HEADER_BYTES + n);
+        return true;
+    }
+
+    // Quanto o próximo recv deveria ler: pelo menos 'chunk', ou o restante do quadro atual
+    size_t read_hint(size_t chunk) const { return want_ > chunk ? want_ : chunk; }
+    bool corrupt() const { return corrupt_; }
+    FrameMode mode() const { return mode_; }
+
+private:
+    LineFramer buf_;
+    FrameMode mode_;
+    uint64_t line_seq_{ 0 };
+    size_t want_{ 0 };
+    bool corrupt_{ false };
+};
@@ -7,6 +7,9 @@
 #include "pipe_module.hpp"
 #include "socket_module.hpp"
 #include "shared_memory_module.hpp"  // ADICIONADO
+#include "shm_hub.hpp"
+#include "metrics.hpp"
+#include "metrics_server.hpp"
 #include "nlohmann/json.hpp"
 
 using json = nlohmann::json;
@@ -16,12 +19,28 @@ public:
     IPCManager();
     ~IPCManager();
 
-    bool start(const std::string& mechanism);
+    // options: o próprio comando "start" (campos extras repassados ao módulo)
+    //          "event_policy": "block" (padrão) | "drop" | "sample" e "event_sample": N (padrão 10),
+    //          o que fazer com sent/received quando o frontend não lê o stdout (event_sink.hpp)
+    bool start(const std::string& mechanism, const json& options = json::object());
     void stop();
-    bool send(const std::string& message);
+    // key: opcional, para despacho por hash no pool de filhos do pipe
+    // id: correlação devolvida no "received" (com rtt_us); 0 = o mecanismo numera
+    bool send(const std::string& message, const std::string& key = std::string(), uint64_t id = 0);
+    bool flush(); // esvazia buffers de escrita do mecanismo ativo (pipe com batch_bytes)
     std::string get_status() const;
-    json status();  // ADICIONADO
+    // Texto OpenMetrics (metrics.hpp) dos três mecanismos + fila de eventos + o próprio
+    // IPCManager. Só lê contadores atômicos: pode rodar na thread do endpoint.
+    std::string metrics();
+    // Comando "metrics": sem "serve", evento "metrics" com o texto; com "serve" liga
+    // ({"transport": "tcp" (padrão, 127.0.0.1) | "unix", "port": 9464, "path": ...}) ou
+    // desliga (false) o endpoint HTTP local e responde com "metrics_endpoint"
+    json metrics_command(const json& command);
     void run_child_mode();
+    // Processos filhos dos mecanismos, que rodam o próprio executável (spawn_pipe_child /
+    // spawn_self): pipe_child, shm_child e shm_hub_client. Devolve o código de saída do
+    // filho ou -1 se argv não for um desses modos. Todo main que linka os módulos chama primeiro.
+    static int run_child_process(int argc, char* argv[]);
 
     // Helper functions for event creation
     static json create_base_event(const std::string& event_type);
@@ -29,11 +48,16 @@ public:
     static std::string make_simple_event(const std::string& event_type, const std::string& message);
 
 private:
+    bool send_active(const std::string& message, const std::string& key, uint64_t id);
+
     std::unique_ptr<PipeModule> pipe_module_;
     std::unique_ptr<SocketModule> socket_module_;
     std::unique_ptr<SharedMemoryModule> shm_;  // ADICIONADO
+    std::unique_ptr<ShmHub> shm_hub_;
     std::string current_mechanism_;
     std::atomic<bool> running_{ false };
+    ManagerCounters counters_;
+    MetricsServer metrics_server_; // depois dos módulos: é destruído (e para) antes deles
 };
 
 #endif // IPC_MANAGER_HPP
\ No newline at end of file
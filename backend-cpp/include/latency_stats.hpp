@@ -0,0 +1,203 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "timestamp.hpp"
+
+// Latência (RTT) e vazão de um mecanismo, para o comando status.
+//
+// Histograma no estilo HDR: valores em ns em faixas log-lineares, SUB_BUCKETS faixas
+// iguais por potência de 2 (erro relativo < 1/SUB_BUCKETS = 0,8%), até 2^36 ns (~69 s);
+// acima disso cai na última faixa (o máximo exato fica à parte). Vazão: contadores de
+// mensagens e bytes por segundo num anel, somados nos últimos WINDOW_S segundos.
+//
+// Gravação sem lock: cada thread cai num shard fixo (as leitoras dos mecanismos ficam
+// cada uma no seu) e só faz fetch_add/CAS relaxados nele. A leitura (status) soma os
+// shards com loads relaxados: nunca espera nem segura o caminho dos dados, e o que vier
+// no meio da soma entra no próximo status.
+class LatencyStats {
+public:
+    static constexpr unsigned SUB_BITS = 7;
+    static constexpr uint64_t SUB_BUCKETS = uint64_t(1) << SUB_BITS;
+    static constexpr unsigned MAX_BITS = 36;
+    static constexpr size_t BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS; // bucket_of(2^36 - 1) + 1
+    static constexpr size_t SHARDS = 4;
+    static constexpr uint64_t WINDOW_S = 10;
+
+    LatencyStats() : shards_(std::make_unique<Shard[]>(SHARDS)) { reset(); }
+
+    // Zera tudo; só com o mecanismo parado (o start() dos módulos)
+    void reset() {
+        for (size_t s = 0; s < SHARDS; ++s) {
+            Shard& sh = shards_[s];
+            for (auto& b : sh.buckets) b.store(0, std::memory_order_relaxed);
+            sh.sum_ns.store(0, std::memory_order_relaxed);
+            sh.max_ns.store(0, std::memory_order_relaxed);
+            for (auto& w : sh.slots) {
+                w.messages.store(0, std::memory_order_relaxed);
+                w.bytes.store(0, std::memory_order_relaxed);
+            }
+        }
+        start_ns_.store(mono_ns(), std::memory_order_relaxed);
+    }
+
+    // Mensagem recebida às now_ns (mono_ns) com 'bytes' de payload: entra na vazão
+    void count(size_t bytes, uint64_t now_ns) {
+        Shard& sh = shard();
+        const uint64_t sec = now_ns / 1000000000ull;
+        Slot& w = sh.slots[sec % SLOTS];
+        bump(w.messages, sec, 1);
+        bump(w.bytes, sec, bytes);
+    }
+
+    // RTT de um pedido casado pela InflightWindow (instantes em mono_ns)
+    void record_rtt(uint64_t sent_ns, uint64_t recv_ns) {
+        const uint64_t v = recv_ns > sent_ns ? recv_ns - sent_ns : 0;
+        Shard& sh = shard();
+        sh.buckets[bucket_of(v)].fetch_add(1, std::memory_order_relaxed);
+        sh.sum_ns.fetch_add(v, std::memory_order_relaxed);
+        uint64_t m = sh.max_ns.load(std::memory_order_relaxed);
+        while (v > m && !sh.max_ns.compare_exchange_weak(m, v, std::memory_order_relaxed)) {}
+    }
+
+    // Buckets somados dos shards, para o status e o histograma do comando metrics
+    struct Snapshot {
+        std::vector<uint64_t> buckets; // BUCKETS contagens, faixa i = [.., bucket_high(i)]
+        uint64_t count{ 0 };           // soma dos buckets: coerente com os percentis
+        uint64_t sum_ns{ 0 };
+        uint64_t max_ns{ 0 };
+    };
+
+    Snapshot snapshot() const {
+        Snapshot snap;
+        snap.buckets.assign(BUCKETS, 0);
+        for (size_t s = 0; s < SHARDS; ++s) {
+            const Shard& sh = shards_[s];
+            for (size_t i = 0; i < BUCKETS; ++i) snap.buckets[i] += sh.buckets[i].load(std::memory_order_relaxed);
+            snap.sum_ns += sh.sum_ns.load(std::memory_order_relaxed);
+            snap.max_ns = std::max(snap.max_ns, sh.max_ns.load(std::memory_order_relaxed));
+        }
+        for (const uint64_t c : snap.buckets) snap.count += c;
+        return snap;
+    }
+
+    // {"latency": {count, mean/p50/p90/p99/p999/max em us}, "rate": {janela, msg/s, bytes/s}}
+    void append_json(nlohmann::json& j) const {
+        const Snapshot snap = snapshot();
+        const uint64_t total = snap.count, sum = snap.sum_ns, max = snap.max_ns;
+
+        auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1e3; };
+        nlohmann::json lat;
+        lat["count"] = total;
+        lat["mean_us"] = total ? us(sum) / static_cast<double>(total) : 0.0;
+        static constexpr std::pair<const char*, double> quantiles[] = {
+            { "p50_us", 0.50 }, { "p90_us", 0.90 }, { "p99_us", 0.99 }, { "p999_us", 0.999 }
+        };
+        for (const auto& [name, q] : quantiles) lat[name] = us(std::min(value_at(snap.buckets, total, q), max));
+        lat["max_us"] = us(max);
+        j["latency"] = lat;
+
+        // Vazão: segundos (now - WINDOW_S, now], o atual ainda parcial
+        const uint64_t now = mono_ns();
+        const uint64_t now_sec = now / 1000000000ull;
+        uint64_t messages = 0, bytes = 0;
+        for (size_t s = 0; s < SHARDS; ++s) {
+            for (uint64_t k = 0; k < WINDOW_S && k <= now_sec; ++k) {
+                const uint64_t sec = now_sec - k;
+                const Slot& w = shards_[s].slots[sec % SLOTS];
+                messages += value_in(w.messages, sec);
+                bytes += value_in(w.bytes, sec);
+            }
+        }
+        const uint64_t since_start = now - start_ns_.load(std::memory_order_relaxed);
+        const uint64_t span_ns = std::min<uint64_t>(since_start, (WINDOW_S - 1) * 1000000000ull + now % 1000000000ull);
+        const double span = static_cast<double>(span_ns) / 1e9;
+        nlohmann::json rate;
+        rate["window_s"] = span;
+        rate["messages"] = messages;
+        rate["bytes"] = bytes;
+        rate["msg_s"] = span > 0 ? messages / span : 0.0;
+        rate["bytes_s"] = span > 0 ? bytes / span : 0.0;
+        j["rate"] = rate;
+    }
+
+    // Faixa de v: linear até 2*SUB_BUCKETS, depois SUB_BUCKETS faixas por potência de 2
+    static size_t bucket_of(uint64_t v) {
+        const unsigned width = static_cast<unsigned>(std::bit_width(v));
+        if (width > MAX_BITS) return BUCKETS - 1;
+        const unsigned shift = width > SUB_BITS + 1 ? width - SUB_BITS - 1 : 0;
+        return static_cast<size_t>(shift * SUB_BUCKETS + (v >> shift));
+    }
+
+    // Maior valor que cai na faixa i (como o highestEquivalentValue do HdrHistogram)
+    static uint64_t bucket_high(size_t i) {
+        if (i < 2 * SUB_BUCKETS) return i;
+        const unsigned shift = static_cast<unsigned>(i / SUB_BUCKETS - 1);
+        const uint64_t low = (i - shift * SUB_BUCKETS) << shift;
+        return low + (uint64_t(1) << shift) - 1;
+    }
+
+private:
+    static constexpr size_t SLOTS = 16;       // > WINDOW_S: o segundo mais velho não é reusado durante a soma
+    static constexpr unsigned TAG_SHIFT = 40; // slot = [segundo (24 bits)][valor (40 bits)]
+    static constexpr uint64_t VALUE_MASK = (uint64_t(1) << TAG_SHIFT) - 1;
+
+    struct Slot {
+        std::atomic<uint64_t> messages{ 0 };
+        std::atomic<uint64_t> bytes{ 0 };
+    };
+
+    // Um por linha de cache: shards de threads diferentes não disputam linha
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> buckets[BUCKETS];
+        std::atomic<uint64_t> sum_ns{ 0 };
+        std::atomic<uint64_t> max_ns{ 0 };
+        Slot slots[SLOTS];
+    };
+
+    static uint64_t tag_of(uint64_t sec) { return sec & ((uint64_t(1) << (64 - TAG_SHIFT)) - 1); }
+
+    // Soma n no slot se ele já é do segundo 'sec'; senão recomeça nele (o valor velho era
+    // de WINDOW_S+ segundos atrás). Segundo e valor na mesma palavra: troca sem lock.
+    static void bump(std::atomic<uint64_t>& slot, uint64_t sec, uint64_t n) {
+        const uint64_t tag = tag_of(sec);
+        uint64_t cur = slot.load(std::memory_order_relaxed);
+        uint64_t next;
+        do {
+            next = (cur >> TAG_SHIFT) == tag ? cur + n : (tag << TAG_SHIFT) | (n & VALUE_MASK);
+        } while (!slot.compare_exchange_weak(cur, next, std::memory_order_relaxed));
+    }
+
+    static uint64_t value_in(const std::atomic<uint64_t>& slot, uint64_t sec) {
+        const uint64_t w = slot.load(std::memory_order_relaxed);
+        return (w >> TAG_SHIFT) == tag_of(sec) ? (w & VALUE_MASK) : 0;
+    }
+
+    static uint64_t value_at(const std::vector<uint64_t>& merged, uint64_t total, double q) {
+        if (total == 0) return 0;
+        const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(total))));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < merged.size(); ++i) {
+            seen += merged[i];
+            if (seen >= rank) return bucket_high(i);
+        }
+        return bucket_high(merged.size() - 1);
+    }
+
+    // Shard da thread: distribuído em rodízio na primeira gravação dela
+    Shard& shard() {
+        static std::atomic<unsigned> next{ 0 };
+        thread_local const unsigned index = next.fetch_add(1, std::memory_order_relaxed) % SHARDS;
+        return shards_[index];
+    }
+
+    std::unique_ptr<Shard[]> shards_;
+    std::atomic<uint64_t> start_ns_{ 0 };
+};
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+// Enquadramento por linha ('\n') sobre um buffer contíguo que cresce sob demanda.
+// O recv escreve direto no fim (prepare/commit) e next() devolve cada linha como
+// string_view apontando para o próprio buffer: nenhuma cópia ou alocação por linha.
+//
+// - begin_: início da 1a linha ainda não entregue (cursor de leitura)
+// - scan_:  até onde já se procurou '\n' (não reprocessa bytes de uma linha parcial)
+// - end_:   fim dos bytes válidos
+// As views devolvidas por next() valem até a próxima chamada de prepare()/append().
+class LineFramer {
+public:
+    LineFramer() = default;
+    explicit LineFramer(size_t initial_capacity) : buf_(initial_capacity) {}
+
+    // Garante pelo menos min_free bytes livres no fim e devolve onde escrever
+    char* prepare(size_t min_free) {
+        if (buf_.size() - end_ < min_free) make_room(min_free);
+        return buf_.data() + end_;
+    }
+    size_t writable() const { return buf_.size() - end_; }
+    void commit(size_t n) { end_ += n; }
+
+    void append(const char* data, size_t n) {
+        std::memcpy(prepare(n), data, n);
+        commit(n);
+    }
+
+    // Próxima linha completa (sem o '\n'); false = só resta uma linha parcial
+    bool next(std::string_view& line) {
+        const char* base = buf_.data();
+        const void* nl = std::memchr(base + scan_, '\n', end_ - scan_);
+        if (!nl) {
+            scan_ = end_;
+            return false;
+        }
+        const size_t pos = static_cast<const char*>(nl) - base;
+        line = std::string_view(base + begin_, pos - begin_);
+        begin_ = scan_ = pos + 1;
+        // tudo consumido: volta ao início sem mover nada (a view continua válida)
+        if (begin_ == end_) begin_ = scan_ = end_ = 0;
+        return true;
+    }
+
+    size_t pending() const { return end_ - begin_; } // bytes de uma linha ainda incompleta
+    std::string_view peek() const { return { buf_.data() + begin_, end_ - begin_ }; }
+
+    // Descarta n bytes do início (quadros delimitados por tamanho, sem procurar '\n')
+    void consume(size_t n) {
+        begin_ += n;
+        if (scan_ < begin_) scan_ = begin_;
+        if (begin_ == end_) begin_ = scan_ = end_ = 0;
+    }
+
+    size_t capacity() const { return buf_.size(); }
+    void clear() { begin_ = scan_ = end_ = 0; }
+
+private:
+    void make_room(size_t min_free) {
+        // 1o tenta compactar (a linha parcial desce para o início); só então cresce
+        if (begin_ > 0) {
+            std::memmove(buf_.data(), buf_.data() + begin_, end_ - begin_);
+            scan_ -= begin_;
+            end_ -= begin_;
+            begin_ = 0;
+        }
+        if (buf_.size() - end_ < min_free) {
+            size_t cap = buf_.empty() ? 4096 : buf_.size();
+            while (cap - end_ < min_free) cap *= 2;
+            buf_.resize(cap);
+        }
+    }
+
+    std::vector<char> buf_;
+    size_t begin_{ 0 };
+    size_t scan_{ 0 };
+    size_t end_{ 0 };
+};
@@ -0,0 +1,80 @@
+#pragma once
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+// Log de diagnóstico no stderr (o stdout é só dos eventos JSON, ver event_sink.hpp).
+// Dois filtros:
+//   compilação: RA1_LOG_MIN_LEVEL (0 = trace ... 5 = off). Chamadas abaixo dele somem do
+//               binário. Padrão: info com NDEBUG (Release: trace/debug compilados fora), trace sem.
+//   execução:   log_set_level(), variável de ambiente RA1_LOG_LEVEL ou o comando
+//               {"cmd":"log_level","level":"..."}; só filtra o que foi compilado.
+// O stream dos argumentos só é montado se o nível estiver ligado:
+//   LOG_TRACE("SEND", "Sending to server: " << message);
+// Cada linha ("DEBUG [SEND]: ...") sai numa escrita só, sem flush extra do std::endl.
+enum class LogLevel : int { trace = 0, debug, info, warn, error, off };
+
+#ifndef RA1_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define RA1_LOG_MIN_LEVEL 2
+#else
+#define RA1_LOG_MIN_LEVEL 0
+#endif
+#endif
+
+inline const char* log_level_name(LogLevel l) {
+    static const char* const names[] = { "TRACE", "DEBUG", "INFO", "WARN", "ERROR", "OFF" };
+    return names[static_cast<int>(l)];
+}
+
+// "trace" | "debug" | "info" | "warn" | "error" | "off" (maiúsculas também); inválido = fallback
+inline LogLevel parse_log_level(std::string_view s, LogLevel fallback) {
+    for (int i = 0; i <= static_cast<int>(LogLevel::off); ++i) {
+        const std::string_view name = log_level_name(static_cast<LogLevel>(i));
+        if (s.size() != name.size()) continue;
+        bool same = true;
+        for (size_t k = 0; k < s.size() && same; ++k) same = (s[k] & ~0x20) == name[k];
+        if (same) return static_cast<LogLevel>(i);
+    }
+    return fallback;
+}
+
+namespace log_detail {
+inline int initial_level() {
+    const char* env = std::getenv("RA1_LOG_LEVEL");
+    return static_cast<int>(parse_log_level(env ? env : "", static_cast<LogLevel>(RA1_LOG_MIN_LEVEL)));
+}
+inline std::atomic<int> g_level{ initial_level() };
+} // namespace log_detail
+
+inline LogLevel log_level() { return static_cast<LogLevel>(log_detail::g_level.load(std::memory_order_relaxed)); }
+inline void log_set_level(LogLevel l) { log_detail::g_level.store(static_cast<int>(l), std::memory_order_relaxed); }
+inline bool log_enabled(LogLevel l) { return static_cast<int>(l) >= log_detail::g_level.load(std::memory_order_relaxed); }
+
+inline void log_write(LogLevel l, const char* tag, const std::string& msg) {
+    std::string line;
+    line.reserve(msg.size() + 32);
+    line.append(log_level_name(l)).append(" [").append(tag).append("]: ").append(msg) += '\n';
+    std::fwrite(line.data(), 1, line.size(), stderr); // stderr sem buffer: uma escrita por linha
+}
+
+#define RA1_LOG(level, tag, expr)                                      \
+    do {                                                               \
+        if constexpr (static_cast<int>(level) >= RA1_LOG_MIN_LEVEL) {  \
+            if (log_enabled(level)) {                                  \
+                std::ostringstream ra1_log_os_;                        \
+                ra1_log_os_ << expr;                                   \
+                log_write(level, tag, ra1_log_os_.str());              \
+            }                                                          \
+        }                                                              \
+    } while (0)
+
+// trace = por mensagem (caminho quente); debug = ciclo de vida; warn = falhas recuperáveis
+#define LOG_TRACE(tag, expr) RA1_LOG(LogLevel::trace, tag, expr)
+#define LOG_DEBUG(tag, expr) RA1_LOG(LogLevel::debug, tag, expr)
+#define LOG_INFO(tag, expr) RA1_LOG(LogLevel::info, tag, expr)
+#define LOG_WARN(tag, expr) RA1_LOG(LogLevel::warn, tag, expr)
+#define LOG_ERROR(tag, expr) RA1_LOG(LogLevel::error, tag, expr)
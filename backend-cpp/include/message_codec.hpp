@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <nlohmann/json.hpp>
+
+// Codec das mensagens que atravessam os mecanismos (pipe, socket, shm). O stdin/stdout
+// com o frontend continua em JSON; isto vale só para o trecho entre os dois lados do IPC.
+//
+// Esquema: event, mechanism, from, id, text, message_number, ts, pid (todos opcionais).
+// id = correlação pedido/resposta: quem ecoa devolve o id do pedido (0 = sem correlação).
+// ts = relógio de parede de quem escreveu a mensagem, em us desde a época (wall_us()).
+//   json   (padrão): o formato de sempre, via nlohmann::json
+//   binary: [0xB7][máscara u8] + campos presentes, na ordem do esquema:
+//           strings = varint tamanho + bytes; inteiros = varint (zigzag nos com sinal)
+// O binary não escapa nada e pode conter '\n': exige "framing": "binary".
+enum class CodecKind { json, binary };
+
+CodecKind parse_codec(const std::string& s);
+const char* codec_name(CodecKind k);
+
+struct Message {
+    std::string_view event;
+    std::string_view mechanism;
+    std::string_view from;
+    std::string_view text;
+    uint64_t id{ 0 };
+    int64_t message_number{ 0 };
+    int64_t ts{ 0 };
+    uint32_t pid{ 0 };
+};
+
+class MessageCodec {
+public:
+    explicit MessageCodec(CodecKind kind = CodecKind::json) : kind_(kind) {}
+    CodecKind kind() const { return kind_; }
+
+    // Acrescenta m codificado a out (campos vazios / zero não são escritos)
+    void encode(const Message& m, std::string& out) const;
+
+    // false = 'in' não é uma mensagem deste codec (ex.: texto cru do frontend).
+    // As views de m apontam para 'in' (binary) ou para o próprio codec (json)
+    // e valem até a próxima decode().
+    bool decode(std::string_view in, Message& m);
+
+    // Só binary, para payloads que não passam por uma string montada (vmsplice): o texto é
+    // o último campo do esquema, então a mensagem pode ser escrita até o início dele e o
+    // resto do texto seguir cru. encode_head escreve m com text declarado como
+    // m.text + tail_bytes (m.text = começo já conhecido); campos depois de text precisam ser zero.
+    void encode_head(const Message& m, size_t tail_bytes, std::string& out) const;
+
+    // Evento JSON equivalente, para o stdout do frontend ("ts" sai como "timestamp")
+    static nlohmann::json to_event(const Message& m);
+
+private:
+    CodecKind kind_;
+    std::string event_, mechanism_, from_, text_; // armazenamento do decode JSON, reaproveitado
+};
@@ -0,0 +1,127 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include "latency_stats.hpp"
+
+// Métricas no formato de texto OpenMetrics (comando "metrics" e endpoint local, ver
+// metrics_server.hpp), para um scraper local.
+//
+// Contadores: um por linha de cache, só fetch_add relaxado. Quem envia e a thread leitora
+// de um mecanismo mexem em contadores diferentes, então não disputam linha entre si; o
+// scrape só faz loads. São monotônicos pela vida do processo (não zeram no start, ao
+// contrário do messages_sent/received do status), como o OpenMetrics espera de um counter.
+
+struct alignas(64) MetricCounter {
+    std::atomic<uint64_t> value{ 0 };
+
+    void add(uint64_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t load() const { return value.load(std::memory_order_relaxed); }
+};
+static_assert(sizeof(MetricCounter) == 64, "um contador por linha de cache");
+
+// Contadores de um mecanismo (PipeModule, SocketModule, SharedMemoryModule)
+struct TransportCounters {
+    MetricCounter messages_sent;     // send() aceito
+    MetricCounter bytes_sent;        // quadro inteiro no pipe/socket, payload no shm
+    MetricCounter messages_received; // respostas lidas pela leitora
+    MetricCounter bytes_received;    // payload das respostas
+    MetricCounter errors;            // eventos de erro emitidos pelo módulo
+    MetricCounter reconnects;        // só o socket: reconexões do cliente interno
+};
+
+// Contadores do IPCManager (comandos que chegam do frontend)
+struct ManagerCounters {
+    MetricCounter starts;
+    MetricCounter start_failures;
+    MetricCounter sends;
+    MetricCounter send_failures;
+    MetricCounter scrapes;           // metrics renderizadas (comando + endpoint)
+};
+
+// Monta a exposição: família a família (# TYPE/# HELP/# UNIT e as amostras), "# EOF" no
+// fim. Labels entram já formatadas ('mechanism="pipe"'), sem chaves; só valores fixos do
+// backend, então sem escape.
+class OpenMetricsWriter {
+public:
+    // type: counter | gauge | histogram. Counter: a amostra leva o sufixo _total.
+    // unit (opcional) precisa ser o sufixo do nome (ra1_rtt_seconds -> seconds)
+    OpenMetricsWriter& family(std::string_view name, std::string_view type, std::string_view help,
+                              std::string_view unit = {}) {
+        line("# TYPE ", name, " ", type);
+        if (!unit.empty()) line("# UNIT ", name, " ", unit);
+        line("# HELP ", name, " ", help);
+        return *this;
+    }
+
+    OpenMetricsWriter& sample(std::string_view name, std::string_view labels, uint64_t v) {
+        char buf[24];
+        const int n = std::snprintf(buf, sizeof(buf), "%llu", static_cast<unsigned long long>(v));
+        return sample_text(name, labels, std::string_view(buf, static_cast<size_t>(n)));
+    }
+
+    OpenMetricsWriter& sample(std::string_view name, std::string_view labels, double v) {
+        char buf[32];
+        const int n = std::snprintf(buf, sizeof(buf), "%.9g", v);
+        return sample_text(name, labels, std::string_view(buf, static_cast<size_t>(n)));
+    }
+
+    // Histograma em segundos a partir dos buckets HDR do LatencyStats: contagem acumulada
+    // até cada limite fixo 'le' (1 us .. 10 s, passos 1-2,5-5), +Inf, _count e _sum.
+    // Um bucket HDR entra no primeiro 'le' que o contém pelo início da faixa: o erro na
+    // fronteira é o da faixa (< 0,8%). Família declarada antes por family(.., "histogram", ..).
+    OpenMetricsWriter& histogram(std::string_view name, std::string_view labels, const LatencyStats::Snapshot& snap) {
+        static constexpr std::pair<uint64_t, std::string_view> bounds[] = {
+            { 1000, "1e-06" }, { 2500, "2.5e-06" }, { 5000, "5e-06" },
+            { 10000, "1e-05" }, { 25000, "2.5e-05" }, { 50000, "5e-05" },
+            { 100000, "0.0001" }, { 250000, "0.00025" }, { 500000, "0.0005" },
+            { 1000000, "0.001" }, { 2500000, "0.0025" }, { 5000000, "0.005" },
+            { 10000000, "0.01" }, { 25000000, "0.025" }, { 50000000, "0.05" },
+            { 100000000, "0.1" }, { 250000000, "0.25" }, { 500000000, "0.5" },
+            { 1000000000, "1" }, { 2500000000, "2.5" }, { 5000000000, "5" },
+            { 10000000000, "10" }
+        };
+        const std::string bucket = std::string(name) + "_bucket";
+        std::string with_le(labels);
+        if (!with_le.empty()) with_le += ',';
+        const size_t le_at = with_le.size();
+
+        uint64_t cumulative = 0;
+        size_t next = 0; // próximo bucket HDR ainda não somado
+        for (const auto& [ns, text] : bounds) {
+            const size_t last = LatencyStats::bucket_of(ns);
+            for (; next <= last && next < snap.buckets.size(); ++next) cumulative += snap.buckets[next];
+            with_le.resize(le_at);
+            with_le.append("le=\"").append(text).append("\"");
+            sample(bucket, with_le, cumulative);
+        }
+        with_le.resize(le_at);
+        with_le.append("le=\"+Inf\"");
+        sample(bucket, with_le, snap.count);
+        sample(std::string(name) + "_count", labels, snap.count);
+        return sample(std::string(name) + "_sum", labels, static_cast<double>(snap.sum_ns) / 1e9);
+    }
+
+    std::string finish() {
+        out_ += "# EOF\n";
+        return std::move(out_);
+    }
+
+private:
+    template <class... Parts>
+    void line(const Parts&... parts) {
+        (out_.append(parts), ...);
+        out_ += '\n';
+    }
+
+    OpenMetricsWriter& sample_text(std::string_view name, std::string_view labels, std::string_view value) {
+        out_.append(name);
+        if (!labels.empty()) out_.append("{").append(labels).append("}");
+        out_.append(" ").append(value).append("\n");
+        return *this;
+    }
+
+    std::string out_;
+};
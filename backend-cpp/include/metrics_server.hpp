@@ -0,0 +1,38 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include "socket_platform.hpp"
+
+// Endpoint local do comando metrics: HTTP/1.0 mínimo para um scraper local
+// (GET /metrics -> texto OpenMetrics), em TCP só no loopback (127.0.0.1) ou num socket
+// AF_UNIX (curl --unix-socket). Uma thread, uma conexão por vez, fechada após a resposta:
+// a 1 Hz o custo é o render() e nada no caminho dos dados.
+class MetricsServer {
+public:
+    using Render = std::function<std::string()>;
+
+    explicit MetricsServer(Render render) : render_(std::move(render)) {}
+    ~MetricsServer() { stop(); }
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    // Abre o endpoint e sobe a thread; se já estiver servindo, troca de endpoint
+    bool start(const SocketEndpoint& ep, std::string& err);
+    void stop();
+    bool is_running() const { return running_.load(); }
+    const SocketEndpoint& endpoint() const { return endpoint_; }
+    uint64_t requests() const { return requests_.load(std::memory_order_relaxed); }
+
+private:
+    void serve(SOCKET ls); // thread do endpoint; ls fechado pelo stop()
+    void respond(SOCKET s);
+
+    Render render_;
+    SocketEndpoint endpoint_;
+    SOCKET listen_{ INVALID_SOCKET };
+    std::thread thread_;
+    std::atomic<bool> running_{ false };
+    std::atomic<uint64_t> requests_{ 0 };
+};
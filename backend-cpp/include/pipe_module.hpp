@@ -1,39 +1,125 @@
 #ifndef PIPE_MODULE_HPP
 #define PIPE_MODULE_HPP
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 #include "nlohmann/json.hpp"
+#include "inflight_window.hpp"
+#include "latency_stats.hpp"
+#include "metrics.hpp"
+#include "ipc_frame.hpp"
+#include "message_codec.hpp"
+#include "pipe_platform.hpp"
 
 using json = nlohmann::json;
 
 // Forward declaration
 class IPCManager;
 
+// Um processo filho do pool: pipes próprios, lote próprio e contadores para o despacho
+struct PipeWorker {
+    int id{ 0 };
+    PipeChild child;
+    PipeSplicer splicer;              // vmsplice dos payloads >= splice_min
+    std::mutex write_mutex;           // serializa as escritas no pipe (lote, send direto, send_large)
+    std::string batch;                // quadros acumulados (protegido por batch_mutex_ do módulo)
+    std::string batch_out;            // lote sendo escrito (troca com batch, sem realocar)
+    size_t batch_msgs{ 0 };
+    std::vector<uint64_t> batch_seqs;     // seq de cada quadro do lote (cancelados se a escrita falhar)
+    std::vector<uint64_t> batch_out_seqs; // os do lote sendo escrito
+    std::chrono::steady_clock::time_point batch_first; // chegada da 1ª mensagem do lote
+    std::atomic<int64_t> outstanding{ 0 };             // enviadas - respondidas
+    std::atomic<uint64_t> sent{ 0 };
+    std::atomic<uint64_t> received{ 0 };
+    std::atomic<bool> failed{ false }; // filho derrubado por falha no meio de um send_large: fora do despacho
+};
+
+// Como o send escolhe o filho
+enum class PipeDispatch { round_robin, least_outstanding, key_hash };
+
 class PipeModule {
 public:
     PipeModule(IPCManager* manager);
     ~PipeModule();
 
-    bool start();
+    // opts: "framing": "line" (padrão) | "binary" (quadros com tamanho, ver ipc_frame.hpp)
+    //       "codec": "json" (padrão) | "binary" (message_codec.hpp; implica framing binary)
+    //       "pipe_bytes": capacidade pedida para os pipes (padrão 1 MiB; Linux: F_SETPIPE_SZ)
+    //       "batch_bytes": > 0 liga a coalescência de escritas: os quadros acumulam num buffer
+    //                      que vai ao pipe numa escrita só ao atingir esse tamanho (padrão 0 = off)
+    //       "batch_us": prazo máximo de uma mensagem no buffer antes do flush (padrão 200 us)
+    //       "splice_min": com framing binary, mensagens a partir desse tamanho vão ao pipe por
+    //                     vmsplice (sem cópia no pai; o send espera o filho ler o payload)
+    //                     (Linux; padrão 1 MiB, 0 = sempre write)
+    //       "workers": quantos processos filhos (padrão 1), cada um com seu par de pipes
+    //       "dispatch": "round_robin" (padrão) | "least_outstanding" | "hash" (pela "key" do send)
+    //       "work_us": custo de CPU simulado por mensagem no filho (padrão 0)
+    //       "inflight": máximo de pedidos sem resposta; o send espera vaga (padrão 0 = sem limite)
+    bool start(const json& opts = json::object());
     void stop();
-    bool send(const std::string& message);
+    // key: usada no despacho "hash" (vazia = o próprio texto); mesma key, mesmo filho
+    // id: correlação devolvida no "received" junto com o rtt_us (0 = o módulo numera)
+    bool send(const std::string& message, const std::string& key = std::string(), uint64_t id = 0);
+    bool flush(); // esvazia os buffers de coalescência agora (no-op sem batching)
     std::string get_status() const;
+    json status_json() const; // contadores por filho + distribuição de tamanho dos lotes
     bool is_running() const;
+    InflightWindow& inflight() { return inflight_; } // pedidos em voo (contagem/RTT para o ra1_ipc_bench)
+    const LatencyStats& latency() const { return latency_; } // histograma de RTT e vazão (status)
+    const TransportCounters& counters() const { return counters_; } // contadores do comando metrics
+
+    // Modo filho (processo "pipe_child"): eco de stdin para stdout no enquadramento pedido
+    static int run_child(FrameMode mode, CodecKind codec, int work_us = 0);
 
 private:
     void cleanup();
     void reader_thread();
+    PipeWorker* pick_worker(const std::string& message, const std::string& key); // nullptr = nenhum filho vivo
+    void log_error(const std::string& where, const std::string& what); // evento de erro (stderr) + contador
+
+    // Coalescência de escritas (batch_bytes > 0)
+    enum class FlushReason { size, timer, explicit_ };
+    static constexpr size_t BATCH_BUCKETS = 8; // mensagens por lote: 1, 2-3, 4-7, ..., 128+
+    bool flush_batch(PipeWorker& w, FlushReason reason);
+    bool flush_all(FlushReason reason);
+    void flusher_thread();
+    bool send_large(PipeWorker& w, const std::string& message, uint64_t seq, size_t& frame_bytes);
+    void emit_sent(PipeWorker& w, const std::string& message, size_t frame_bytes, uint64_t seq, uint64_t sent_ns);
 
     IPCManager* manager_;
-    bool running_;
-    bool reader_running_;
-    int messages_sent_;
-    int messages_received_;
-    void* read_pipe_;      // HANDLE para leitura
-    void* write_pipe_;     // HANDLE para escrita
-    void* child_process_;  // HANDLE para processo filho
-    std::thread reader_thread_;
+    std::atomic<bool> running_;
+    std::atomic<bool> reader_running_;
+    std::atomic<int> messages_sent_;     // send() de várias threads
+    std::atomic<int> messages_received_; // thread leitora
+    FrameMode framing_;
+    CodecKind codec_;
+    std::vector<std::unique_ptr<PipeWorker>> workers_; // pipes + processos filhos
+    PipeDispatch dispatch_;
+    std::atomic<size_t> next_worker_; // cursor do round_robin (send() pode vir de várias threads)
+    std::thread reader_thread_;       // um leitor para todos os filhos (pipe_poll)
+
+    size_t batch_bytes_;
+    std::chrono::microseconds batch_delay_;
+    mutable std::mutex batch_mutex_;  // protege os lotes dos filhos e as estatísticas
+    std::condition_variable batch_cv_;
+    bool flusher_running_;
+    std::thread flusher_thread_;
+    uint64_t flushes_[3];             // por FlushReason
+    std::array<uint64_t, BATCH_BUCKETS> batch_hist_;
+
+    size_t splice_min_;
+
+    InflightWindow inflight_;         // id de correlação -> envio (seq do quadro no framing binary)
+    LatencyStats latency_;            // gravado pela leitora, lido pelo status sem lock
+    TransportCounters counters_;      // vida do processo, lidos pelo metrics sem lock
 };
 
 #endif // PIPE_MODULE_HPP
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Primitivas de pipe anônimo usadas pelo PipeModule: CreatePipe/CreateProcess/ReadFile
+// no Windows, pipe2/posix_spawn/read no Linux. O filho é o próprio binário ("pipe_child")
+// com stdin/stdout ligados aos pipes.
+
+#ifdef _WIN32
+using PipeHandle = HANDLE;
+inline const PipeHandle INVALID_PIPE = nullptr;
+#else
+using PipeHandle = int;
+constexpr PipeHandle INVALID_PIPE = -1;
+#endif
+
+struct PipeChild {
+    unsigned long pid{ 0 };
+    PipeHandle to_child{ INVALID_PIPE };   // pai escreve -> stdin do filho
+    PipeHandle from_child{ INVALID_PIPE }; // stdout (e stderr) do filho -> pai lê
+    size_t pipe_bytes{ 0 };                // capacidade efetiva do pipe (0 = desconhecida)
+#ifdef _WIN32
+    HANDLE process{ nullptr };
+#endif
+};
+
+// Cria os dois pipes e reexecuta o binário com 'args'. pipe_bytes > 0 pede essa
+// capacidade (Linux: F_SETPIPE_SZ, limitado por /proc/sys/fs/pipe-max-size; Windows: nSize)
+bool spawn_pipe_child(const std::vector<std::string>& args, size_t pipe_bytes, PipeChild& out, std::string& err);
+// Fecha os pipes do pai (o filho vê EOF e sai), espera até timeout_ms e então encerra à força
+void close_pipe_child(PipeChild& child, int timeout_ms);
+
+// Lado do filho: stdin/stdout sem buffer do CRT nem tradução de CRLF
+PipeHandle pipe_stdin();
+PipeHandle pipe_stdout();
+
+// > 0 bytes lidos; 0 = EOF (pipe fechado do outro lado); < 0 = erro (pipe_last_error)
+long pipe_read(PipeHandle h, void* buf, size_t n);
+// Escreve tudo (repete em escritas parciais); false = erro/pipe quebrado
+bool pipe_write_all(PipeHandle h, const void* data, size_t n);
+// Espera algum dos pipes ter dados (ou EOF) por até timeout_ms (-1 = sem prazo).
+// ready[i] = 1 para os prontos; devolve quantos (0 = prazo esgotado, < 0 = erro).
+// Linux: poll; Windows: PeekNamedPipe em volta (pipes anônimos não têm espera múltipla)
+int pipe_poll(const std::vector<PipeHandle>& hs, std::vector<char>& ready, int timeout_ms);
+void pipe_close(PipeHandle& h);
+int pipe_last_error();
+
+// Escrita de payloads grandes por vmsplice (Linux), direto da memória de quem chama: o
+// pipe recebe referências às páginas, sem cópia no escritor. Como as páginas são
+// emprestadas, write() só volta com o pipe vazio (o leitor já consumiu tudo) e então o
+// buffer pode ser reescrito ou liberado. O leitor precisa copiar (read) ou descartar os
+// bytes: repassá-los por splice para outro pipe estenderia o empréstimo além desse ponto
+// (por isso o pipe_child lê o payload em vez de ecoá-lo por splice).
+// false depois de o vmsplice começar (erro no meio ou leitor parado por 5 s) deixa páginas
+// de data ainda no pipe: antes de reusar ou liberar o buffer, quem chama precisa matar o
+// leitor (close_pipe_child com prazo 0) e tirar o pipe de serviço.
+// Windows ou kernel sem vmsplice: write comum.
+class PipeSplicer {
+public:
+    // pipe_bytes = capacidade efetiva do pipe (PipeChild::pipe_bytes); 0 = só write
+    void reset(size_t pipe_bytes);
+    bool write(PipeHandle h, const void* data, size_t n);
+    bool active() const { return active_; }
+    uint64_t spliced_bytes() const { return spliced_; }
+
+private:
+    bool active_{ false };
+    uint64_t spliced_{ 0 };
+};
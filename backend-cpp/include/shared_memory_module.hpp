@@ -1,11 +1,19 @@
 ﻿#pragma once
-#include <windows.h>
 #include <string>
 #include <atomic>
 #include <thread>
 #include <mutex>
 #include <cstdint>
+#include <span>
+#include <string_view>
 #include <nlohmann/json.hpp>
+#include "shm_platform.hpp"
+#include "shm_ring.hpp"
+#include "inflight_window.hpp"
+#include "latency_stats.hpp"
+#include "metrics.hpp"
+#include "ipc_frame.hpp"
+#include "message_codec.hpp"
 
 class IPCManager; // fwd
 
@@ -14,32 +22,79 @@ public:
     explicit SharedMemoryModule(IPCManager* manager);
     ~SharedMemoryModule();
 
-    bool start();                       // cria mapeamento + eventos + threads
-    bool send(const std::string& msg);  // escreve no buffer P→C e sinaliza evento
+    // opts (campos do comando start):
+    //   "mode": "thread" (eco numa thread local, padrão) | "process" (filho real via shm_child)
+    //   "child_cpu" / "reader_cpu": fixa o filho / a thread leitora num núcleo
+    //   "wait": "block" (padrão) | "spin" (pause + backoff, depois bloqueia) | "busy" (nunca bloqueia)
+    //   "spin_iters": orçamento de pausas da fase de spin (padrão 4096)
+    //   "codec": "json" (padrão) | "binary" (message_codec.hpp) entre os dois lados do anel
+    //   "inflight": pedidos sem eco antes de send() esperar vaga (padrão 0 = sem limite)
+    bool start(const nlohmann::json& opts = nlohmann::json::object()); // cria mapeamento + eventos + threads
+    // Escreve no anel P→C e sinaliza (mensagens grandes vão fragmentadas). id: correlação
+    // (seq do registro) devolvida no eco com o rtt_us; 0 = o módulo numera
+    bool send(const std::string& msg, uint64_t id = 0);
     void stop();                        // encerra threads/handles e emite "stopped"
     nlohmann::json status_json() const; // opcional: usado pelo IPCManager
     bool is_running() const;            // ADICIONADO: método para verificar se está rodando
+    InflightWindow& inflight() { return inflight_; } // pedidos em voo (contagem/RTT para o ra1_ipc_bench)
+    const LatencyStats& latency() const { return latency_; } // histograma de RTT e vazão (status)
+    const TransportCounters& counters() const { return counters_; } // contadores do comando metrics
 
-private:
-    // Layout do mapeamento: dois canais fixos, protocolo [u32 len][payload]
-    static constexpr size_t SHM_MAX_MSG = 32 * 1024; // 32 KiB por canal
+    // Zero-copy (mesma thread que chama send): o produtor serializa direto no anel P→C.
+    // reserve(n) toma a vaga na janela de pedidos em voo (pode esperar, como o send) e
+    // devolve um span dentro do mapeamento (vazio = janela ou anel cheio, ou
+    // n > max_record_bytes()); id: correlação, como no send (0 = o módulo numera).
+    // commit(n) publica os n primeiros bytes escritos (n <= o reservado; maior é recusado
+    // e a reserva continua aberta), conta a mensagem, emite o "sent" e sinaliza o consumidor. Um reserve()
+    // novo sem commit descarta a reserva anterior e devolve a vaga dela.
+    // Os bytes vão como estão, sem passar pelo codec: com "codec": "binary" o payload
+    // precisa ser um Message já codificado (MessageCodec(codec()).encode), como o send
+    // faz; com "json", o texto cru ou {"text": ...}.
+    std::span<char> reserve(size_t n, uint64_t id = 0);
+    bool commit(size_t n);
+    size_t max_record_bytes() const;
+    CodecKind codec() const { return ctl_ ? ctl_->codec : CodecKind::json; }
+
+    // Modo filho (processo "shm_child"): anexa ao mapeamento/eventos do pai pelo nome e roda o eco
+    int run_child(unsigned long parent_pid, int cpu = -1);
 
-#pragma pack(push, 1)
-    struct Channel {
-        volatile uint32_t len;                 // 0 = vazio; >0 = bytes válidos em data
-        char data[SHM_MAX_MSG];                // payload (JSON line)
+private:
+    // Bloco de controle no início do mapeamento (visível aos dois processos)
+    struct ShmControl {
+        alignas(ShmRing::CACHE_LINE) std::atomic<uint32_t> stop;     // 1 = pai pediu parada
+        std::atomic<uint32_t> child_pid;                             // preenchido pelo filho ao anexar
+        ShmWaitStrategy wait_strategy;                               // fixados pelo pai antes do filho anexar
+        uint32_t spin_iters;
+        CodecKind codec;
+        ShmSignalBlock p2c;
+        ShmSignalBlock c2p;
     };
-    struct ShmLayout {
-        Channel p2c; // Parent -> Child
-        Channel c2p; // Child  -> Parent
+
+    // Layout do mapeamento: controle + dois anéis SPSC (P→C e C→P), um após o outro
+    static constexpr size_t SHM_RING_BYTES = 1024 * 1024; // 1 MiB de dados por direção
+    static constexpr size_t SHM_MAP_BYTES = sizeof(ShmControl) + 2 * ShmRing::footprint(SHM_RING_BYTES);
+
+    // Cada registro do anel carrega um quadro comum (ipc_frame.hpp): cabeçalho + payload.
+    // Mensagens maiores que um registro atravessam o anel em fragmentos com o mesmo seq:
+    // [FRAME_FRAG_BEGIN: u64 tamanho total] [chunk | FRAME_FRAG_MORE] ... [último chunk]
+    static constexpr size_t SHM_CHUNK_BYTES = SHM_RING_BYTES / 4;
+    static constexpr size_t SHM_EVENT_TEXT_MAX = 64 * 1024; // acima disso o "text" dos eventos é cortado
+
+    // Estado de remontagem do lado consumidor
+    struct Reassembly {
+        std::string buf;
+        uint64_t seq{ 0 };
+        bool active{ false };
     };
-#pragma pack(pop)
 
     // helpers
-    std::wstring make_name(const wchar_t* base) const;
-    void clear_channel(Channel& ch);
-    bool write_channel(Channel& ch, const std::string& s);
-    std::string read_channel(Channel& ch);
+    bool attach(bool create, unsigned long owner_pid); // mapeamento + sinais (pai cria, filho abre)
+    void detach();
+    bool wait(ShmSignal& s);        // false = parada solicitada
+    bool stop_requested() const;
+    ShmRing::PushResult push_message(ShmRing* ring, ShmSignal& sig, uint64_t seq, const std::string& data, bool wait_if_full);
+    bool next_message(ShmRing* ring, Reassembly& r, ShmRecordView& view, std::string_view& msg, uint64_t& seq);
+    static std::string_view clip_text(std::string_view text); // "text" dos eventos (SHM_EVENT_TEXT_MAX)
 
     // threads
     void child_echo_loop();    // "lado filho": espera P→C e responde em C→P (ECHO)
@@ -47,34 +102,40 @@ private:
 
     // eventos JSON
     nlohmann::json base_event(const std::string& type) const;
-    void log_json(const nlohmann::json& j) const;
-    void log_error(const std::string& where, const std::string& what) const;
+    void log_json(const nlohmann::json& j, bool data = false) const; // data: sent/received (event_sink.hpp)
+    void log_error(const std::string& where, const std::string& what); // evento de erro + contador
+    void log_sent(uint64_t seq, uint64_t sent_ns, std::string_view msg); // "sent" de send() e commit()
 
 private:
     IPCManager* manager_{ nullptr };
 
     std::atomic<bool> running_{ false };
+    bool process_mode_{ false };
 
-    // Identificadores do OS
-    HANDLE hMap_{ nullptr };
-    ShmLayout* layout_{ nullptr };
-
-    // Eventos (auto-reset): quem escreve sinaliza para o outro lado
-    HANDLE ev_p2c_{ nullptr };  // Parent sinaliza para Child
-    HANDLE ev_c2p_{ nullptr };  // Child sinaliza para Parent
-    HANDLE ev_stop_{ nullptr }; // sinalização de parada interna
+    // Mapeamento nomeado (sufixado pelo PID do pai; o filho reconstrói o nome a partir do PID)
+    ShmRegion region_;
+    ShmControl* ctl_{ nullptr };
+    ShmRing* p2c_{ nullptr }; // Parent -> Child
+    ShmRing* c2p_{ nullptr }; // Child  -> Parent
+    char* reserved_{ nullptr }; // cabeçalho do quadro reservado por reserve(), preenchido em commit()
+    size_t reserved_len_{ 0 };  // payload reservado: teto do commit()
+    uint64_t reserved_seq_{ 0 }; // vaga da janela tomada no reserve()
+    uint64_t reserved_sent_ns_{ 0 }; // instante do reserve(): o sent_ns do evento "sent"
+    std::string send_buf_;      // mensagem codificada por send() (codec binary), reaproveitada
 
-    // Nomes (para potencial evolução p/ multi-processo)
-    std::wstring map_name_;
-    std::wstring ev_p2c_name_;
-    std::wstring ev_c2p_name_;
-    std::wstring ev_stop_name_;
+    ShmSignal sig_p2c_;  // Parent sinaliza para Child
+    ShmSignal sig_c2p_;  // Child sinaliza para Parent
 
-    // Threads
+    // Lado "filho": processo shm_child (mode=process) ou thread local
+    ChildProcess child_;
     std::thread child_thread_;
     std::thread reader_thread_;
 
     // Métricas simples
     std::atomic<int> messages_sent_{ 0 };
     std::atomic<int> messages_received_{ 0 };
+    std::atomic<int> send_full_{ 0 };   // send() recusado por anel cheio (backpressure)
+    InflightWindow inflight_;           // seq do registro -> envio; o eco devolve o mesmo seq
+    LatencyStats latency_;              // gravado pela leitora, lido pelo status sem lock
+    TransportCounters counters_;        // vida do processo, lidos pelo metrics sem lock
 };
\ No newline at end of file
@@ -0,0 +1,128 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "shm_platform.hpp"
+#include "shm_ring.hpp"
+#include "metrics.hpp"
+
+class IPCManager; // fwd
+
+// Hub de memória compartilhada: um único mapeamento com um registro de N slots de
+// cliente, cada um com seu par de anéis SPSC (requisição C→S, resposta S→C).
+// Os clientes são processos independentes ("shm_hub_client <pid_do_hub> ..."): tomam um
+// slot livre por CAS, escrevem no anel de requisição e tocam a "campainha" (doorbell)
+// da thread servidora dona do slot. Cada campainha é um bitmap de slots pendentes +
+// um sinal, então poucas threads atendem todos os clientes sem varrer slot por slot.
+class ShmHub {
+public:
+    static constexpr uint32_t HUB_MAX_CLIENTS = 128;
+    static constexpr uint32_t HUB_MAX_THREADS = 8;
+    static constexpr size_t HUB_RING_BYTES = 64 * 1024; // por direção, por slot
+
+    explicit ShmHub(IPCManager* manager);
+    ~ShmHub();
+
+    // opts (campos do comando start):
+    //   "clients": processos cliente lançados pelo backend (padrão 4, 0 = só aguarda clientes externos)
+    //   "threads": threads servidoras / campainhas (padrão 1, máx. HUB_MAX_THREADS)
+    //   "messages" / "size": requisições por cliente e bytes de cada uma (padrão 1000 / 64;
+    //                        acima de um registro do anel menos o "ECHO: " o start é recusado)
+    //   "wait" / "spin_iters": estratégia de espera, como no mecanismo "shm"
+    bool start(const nlohmann::json& opts = nlohmann::json::object());
+    bool send(const std::string& msg);  // não suportado: o hub é dirigido pelos clientes
+    void stop();
+    nlohmann::json status_json() const; // totais + métricas por cliente
+    bool is_running() const;
+    // Contadores do comando metrics, do lado servidor: received = requisições lidas dos
+    // anéis, sent = ecos escritos. Sem RTT nem janela aqui: quem mede é o cliente.
+    const TransportCounters& counters() const { return counters_; }
+
+    // Modo cliente (processo "shm_hub_client"): anexa ao hub, toma um slot e faz
+    // 'messages' requisições de 'size' bytes, medindo a latência de ida e volta
+    int run_client(unsigned long hub_pid, uint32_t messages, size_t size);
+
+private:
+    // ABANDONED: o processo dono morreu com o slot ACTIVE; quem tenta anexar e não acha
+    // slot livre marca e toca a campainha, e a thread dona devolve o slot como no DONE
+    enum SlotState : uint32_t { SLOT_FREE = 0, SLOT_ACTIVE = 1, SLOT_DONE = 2, SLOT_ABANDONED = 3 };
+
+    // Campainha de uma thread servidora: bit i = slot i tem requisições pendentes
+    struct HubDoorbell {
+        ShmSignalBlock sig;
+        alignas(ShmRing::CACHE_LINE) std::atomic<uint64_t> pending[HUB_MAX_CLIENTS / 64];
+    };
+
+    // Registro de um cliente. As métricas são escritas só pelo cliente (cada uma na sua
+    // linha de cache, longe do contador do servidor) e lidas pelo status.
+    struct HubSlot {
+        alignas(ShmRing::CACHE_LINE) std::atomic<uint32_t> state;
+        std::atomic<uint32_t> pid;
+        ShmSignalBlock resp;                          // servidor → cliente
+        alignas(ShmRing::CACHE_LINE) std::atomic<uint64_t> requests;
+        std::atomic<uint64_t> bytes;
+        std::atomic<uint64_t> rtt_sum_ns;
+        std::atomic<uint64_t> rtt_max_ns;
+        std::atomic<uint64_t> t_first_ns;             // relógio monotônico do sistema
+        std::atomic<uint64_t> t_last_ns;
+        alignas(ShmRing::CACHE_LINE) std::atomic<uint64_t> served; // escrito pelo servidor
+    };
+
+    struct HubHeader {
+        alignas(ShmRing::CACHE_LINE) std::atomic<uint32_t> stop;
+        std::atomic<uint32_t> clients_attached;
+        uint32_t threads;                             // fixados antes de qualquer cliente anexar
+        ShmWaitStrategy wait_strategy;
+        uint32_t spin_iters;
+        HubDoorbell bells[HUB_MAX_THREADS];
+        HubSlot slots[HUB_MAX_CLIENTS];
+    };
+
+    // Layout: cabeçalho + (req, resp) de cada slot, um após o outro
+    static constexpr size_t HUB_MAP_BYTES = sizeof(HubHeader) + 2 * HUB_MAX_CLIENTS * ShmRing::footprint(HUB_RING_BYTES);
+    static constexpr size_t HUB_ECHO_PREFIX = 6; // "ECHO: "
+    // Maior requisição cujo eco ainda cabe num registro do anel de resposta
+    static constexpr size_t HUB_MAX_SIZE = HUB_RING_BYTES / 2 - ShmRing::RECORD_HEADER - HUB_ECHO_PREFIX;
+
+    // helpers
+    bool attach(bool create, unsigned long hub_pid);
+    void detach();
+    ShmRing* req_ring(uint32_t slot) const;
+    ShmRing* resp_ring(uint32_t slot) const;
+
+    // threads servidoras
+    void server_loop(uint32_t index);
+    bool serve_slot(uint32_t slot);   // false = anel de resposta cheio (tentar depois)
+    void report_client(uint32_t slot);
+    void release_slot(uint32_t slot); // depois do client_done: drena os anéis e devolve o slot
+    uint32_t reclaim_dead_slots(unsigned long hub_pid); // lado cliente: ACTIVE de dono morto -> ABANDONED
+
+    nlohmann::json slot_json(uint32_t slot) const;
+
+    // eventos JSON
+    nlohmann::json base_event(const std::string& type) const;
+    void log_json(const nlohmann::json& j) const;
+    void log_error(const std::string& where, const std::string& what); // evento de erro + contador
+
+private:
+    IPCManager* manager_{ nullptr };
+    std::atomic<bool> running_{ false };
+
+    ShmRegion region_;
+    HubHeader* hdr_{ nullptr };
+
+    std::array<ShmSignal, HUB_MAX_THREADS> bells_;
+    std::array<ShmSignal, HUB_MAX_CLIENTS> resp_sigs_;
+    std::array<bool, HUB_MAX_CLIENTS> reported_{}; // client_done já emitido (só a thread dona escreve)
+
+    std::vector<std::thread> server_threads_;
+    std::vector<ChildProcess> children_;
+    std::atomic<uint32_t> clients_done_{ 0 };
+    std::atomic<uint32_t> clients_spawned_{ 0 };
+    std::atomic<uint64_t> requests_released_{ 0 }; // requisições de slots já devolvidos (status)
+    TransportCounters counters_;                   // vida do processo, lidos pelo metrics sem lock
+};
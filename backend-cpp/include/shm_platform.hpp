@@ -0,0 +1,109 @@
+#pragma once
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "shm_ring.hpp"
+
+// Primitivas de SO usadas pelos mecanismos de memória compartilhada (SharedMemoryModule
+// e ShmHub): mapeamento nomeado, sinalização entre processos e processos filhos.
+
+unsigned long current_pid();
+void pin_current_thread(int cpu); // ignora cpu < 0
+
+// ---------------------- Mapeamento nomeado ----------------------
+
+// Windows: CreateFileMapping/OpenFileMapping. Linux: shm_open + mmap (o criador faz unlink).
+class ShmRegion {
+public:
+    ShmRegion() = default;
+    ShmRegion(const ShmRegion&) = delete;
+    ShmRegion& operator=(const ShmRegion&) = delete;
+    ~ShmRegion() { close(); }
+
+    bool create(const std::string& name, size_t bytes, std::string& err);
+    bool open(const std::string& name, size_t bytes, std::string& err);
+    void close();
+
+    void* data() const { return view_; }
+    size_t size() const { return bytes_; }
+
+private:
+    std::string name_;
+    size_t bytes_{ 0 };
+    void* view_{ nullptr };
+    bool owner_{ false };
+#ifdef _WIN32
+    HANDLE map_{ nullptr };
+#else
+    int fd_{ -1 };
+#endif
+};
+
+// Nome PID-sufixado de um objeto nomeado ("Local\..." no Windows, "/..." no Linux)
+std::string shm_object_name(const std::string& base, unsigned long owner_pid);
+
+// ---------------------- Sinalização ----------------------
+
+enum class ShmWaitStrategy : uint32_t { block, spin, busy };
+ShmWaitStrategy parse_wait_strategy(const std::string& name);
+const char* wait_strategy_name(ShmWaitStrategy s);
+
+// "Evento" de uma direção, dentro do mapeamento
+struct ShmSignalBlock {
+    alignas(ShmRing::CACHE_LINE) std::atomic<uint32_t> seq;     // produtor incrementa (futex no Linux)
+    std::atomic<uint32_t> waiters;                               // consumidor bloqueado? (evita syscall)
+    alignas(ShmRing::CACHE_LINE) std::atomic<uint64_t> spin_wakeups;  // escritos só pelo consumidor
+    std::atomic<uint64_t> block_wakeups;
+};
+
+// Lado local de um ShmSignalBlock. Semântica "auto-reset": wait() retorna assim que seq
+// mudar desde a última espera. Windows usa um evento nomeado; Linux um futex na própria palavra.
+class ShmSignal {
+public:
+    ShmSignal() = default;
+    ShmSignal(const ShmSignal&) = delete;
+    ShmSignal& operator=(const ShmSignal&) = delete;
+    ~ShmSignal() { detach(); }
+
+    bool attach(ShmSignalBlock* blk, const std::string& event_name, std::string& err);
+    void detach();
+
+    void notify();   // produtor: publica e acorda o consumidor só se ele estiver bloqueado
+    void kick();     // acorda incondicionalmente (parada)
+
+    // false = *stop != 0. Conta wake-ups resolvidos em spin vs. bloqueio em blk.
+    bool wait(ShmWaitStrategy strategy, uint32_t spin_iters, const std::atomic<uint32_t>& stop);
+
+    ShmSignalBlock* block() const { return blk_; }
+
+private:
+    bool spin_until_changed(uint32_t budget, const std::atomic<uint32_t>& stop);
+    void block_until_changed(const std::atomic<uint32_t>& stop);
+
+    ShmSignalBlock* blk_{ nullptr };
+    uint32_t seen_{ 0 }; // último valor observado pelo lado que espera
+#ifdef _WIN32
+    HANDLE ev_{ nullptr };
+#endif
+};
+
+// ---------------------- Processos filhos ----------------------
+
+// Reexecuta o próprio binário com 'args' (ex.: {"shm_child", "<pid>"}), como o pipe_child
+struct ChildProcess {
+    unsigned long pid{ 0 };
+#ifdef _WIN32
+    HANDLE handle{ nullptr };
+#endif
+};
+
+bool spawn_self(const std::vector<std::string>& args, ChildProcess& out, std::string& err);
+// Espera o filho sair por até timeout_ms; depois encerra à força
+void reap_child(ChildProcess& child, int timeout_ms);
+// O processo 'pid' ainda roda? Zumbi (saiu e não foi colhido) conta como encerrado
+bool process_alive(unsigned long pid);
@@ -0,0 +1,214 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <string_view>
+
+// Anel SPSC (um produtor / um consumidor) de registros de tamanho variável.
+// Vive inteiro dentro do mapeamento compartilhado: cabeçalho + bytes de dados
+// logo em seguida. Formato de cada registro: [u32 len][u32 flags][payload][pad até 8].
+//
+// - head: posição (monotônica) publicada pelo produtor (release) e lida pelo consumidor (acquire)
+// - tail: posição (monotônica) liberada pelo consumidor (release) e lida pelo produtor (acquire)
+// Cada um fica em sua própria linha de cache, junto com a cópia "cacheada" do índice
+// do outro lado, para evitar false sharing e leituras remotas desnecessárias.
+class ShmRing {
+public:
+    static constexpr size_t CACHE_LINE = 64;
+    static constexpr size_t RECORD_HEADER = 8;
+    static constexpr uint32_t FLAG_WRAP = 0x80000000u; // marcador: pule até o início do anel
+
+    enum class PushResult { ok, full, too_large };
+
+    // Bytes ocupados no mapeamento por um anel com 'capacity' bytes de dados
+    static constexpr size_t footprint(size_t capacity) {
+        return sizeof(ShmRing) + capacity;
+    }
+
+    // Inicializa (placement new) um anel vazio em 'mem'. capacity deve ser potência de 2.
+    static ShmRing* create(void* mem, size_t capacity) {
+        return new (mem) ShmRing(capacity);
+    }
+
+    // Maior payload aceito num único registro (garante que sempre cabe após um wrap)
+    size_t max_payload() const { return capacity_ / 2 - RECORD_HEADER; }
+    size_t capacity() const { return capacity_; }
+
+    // ---------------- lado produtor ----------------
+    // Zero-copy: reserva n bytes contíguos dentro do anel e devolve onde escrever.
+    // nullptr = cheio (tente de novo) ou grande demais (why informa). Nada fica visível
+    // ao consumidor até commit().
+    char* reserve(size_t n, PushResult* why = nullptr) {
+        if (n > max_payload()) {
+            if (why) *why = PushResult::too_large;
+            return nullptr;
+        }
+
+        const uint64_t need = align8(RECORD_HEADER + n);
+        const uint64_t h = prod_.head.load(std::memory_order_relaxed);
+        const uint64_t idx = h & (capacity_ - 1);
+        const uint64_t rem = capacity_ - idx;
+        const uint64_t total = need <= rem ? need : rem + need;
+
+        if (h - prod_.cached_tail + total > capacity_) {
+            prod_.cached_tail = cons_.tail.load(std::memory_order_acquire);
+            if (h - prod_.cached_tail + total > capacity_) {
+                if (why) *why = PushResult::full;
+                return nullptr;
+            }
+        }
+
+        uint64_t pos = h;
+        if (need > rem) {
+            write_header(idx, 0, FLAG_WRAP);
+            pos += rem;
+        }
+        prod_.reserved_at = pos;
+        if (why) *why = PushResult::ok;
+        return buf() + (pos & (capacity_ - 1)) + RECORD_HEADER;
+    }
+
+    // Publica os n primeiros bytes da última reserva (n <= bytes reservados)
+    void commit(size_t n, uint32_t flags = 0) {
+        const uint64_t pos = prod_.reserved_at;
+        write_header(pos & (capacity_ - 1), static_cast<uint32_t>(n), flags);
+        prod_.head.store(pos + align8(RECORD_HEADER + n), std::memory_order_release);
+    }
+
+    // Cópia única: reserve + memcpy + commit
+    PushResult push(const void* src, size_t n, uint32_t flags = 0) {
+        PushResult r;
+        char* dst = reserve(n, &r);
+        if (!dst) return r;
+        if (n) std::memcpy(dst, src, n);
+        commit(n, flags);
+        return PushResult::ok;
+    }
+
+    // ---------------- lado consumidor ----------------
+    bool empty() const {
+        return cons_.tail.load(std::memory_order_relaxed) == prod_.head.load(std::memory_order_acquire);
+    }
+
+    // Empresta o próximo registro sem copiar (válido até release()). false = anel vazio.
+    bool peek(const char*& data, uint32_t& len, uint32_t& flags) {
+        uint64_t t = cons_.tail.load(std::memory_order_relaxed);
+        if (t == cons_.cached_head) {
+            cons_.cached_head = prod_.head.load(std::memory_order_acquire);
+            if (t == cons_.cached_head) return false;
+        }
+
+        uint64_t idx = t & (capacity_ - 1);
+        read_header(idx, len, flags);
+        if (flags & FLAG_WRAP) {
+            // o produtor publica marcador + registro juntos: há um registro no início
+            t += capacity_ - idx;
+            idx = 0;
+            read_header(idx, len, flags);
+        }
+
+        data = buf() + idx + RECORD_HEADER;
+        cons_.peek_next = t + align8(RECORD_HEADER + len);
+        return true;
+    }
+
+    // Devolve ao produtor o espaço do registro obtido no último peek()
+    void release() {
+        cons_.tail.store(cons_.peek_next, std::memory_order_release);
+    }
+
+    // Copia o próximo registro para 'out'. Retorna false se o anel estiver vazio.
+    bool pop(std::string& out, uint32_t* flags = nullptr) {
+        const char* data;
+        uint32_t len, f;
+        if (!peek(data, len, f)) return false;
+        out.assign(data, len);
+        if (flags) *flags = f;
+        release();
+        return true;
+    }
+
+private:
+    explicit ShmRing(size_t capacity) : capacity_(capacity) {
+        prod_.head.store(0, std::memory_order_relaxed);
+        prod_.cached_tail = 0;
+        prod_.reserved_at = 0;
+        cons_.tail.store(0, std::memory_order_relaxed);
+        cons_.cached_head = 0;
+        cons_.peek_next = 0;
+    }
+
+    static constexpr uint64_t align8(uint64_t v) { return (v + 7) & ~uint64_t(7); }
+
+    char* buf() { return reinterpret_cast<char*>(this) + sizeof(ShmRing); }
+
+    void write_header(uint64_t at, uint32_t len, uint32_t flags) {
+        std::memcpy(buf() + at, &len, 4);
+        std::memcpy(buf() + at + 4, &flags, 4);
+    }
+    void read_header(uint64_t at, uint32_t& len, uint32_t& flags) {
+        std::memcpy(&len, buf() + at, 4);
+        std::memcpy(&flags, buf() + at + 4, 4);
+    }
+
+    // Linha do produtor: só ele escreve aqui
+    struct alignas(CACHE_LINE) ProducerLine {
+        std::atomic<uint64_t> head;
+        uint64_t cached_tail;
+        uint64_t reserved_at; // posição do registro aberto por reserve()
+    };
+    // Linha do consumidor: só ele escreve aqui
+    struct alignas(CACHE_LINE) ConsumerLine {
+        std::atomic<uint64_t> tail;
+        uint64_t cached_head;
+        uint64_t peek_next; // tail após o registro emprestado por peek()
+    };
+
+    ProducerLine prod_;
+    ConsumerLine cons_;
+    alignas(CACHE_LINE) uint64_t capacity_; // somente leitura após create()
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free,
+        "ShmRing exige atomics de 64 bits lock-free (compartilhados entre processos)");
+};
+
+static_assert(sizeof(ShmRing) % ShmRing::CACHE_LINE == 0, "dados do anel devem começar alinhados");
+
+// Visão emprestada (zero-copy) de um registro do anel: os bytes continuam no
+// mapeamento até release() (ou o destrutor). Só o consumidor do anel pode usar.
+class ShmRecordView {
+public:
+    ShmRecordView() = default;
+    ShmRecordView(const ShmRecordView&) = delete;
+    ShmRecordView& operator=(const ShmRecordView&) = delete;
+    ~ShmRecordView() { release(); }
+
+    // Empresta o próximo registro de 'ring'. false = anel vazio.
+    bool acquire(ShmRing& ring) {
+        release();
+        const char* data;
+        uint32_t len, flags;
+        if (!ring.peek(data, len, flags)) return false;
+        ring_ = &ring;
+        bytes_ = std::string_view(data, len);
+        flags_ = flags;
+        return true;
+    }
+
+    void release() {
+        if (ring_) ring_->release();
+        ring_ = nullptr;
+        bytes_ = {};
+    }
+
+    std::string_view bytes() const { return bytes_; }
+    uint32_t flags() const { return flags_; }
+
+private:
+    ShmRing* ring_{ nullptr };
+    std::string_view bytes_;
+    uint32_t flags_{ 0 };
+};
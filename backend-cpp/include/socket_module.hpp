@@ -2,10 +2,19 @@
 #include <string>
 #include <atomic>
 #include <thread>
-#include <winsock2.h>
-#include <ws2tcpip.h>
 #include <nlohmann/json.hpp>
 #include <mutex>                  // ADICIONADO: para proteger o socket do listener
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "inflight_window.hpp"
+#include "latency_stats.hpp"
+#include "metrics.hpp"
+#include "ipc_frame.hpp"
+#include "message_codec.hpp"
+#include "socket_platform.hpp"
 
 class IPCManager;
 
@@ -14,28 +23,89 @@ public:
     SocketModule(IPCManager* manager);
     ~SocketModule();
 
-    bool start();
-    bool send(const std::string& message);
+    // opts (campos do comando start):
+    //   "connections": conexões persistentes do lado remetente (padrão 1; >1 não preserva a ordem)
+    //   "window": linhas enviadas sem ACK por conexão antes de send() bloquear (padrão 64;
+    //             sem ACK em 2 s o send() falha e a conexão segue aberta)
+    //   "inflight": pedidos sem eco (somando as conexões) antes de send() bloquear (padrão 0 = sem limite)
+    //   "loop_threads": threads do loop de eventos do servidor (padrão 1; Linux: SO_REUSEPORT)
+    //   "transport": "tcp" (padrão, porta "port" = 7070) | "unix" (AF_UNIX em "path"; "@nome" = abstrato)
+    //   "framing": "line" (padrão, mensagem + '\n') | "binary" (quadros com tamanho, ver ipc_frame.hpp)
+    //   "codec": "json" (padrão) | "binary" (message_codec.hpp; implica framing binary)
+    bool start(const nlohmann::json& opts = nlohmann::json::object());
+    // Escreve numa conexão do pool, sem esperar o ACK. id: correlação devolvida no eco
+    // ("received" com id e rtt_us); 0 = o módulo numera
+    bool send(const std::string& message, uint64_t id = 0);
     void stop();
     bool is_connected() const;
     bool is_running() const;
+    InflightWindow& inflight() { return inflight_; } // pedidos em voo (contagem/RTT para o ra1_ipc_bench)
+    const LatencyStats& latency() const { return latency_; } // histograma de RTT e vazão (status)
+    const TransportCounters& counters() const { return counters_; } // contadores do comando metrics
+    std::string mechanism_name() const; // "socket" (TCP) ou "socket_unix"
     std::string get_status() const;
     nlohmann::json status() const;
 
 private:
+    // Conexão remetente persistente: reconectada sob demanda; uma thread conta os ACKs
+    struct SenderConn {
+        SOCKET sock{ INVALID_SOCKET };
+        std::mutex mtx;                 // serializa escrita/reconexão
+        std::mutex ack_mtx;             // protege unacked/broken (thread de ACK)
+        std::condition_variable ack_cv;
+        uint64_t written{ 0 };
+        std::deque<uint64_t> unacked;   // seqs escritos sem ACK, em ordem (os ACKs vêm na mesma)
+        bool broken{ false };
+        std::thread ack_thread;
+    };
+
+    // Conexão aceita pelo servidor: buffers próprios, dona é a thread de loop que a aceitou
+    struct PeerConn {
+        PeerConn(FrameMode mode, CodecKind codec) : in(mode), codec(codec) {}
+        FrameDecoder in;       // recv direto no buffer; quadros saem como string_view
+        MessageCodec codec;    // decodifica as mensagens do remetente (estado por conexão)
+        std::string out;       // ACKs que não couberam no socket
+        bool greeted{ false }; // 1o quadro já visto (hello do listener ou 1a mensagem)
+        bool want_write{ false };
+    };
+    enum class PeerResult { keep, close, listener };
+    using PeerMap = std::unordered_map<SOCKET, PeerConn>;
+
     void cleanup();
-    void server_thread();
+    SOCKET open_listen_socket(bool reuse_port);
+    void loop_thread(size_t index);  // loop de prontidão: accept + leitura de N remetentes
+    void accept_ready(SocketPoller& poller, SOCKET listen_sock, PeerMap& peers);
+    PeerResult on_readable(SOCKET s, PeerConn& c);
+    bool flush_acks(SocketPoller& poller, SOCKET s, PeerConn& c);
+    void close_peer(SocketPoller& poller, PeerMap& peers, SOCKET s);
+    bool register_listener(SOCKET s); // false = já há um listener (o novo é fechado)
+    bool on_listener_event(const PollEvent& ev); // false = listener fechou (o loop chama drop_listener)
+    bool flush_listener_locked();     // com listener_mtx_; false = o socket falhou
+    void drop_listener(SOCKET s);     // fecha e esquece o listener, se ainda for 's'
+    void handle_message(std::string_view payload, uint64_t seq, MessageCodec& codec);
     void client_thread();
-    bool setup_winsock();
+    bool setup_sockets();
+
+    SOCKET connect_endpoint() const;
+    bool open_sender(SenderConn& c);
+    size_t close_sender(SenderConn& c); // cancela os seqs sem ACK na janela; devolve quantos
+    enum class WindowState { ready, timeout, broken };
+    WindowState wait_window(SenderConn& c);
+    void ack_reader(SenderConn* c, SOCKET s);
 
     nlohmann::json create_base_event(const std::string& event_type) const;
     nlohmann::json make_simple_event(const std::string& event_type, const std::string& message) const;
     nlohmann::json make_error_event(const std::string& error_type, const std::string& message) const;
+    void log_error(const std::string& error_type, const std::string& message); // stderr + contador
 
     IPCManager* manager_;
     std::atomic<bool> running_{ false };
     std::atomic<bool> connected_{ false };
-    SOCKET server_socket_{ INVALID_SOCKET };
+    SocketEndpoint endpoint_;
+    std::atomic<bool> unix_domain_{ false }; // endpoint_.unix_domain para o mechanism_name() do metrics (outra thread)
+    FrameMode framing_{ FrameMode::line };
+    CodecKind codec_{ CodecKind::json };
+    std::vector<SOCKET> listen_sockets_;   // 1 por loop com SO_REUSEPORT; senão 1 compartilhado
 
     // Lado CLIENTE (usado pelo thread cliente interno)
     SOCKET client_socket_{ INVALID_SOCKET };
@@ -43,9 +113,27 @@ private:
     // Lado SERVIDOR (socket aceito que corresponde ao listener interno)
     SOCKET listener_socket_{ INVALID_SOCKET };   // ADICIONADO: socket do listener
     std::mutex listener_mtx_;                    // ADICIONADO: mutex para proteger acesso ao listener
+    std::string listener_out_;                   // ecos que não couberam no socket (listener_mtx_)
+    std::atomic<bool> listener_pending_{ false }; // listener_out_ não vazio: o loop dono liga o EPOLLOUT
+    std::condition_variable listener_cv_;        // start() espera o registro do listener (listener_mtx_)
+    bool listener_failed_{ false };              // cliente interno não conectou (listener_mtx_)
+    static constexpr size_t LISTENER_OUT_MAX = 64 * 1024 * 1024; // acima disso o eco é descartado
+
+    // Lado REMETENTE: pool de conexões persistentes usado por send()
+    std::vector<std::unique_ptr<SenderConn>> senders_;
+    std::atomic<size_t> next_sender_{ 0 };  // send() pode vir de várias threads
+    uint32_t window_{ 64 };
+    std::atomic<int> reconnects_{ 0 };
+    InflightWindow inflight_;              // id de correlação -> envio, fechado pelo client_thread
+    LatencyStats latency_;                 // gravado pelo client_thread, lido pelo status sem lock
+    TransportCounters counters_;           // vida do processo, lidos pelo metrics sem lock
+
+    // Loop de eventos do servidor
+    std::vector<std::thread> loop_threads_;
+    std::atomic<int> peers_open_{ 0 };
+    std::atomic<uint64_t> peers_accepted_{ 0 };
 
-    std::thread server_thread_;
     std::thread client_thread_;
-    int messages_sent_{ 0 };
-    int messages_received_{ 0 };
+    std::atomic<int> messages_sent_{ 0 }; // send() de várias threads
+    std::atomic<int> messages_received_{ 0 };
 };
\ No newline at end of file
@@ -0,0 +1,101 @@
+#pragma once
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <afunix.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Primitivas de socket usadas pelo SocketModule: Winsock no Windows, BSD sockets no
+// Linux, e um "poller" de prontidão (WSAPoll / epoll) para o loop de eventos do servidor.
+
+#ifndef _WIN32
+typedef int SOCKET;
+constexpr SOCKET INVALID_SOCKET = -1;
+constexpr int SOCKET_ERROR = -1;
+constexpr int SD_BOTH = SHUT_RDWR;
+inline int closesocket(SOCKET s) { return ::close(s); }
+#endif
+
+// Flags de ::send: no Linux, peer fechado vira EPIPE em vez de SIGPIPE
+#ifdef MSG_NOSIGNAL
+constexpr int SOCKET_SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SOCKET_SEND_FLAGS = 0;
+#endif
+
+bool socket_startup(std::string& err);  // WSAStartup (no-op no Linux)
+void socket_cleanup();
+int socket_last_error();                 // WSAGetLastError / errno
+bool socket_would_block();               // último erro = WSAEWOULDBLOCK / EAGAIN
+bool set_nonblocking(SOCKET s, bool on);
+bool socket_reuse_port(SOCKET s);        // SO_REUSEPORT (false onde não existe)
+
+// Fecha um socket que outra thread pode estar bloqueada usando (accept/recv):
+// shutdown antes do close, que no Linux não acorda quem está bloqueado
+void socket_close(SOCKET s);
+
+// ---------------------- Endereços ----------------------
+
+// Onde o servidor escuta / os clientes conectam: TCP (loopback) ou AF_UNIX stream.
+// path "@nome" = namespace abstrato do Linux (sem arquivo no disco).
+struct SocketEndpoint {
+    bool unix_domain{ false };
+    std::string path;
+    uint16_t port{ 7070 };
+
+    std::string describe() const; // "port 7070" / "unix:/tmp/..."
+};
+
+std::string default_unix_socket_path();
+SOCKET open_stream_socket(const SocketEndpoint& ep);
+// listening = endereço de bind (INADDR_ANY); senão, de connect (127.0.0.1)
+bool endpoint_sockaddr(const SocketEndpoint& ep, bool listening, sockaddr_storage& ss, socklen_t& len, std::string& err);
+void unlink_endpoint(const SocketEndpoint& ep); // remove o arquivo do AF_UNIX (só se for um socket)
+
+// ---------------------- Poller ----------------------
+
+struct PollEvent {
+    SOCKET sock;
+    bool readable;
+    bool writable;
+    bool hangup;  // erro ou peer fechou (ainda pode haver dados para ler)
+};
+
+// Conjunto de sockets observados por uma thread. Linux: epoll (nível). Windows: WSAPoll
+// sobre um vetor reconstruído a cada mudança. Não é thread-safe: um poller por loop.
+class SocketPoller {
+public:
+    SocketPoller() = default;
+    SocketPoller(const SocketPoller&) = delete;
+    SocketPoller& operator=(const SocketPoller&) = delete;
+    ~SocketPoller() { close(); }
+
+    bool open(std::string& err);
+    void close();
+
+    bool add(SOCKET s, bool want_write = false);
+    bool modify(SOCKET s, bool want_write);
+    void remove(SOCKET s);
+
+    // Espera até timeout_ms; preenche 'out' com os sockets prontos. -1 = erro.
+    int wait(std::vector<PollEvent>& out, int timeout_ms);
+
+private:
+#ifdef _WIN32
+    std::vector<WSAPOLLFD> fds_;
+#else
+    int epfd_{ -1 };
+    std::vector<struct epoll_event> events_;
+#endif
+};
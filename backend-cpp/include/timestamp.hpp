@@ -0,0 +1,73 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+// Relógios do backend, num lugar só:
+//   mono_ns()       monotônico em ns (steady_clock = CLOCK_MONOTONIC / QueryPerformanceCounter):
+//                   base das contas de latência, comparável entre processos da mesma máquina
+//   iso_timestamp() relógio de parede UTC em ISO 8601 com microssegundos
+//                   ("2026-10-16T23:37:57.123456Z"), o "ts" dos eventos
+// A parte "AAAA-MM-DDTHH:MM:SS" fica em cache por thread: só muda quando o segundo
+// vira (e só passa pelo gmtime quando o minuto vira); o resto é escrito direto.
+inline uint64_t mono_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+inline int64_t wall_us() {
+    return static_cast<int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+constexpr size_t ISO_TIMESTAMP_LEN = 27; // AAAA-MM-DDTHH:MM:SS.uuuuuuZ
+
+namespace ts_detail {
+inline void put2(char* p, int v) {
+    p[0] = static_cast<char>('0' + v / 10);
+    p[1] = static_cast<char>('0' + v % 10);
+}
+
+struct IsoCache {
+    int64_t sec = INT64_MIN; // segundo (epoch) que está em 'text'
+    char text[ISO_TIMESTAMP_LEN + 1] = {};
+};
+} // namespace ts_detail
+
+// Escreve ISO_TIMESTAMP_LEN caracteres em 'out' (sem terminador)
+inline void format_iso_timestamp(int64_t us, char* out) {
+    thread_local ts_detail::IsoCache cache;
+    int64_t sec = us / 1000000;
+    int64_t frac = us % 1000000;
+    if (frac < 0) { frac += 1000000; --sec; }
+
+    if (sec != cache.sec) {
+        if (cache.sec != INT64_MIN && sec / 60 == cache.sec / 60 && sec >= 0) {
+            ts_detail::put2(cache.text + 17, static_cast<int>(sec % 60)); // mesmo minuto: só os segundos
+        }
+        else {
+            const std::time_t t = static_cast<std::time_t>(sec);
+            struct tm tmv;
+#ifdef _WIN32
+            gmtime_s(&tmv, &t);
+#else
+            gmtime_r(&t, &tmv);
+#endif
+            std::strftime(cache.text, sizeof(cache.text), "%Y-%m-%dT%H:%M:%S", &tmv);
+            cache.text[19] = '.';
+            cache.text[26] = 'Z';
+        }
+        cache.sec = sec;
+    }
+    for (int i = 25; i >= 20; --i, frac /= 10) cache.text[i] = static_cast<char>('0' + frac % 10);
+    std::char_traits<char>::copy(out, cache.text, ISO_TIMESTAMP_LEN);
+}
+
+inline std::string iso_timestamp(int64_t us) {
+    std::string s(ISO_TIMESTAMP_LEN, '\0');
+    format_iso_timestamp(us, s.data());
+    return s;
+}
+
+inline std::string iso_timestamp() { return iso_timestamp(wall_us()); }
@@ -0,0 +1,233 @@
+#include "event_sink.hpp"
+#include "pipe_platform.hpp"
+#include <cstdint>
+
+SinkPolicy parse_sink_policy(const std::string& s) {
+    return s == "drop" ? SinkPolicy::drop : s == "sample" ? SinkPolicy::sample : SinkPolicy::block;
+}
+
+const char* sink_policy_name(SinkPolicy p) {
+    return p == SinkPolicy::drop ? "drop" : p == SinkPolicy::sample ? "sample" : "block";
+}
+
+EventSink& EventSink::instance() {
+    static EventSink sink;
+    return sink;
+}
+
+EventSink::EventSink() : slots_(new Slot[SINK_SLOTS]) {
+    for (size_t i = 0; i < SINK_SLOTS; ++i) slots_[i].seq.store(i, std::memory_order_relaxed);
+    writer_ = std::thread(&EventSink::writer_loop, this);
+}
+
+EventSink::~EventSink() {
+    stopping_.store(true);
+    wake();
+    if (writer_.joinable()) writer_.join();
+}
+
+// ---------------------- Fila (anel limitado MPSC) ----------------------
+// Cada slot tem um número de sequência: == pos livre para o produtor da posição pos,
+// == pos + 1 preenchido para a escritora. Produtores disputam head_ por CAS; a
+// escritora é a única a mexer em tail_. fill(slot.line) grava a linha no slot reservado.
+
+template <class Fill>
+bool EventSink::try_push(Fill& fill) {
+    size_t pos = head_.load(std::memory_order_relaxed);
+    for (;;) {
+        Slot& s = slots_[pos & (SINK_SLOTS - 1)];
+        const size_t seq = s.seq.load(std::memory_order_acquire);
+        const auto dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (dif == 0) {
+            if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                fill(s.line);
+                s.seq.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (dif < 0) {
+            return false; // cheia: a escritora ainda não liberou este slot
+        }
+        else {
+            pos = head_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool EventSink::pop_into(std::string& batch) {
+    const size_t pos = tail_.load(std::memory_order_relaxed);
+    Slot& s = slots_[pos & (SINK_SLOTS - 1)];
+    if (s.seq.load(std::memory_order_acquire) != pos + 1) return false;
+    batch.append(s.line) += '\n';
+    // linha pequena: o slot fica com a capacidade para o próximo emit(string_view);
+    // grande: devolve a memória (com swap: na libstdc++, atribuir uma string vazia mantém
+    // o buffer do slot)
+    if (s.line.capacity() > SINK_SLOT_KEEP) std::string().swap(s.line);
+    else s.line.clear();
+    s.seq.store(pos + SINK_SLOTS, std::memory_order_release);
+    tail_.store(pos + 1, std::memory_order_relaxed);
+    return true;
+}
+
+size_t EventSink::backlog() const {
+    return head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_relaxed);
+}
+
+void EventSink::wake() {
+    // par do fence da escritora: ou ela vê a linha nova, ou nós a vemos dormindo
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed) || stopping_.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        wake_cv_.notify_one();
+    }
+}
+
+// ---------------------- Produtores ----------------------
+
+void EventSink::emit(std::string line, bool data) {
+    push(data, line, [&](std::string& slot) { slot = std::move(line); });
+}
+
+void EventSink::emit(std::string_view line, bool data) {
+    push(data, line, [&](std::string& slot) { slot.assign(line); });
+}
+
+template <class Fill>
+void EventSink::push(bool data, std::string_view line, Fill fill) {
+    if (data) {
+        const SinkPolicy policy = policy_.load(std::memory_order_relaxed);
+        if (policy == SinkPolicy::sample && backlog() > SINK_SLOTS / 2 &&
+            sample_tick_.fetch_add(1, std::memory_order_relaxed) % sample_every_.load(std::memory_order_relaxed) != 0) {
+            sampled_out_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (policy != SinkPolicy::block) {
+            if (!try_push(fill)) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            queued_.fetch_add(1, std::memory_order_relaxed);
+            wake();
+            return;
+        }
+    }
+
+    // controle (ou política block): espera vaga; a escritora drena nem que seja descartando
+    while (!try_push(fill)) {
+        if (done_.load()) {
+            // sem escritora (fim do processo): escreve direto
+            drain_sync();
+            write_out(std::string(line) += '\n');
+            return;
+        }
+        wake();
+        std::this_thread::yield();
+    }
+    queued_.fetch_add(1, std::memory_order_relaxed);
+    wake();
+    if (done_.load()) drain_sync(); // a escritora saiu depois do push: ninguém mais drena
+}
+
+void EventSink::configure(SinkPolicy policy, unsigned sample_every) {
+    policy_.store(policy);
+    sample_every_.store(sample_every ? sample_every : 1);
+}
+
+bool EventSink::flush(int timeout_ms) {
+    const uint64_t target = queued_.load();
+    const auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    std::unique_lock<std::mutex> lk(mtx_);
+    while (written_.load() < target && !done_.load()) {
+        wake_cv_.notify_one();
+        if (written_cv_.wait_until(lk, std::min(until, std::chrono::steady_clock::now() + std::chrono::milliseconds(1))) ==
+                std::cv_status::timeout &&
+            std::chrono::steady_clock::now() >= until)
+            return false;
+    }
+    return true;
+}
+
+nlohmann::json EventSink::stats() const {
+    nlohmann::json j;
+    j["policy"] = sink_policy_name(policy_.load());
+    j["sample_every"] = sample_every_.load();
+    j["queued"] = queued_.load();
+    j["written"] = written_.load();
+    j["backlog"] = backlog();
+    j["dropped"] = dropped_.load();
+    j["sampled_out"] = sampled_out_.load();
+    j["writes"] = writes_.load();
+    j["bytes"] = bytes_.load();
+    j["stdout_broken"] = broken_.load();
+    return j;
+}
+
+// ---------------------- Escritora ----------------------
+
+void EventSink::write_out(const std::string& bytes) {
+    if (bytes.empty() || broken_.load(std::memory_order_relaxed)) return;
+    if (!pipe_write_all(pipe_stdout(), bytes.data(), bytes.size())) {
+        broken_.store(true); // frontend fechou o stdout: o resto é só drenado
+        return;
+    }
+    writes_.fetch_add(1, std::memory_order_relaxed);
+    bytes_.fetch_add(bytes.size(), std::memory_order_relaxed);
+}
+
+void EventSink::drain_sync() {
+    std::lock_guard<std::mutex> lk(mtx_); // pop é de um consumidor só
+    std::string batch;
+    uint64_t n = 0;
+    while (pop_into(batch)) ++n;
+    write_out(batch);
+    written_.fetch_add(n);
+}
+
+void EventSink::writer_loop() {
+    using Clock = std::chrono::steady_clock;
+    std::string batch;
+    batch.reserve(SINK_BATCH_BYTES + 4096);
+    uint64_t reported_dropped = 0, reported_sampled = 0;
+
+    for (;;) {
+        // Lote: até a fila esvaziar, o lote encher ou o prazo do 1o evento vencer
+        uint64_t n = 0;
+        Clock::time_point deadline;
+        while (batch.size() < SINK_BATCH_BYTES && pop_into(batch)) {
+            if (n++ == 0) deadline = Clock::now() + SINK_DEADLINE;
+            if ((n & 63) == 0 && Clock::now() >= deadline) break;
+        }
+        if (n > 0) {
+            write_out(batch);
+            batch.clear();
+            written_.fetch_add(n);
+            written_cv_.notify_all();
+            continue;
+        }
+
+        // Fila vazia: avisa perdas desde o último aviso, sai ou dorme
+        const uint64_t dropped = dropped_.load(), sampled = sampled_out_.load();
+        if (dropped != reported_dropped || sampled != reported_sampled) {
+            nlohmann::json ev;
+            ev["event"] = "events_dropped";
+            ev["policy"] = sink_policy_name(policy_.load());
+            ev["dropped"] = dropped - reported_dropped;
+            ev["sampled_out"] = sampled - reported_sampled;
+            reported_dropped = dropped;
+            reported_sampled = sampled;
+            write_out(ev.dump() + '\n');
+            continue;
+        }
+        if (stopping_.load()) break;
+
+        std::unique_lock<std::mutex> lk(mtx_);
+        sleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (backlog() == 0 && !stopping_.load()) wake_cv_.wait_for(lk, std::chrono::milliseconds(50));
+        sleeping_.store(false, std::memory_order_relaxed);
+    }
+
+    // Fim do processo: o que entrou até aqui sai agora; depois, quem emitir escreve direto
+    done_.store(true);
+    drain_sync();
+}
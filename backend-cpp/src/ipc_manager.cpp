@@ -1,15 +1,21 @@
 #include "ipc_manager.hpp"
+#include "event_sink.hpp"
+#include "event_writer.hpp"
+#include "log.hpp"
 #include "shared_memory_module.hpp"
+#include "timestamp.hpp"
+#include <cstdlib>
 #include <iostream>
 #include <chrono>
 #include <thread>
-#include <windows.h>
+#include "shm_platform.hpp"
+#include "pipe_platform.hpp"
 
 // Helper functions for event creation
 json IPCManager::create_base_event(const std::string& event_type) {
     json event;
     event["event"] = event_type;
-    event["pid"] = GetCurrentProcessId();
+    event["pid"] = current_pid();
 
     // ADICIONADO: mechanism para eventos globais
     if (event_type == "backend_started" || event_type == "backend_stopped" ||
@@ -17,23 +23,22 @@ json IPCManager::create_base_event(const std::string& event_type) {
         event["mechanism"] = "system";
     }
 
-    // Get current timestamp in ISO 8601 format
-    auto now = std::chrono::system_clock::now();
-    auto in_time_t = std::chrono::system_clock::to_time_t(now);
-    char buffer[80];
-    struct tm timeinfo;
-    localtime_s(&timeinfo, &in_time_t);
-    strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", &timeinfo);
-    event["ts"] = buffer;
+    // ISO 8601 em UTC com microssegundos (timestamp.hpp: a data/hora fica em cache)
+    event["ts"] = iso_timestamp();
 
     return event;
 }
 
 std::string IPCManager::make_error_event(const std::string& where, const std::string& message) {
-    json event = create_base_event("error");
-    event["where"] = where;
-    event["message"] = message;
-    return event.dump();
+    // create_base_event("error") + where/message, direto (event_writer.hpp)
+    return std::string(EventWriter()
+        .field("event", "error")
+        .field("mechanism", "system")
+        .field("message", message)
+        .field("pid", current_pid())
+        .ts()
+        .field("where", where)
+        .finish());
 }
 
 std::string IPCManager::make_simple_event(const std::string& event_type, const std::string& message) {
@@ -42,67 +47,91 @@ std::string IPCManager::make_simple_event(const std::string& event_type, const s
     return event.dump();
 }
 
-IPCManager::IPCManager() : current_mechanism_("none") {
+IPCManager::IPCManager() : current_mechanism_("none"), metrics_server_([this] { return metrics(); }) {
     pipe_module_ = std::make_unique<PipeModule>(this);
     socket_module_ = std::make_unique<SocketModule>(this);
     shm_ = std::make_unique<SharedMemoryModule>(this);
+    shm_hub_ = std::make_unique<ShmHub>(this);
 
     // Log startup
     json event = create_base_event("backend_started");
-    std::cout << event.dump() << std::endl;
+    emit_event(event);
 }
 
 IPCManager::~IPCManager() {
+    metrics_server_.stop();
     stop();
 }
 
-bool IPCManager::start(const std::string& mechanism) {
+bool IPCManager::start(const std::string& mechanism, const json& options) {
     stop(); // Stop any current mechanism
+    counters_.starts.add();
+
+    LOG_DEBUG("COMANDO", "start");
+    LOG_DEBUG("MECANISMO", mechanism);
 
-    std::cerr << "DEBUG [COMANDO]: start" << std::endl;
-    std::cerr << "DEBUG [MECANISMO]: " << mechanism << std::endl;
+    // Poltica dos eventos de dados quando o frontend no acompanha (event_sink.hpp)
+    EventSink::instance().configure(parse_sink_policy(options.value("event_policy", std::string("block"))),
+                                    options.value("event_sample", 10u));
 
     if (mechanism == "pipe") {
-        if (pipe_module_->start()) {
+        if (pipe_module_->start(options)) {
             current_mechanism_ = "pipe";
             running_.store(true);
 
             json event = create_base_event("started");
             event["mechanism"] = "pipe";
-            std::cout << event.dump() << std::endl;
+            emit_event(event);
 
             return true;
         }
     }
-    else if (mechanism == "socket") {
-        if (socket_module_->start()) {
-            current_mechanism_ = "socket";
+    else if (mechanism == "socket" || mechanism == "socket_unix") {
+        // socket_unix = mesmo mdulo, transporte AF_UNIX
+        json socket_options = options;
+        if (mechanism == "socket_unix") socket_options["transport"] = "unix";
+        if (socket_module_->start(socket_options)) {
+            current_mechanism_ = socket_module_->mechanism_name();
             running_.store(true);
 
             json event = create_base_event("started");
-            event["mechanism"] = "socket";
-            std::cout << event.dump() << std::endl;
+            event["mechanism"] = current_mechanism_;
+            emit_event(event);
 
             return true;
         }
     }
     else if (mechanism == "shm") {
-        if (shm_->start()) {
+        if (shm_->start(options)) {
             current_mechanism_ = "shm";
             running_.store(true);
 
             json event = create_base_event("started");
             event["mechanism"] = "shm";
-            std::cout << event.dump() << std::endl;
+            emit_event(event);
+
+            return true;
+        }
+    }
+    else if (mechanism == "shm_hub") {
+        if (shm_hub_->start(options)) {
+            current_mechanism_ = "shm_hub";
+            running_.store(true);
+
+            json event = create_base_event("started");
+            event["mechanism"] = "shm_hub";
+            emit_event(event);
 
             return true;
         }
     }
     else {
         std::cerr << make_error_event("unknown_mechanism", "Mechanism not implemented: " + mechanism) << std::endl;
+        counters_.start_failures.add();
         return false;
     }
 
+    counters_.start_failures.add();
     return false;
 }
 
@@ -110,45 +139,58 @@ void IPCManager::stop() {
     if (current_mechanism_ == "pipe") {
         pipe_module_->stop();
     }
-    else if (current_mechanism_ == "socket") {
+    else if (current_mechanism_ == "socket" || current_mechanism_ == "socket_unix") {
         socket_module_->stop();
     }
     else if (current_mechanism_ == "shm") {
         shm_->stop();
     }
+    else if (current_mechanism_ == "shm_hub") {
+        shm_hub_->stop();
+    }
 
     current_mechanism_ = "none";
     running_.store(false);
 
-    std::cerr << "DEBUG [STOP]: Parando mecanismo" << std::endl;
+    LOG_DEBUG("STOP", "Parando mecanismo");
+}
+
+bool IPCManager::send(const std::string& message, const std::string& key, uint64_t id) {
+    counters_.sends.add();
+    const bool ok = send_active(message, key, id);
+    if (!ok) counters_.send_failures.add();
+    return ok;
 }
 
-bool IPCManager::send(const std::string& message) {
-    std::cerr << "DEBUG [COMANDO]: send" << std::endl;
-    std::cerr << "DEBUG [SEND]: Entrou no comando send" << std::endl;
+bool IPCManager::send_active(const std::string& message, const std::string& key, uint64_t id) {
+    LOG_TRACE("COMANDO", "send");
+    LOG_TRACE("SEND", "Entrou no comando send");
 
     if (current_mechanism_ == "pipe") {
         if (!pipe_module_->is_running()) {
-            std::cerr << "DEBUG [SEND ERROR]: PipeModule no est ativo" << std::endl;
-            std::cerr << "DEBUG [PIPE_MODULE]: Nulo" << std::endl;
+            LOG_WARN("SEND ERROR", "PipeModule no est ativo");
+            LOG_WARN("PIPE_MODULE", "Nulo");
             std::cerr << make_error_event("send_failed", "No active pipe mechanism") << std::endl;
             return false;
         }
-        return pipe_module_->send(message);
+        return pipe_module_->send(message, key, id);
     }
-    else if (current_mechanism_ == "socket") {
+    else if (current_mechanism_ == "socket" || current_mechanism_ == "socket_unix") {
         if (!socket_module_->is_running()) {
             std::cerr << make_error_event("send_failed", "No active socket mechanism") << std::endl;
             return false;
         }
-        return socket_module_->send(message);
+        return socket_module_->send(message, id);
     }
     else if (current_mechanism_ == "shm") {
         if (!shm_->is_running()) {
             std::cerr << make_error_event("send_failed", "No active shared memory mechanism") << std::endl;
             return false;
         }
-        return shm_->send(message);
+        return shm_->send(message, id);
+    }
+    else if (current_mechanism_ == "shm_hub") {
+        return shm_hub_->send(message); // hub: clientes externos, sem correlao por id
     }
     else {
         std::cerr << make_error_event("send_failed", "No active mechanism") << std::endl;
@@ -156,75 +198,192 @@ bool IPCManager::send(const std::string& message) {
     }
 }
 
+bool IPCManager::flush() {
+    if (current_mechanism_ == "pipe" && pipe_module_) {
+        return pipe_module_->flush();
+    }
+    return true; // demais mecanismos escrevem direto, sem buffer
+}
+
 std::string IPCManager::get_status() const {
-    std::cerr << "DEBUG [COMANDO]: status" << std::endl;
-    std::cerr << "DEBUG [STATUS]: Solicitando status" << std::endl;
+    LOG_DEBUG("COMANDO", "status");
+    LOG_DEBUG("STATUS", "Solicitando status");
 
     json event = create_base_event("status");
     event["mechanism"] = current_mechanism_;
 
     if (current_mechanism_ == "pipe") {
-        event["pipe_running"] = pipe_module_->is_running();
+        event.update(pipe_module_->status_json()); // contadores + distribuio dos lotes
     }
-    else if (current_mechanism_ == "socket") {
+    else if (current_mechanism_ == "socket" || current_mechanism_ == "socket_unix") {
         event["socket_running"] = socket_module_->is_running();
         event["socket_connected"] = socket_module_->is_connected();
+        event.update(socket_module_->status()); // pool, janela, reconexes, loops + latncia
     }
     else if (current_mechanism_ == "shm") {
-        event["shm_running"] = shm_->is_running();
-        // Adicione quaisquer outros status especficos da memria compartilhada aqui
+        event.update(shm_->status_json()); // contadores, janela, wake-ups por lado + latncia
+    }
+    else if (current_mechanism_ == "shm_hub") {
+        event.update(shm_hub_->status_json()); // shm_hub_running + mtricas por cliente
     }
     else {
         event["mechanism"] = "none";
     }
+    event["event_sink"] = EventSink::instance().stats();
 
     return event.dump();
 }
 
-json IPCManager::status() {
-    json j = create_base_event("status");
-    j["mechanism"] = current_mechanism_;
-    j["running"] = running_.load();  // CORRIGIDO: usando .load() para atomic
+std::string IPCManager::metrics() {
+    counters_.scrapes.add();
+
+    // Todos os mecanismos sempre, parados ou no: sries estveis para o scraper. Os mdulos
+    // vivem tanto quanto o IPCManager; nada aqui l current_mechanism_ ( da thread do stdin).
+    // O socket leva o nome do ltimo start (socket ou socket_unix), como nos eventos.
+    // O shm_hub no tem RTT nem janela do lado servidor (latency nula): s contadores.
+    struct Mech {
+        std::string labels;
+        const TransportCounters& counters;
+        const LatencyStats* latency;
+        size_t in_flight;
+        bool running;
+    };
+    const Mech mechs[] = {
+        { "mechanism=\"pipe\"", pipe_module_->counters(), &pipe_module_->latency(),
+          pipe_module_->inflight().in_flight_relaxed(), pipe_module_->is_running() },
+        { "mechanism=\"" + socket_module_->mechanism_name() + "\"", socket_module_->counters(),
+          &socket_module_->latency(), socket_module_->inflight().in_flight_relaxed(), socket_module_->is_running() },
+        { "mechanism=\"shm\"", shm_->counters(), &shm_->latency(),
+          shm_->inflight().in_flight_relaxed(), shm_->is_running() },
+        { "mechanism=\"shm_hub\"", shm_hub_->counters(), nullptr, 0, shm_hub_->is_running() },
+    };
+
+    OpenMetricsWriter w;
+    auto per_mech = [&](const char* name, const char* help, MetricCounter TransportCounters::* field) {
+        w.family(name, "counter", help);
+        const std::string total = std::string(name) + "_total";
+        for (const Mech& m : mechs) w.sample(total, m.labels, (m.counters.*field).load());
+    };
+    per_mech("ra1_messages_sent", "Messages accepted by the mechanism send path (echoes written, for shm_hub)", &TransportCounters::messages_sent);
+    per_mech("ra1_messages_received", "Replies read back by the mechanism reader (requests served, for shm_hub)", &TransportCounters::messages_received);
+    per_mech("ra1_errors", "Error events raised by the mechanism", &TransportCounters::errors);
+    per_mech("ra1_reconnects", "Transparent reconnects of the socket sender pool", &TransportCounters::reconnects);
+    w.family("ra1_sent_bytes", "counter", "Bytes written by the mechanism send path", "bytes");
+    for (const Mech& m : mechs) w.sample("ra1_sent_bytes_total", m.labels, m.counters.bytes_sent.load());
+    w.family("ra1_received_bytes", "counter", "Payload bytes of the replies read back", "bytes");
+    for (const Mech& m : mechs) w.sample("ra1_received_bytes_total", m.labels, m.counters.bytes_received.load());
+
+    w.family("ra1_mechanism_running", "gauge", "1 while the mechanism is started");
+    for (const Mech& m : mechs) w.sample("ra1_mechanism_running", m.labels, uint64_t(m.running));
+    w.family("ra1_inflight_requests", "gauge", "Requests sent and still waiting for their reply");
+    for (const Mech& m : mechs)
+        if (m.latency) w.sample("ra1_inflight_requests", m.labels, uint64_t(m.in_flight));
+
+    // RTT desde o ltimo start do mecanismo (o LatencyStats zera no start: reset de counter)
+    w.family("ra1_rtt_seconds", "histogram", "Round-trip time of correlated requests since the mechanism started", "seconds");
+    for (const Mech& m : mechs)
+        if (m.latency) w.histogram("ra1_rtt_seconds", m.labels, m.latency->snapshot());
+
+    const json sink = EventSink::instance().stats();
+    w.family("ra1_event_queue_depth", "gauge", "Events queued for stdout and not yet written");
+    w.sample("ra1_event_queue_depth", "", sink.value("backlog", uint64_t(0)));
+    w.family("ra1_events_written", "counter", "Events written to stdout");
+    w.sample("ra1_events_written_total", "", sink.value("written", uint64_t(0)));
+    w.family("ra1_events_dropped", "counter", "Data events discarded by the event policy");
+    w.sample("ra1_events_dropped_total", "reason=\"queue_full\"", sink.value("dropped", uint64_t(0)));
+    w.sample("ra1_events_dropped_total", "reason=\"sampled\"", sink.value("sampled_out", uint64_t(0)));
+
+    w.family("ra1_starts", "counter", "start commands, failed ones included");
+    w.sample("ra1_starts_total", "", counters_.starts.load());
+    w.family("ra1_start_failures", "counter", "start commands that failed");
+    w.sample("ra1_start_failures_total", "", counters_.start_failures.load());
+    w.family("ra1_sends", "counter", "send commands, failed ones included");
+    w.sample("ra1_sends_total", "", counters_.sends.load());
+    w.family("ra1_send_failures", "counter", "send commands that failed");
+    w.sample("ra1_send_failures_total", "", counters_.send_failures.load());
+    w.family("ra1_metrics_scrapes", "counter", "Metrics renders (command and endpoint)");
+    w.sample("ra1_metrics_scrapes_total", "", counters_.scrapes.load());
+    return w.finish();
+}
 
-    if (current_mechanism_ == "pipe" && pipe_module_) {
-        j["pipe_running"] = pipe_module_->is_running();
+json IPCManager::metrics_command(const json& command) {
+    if (!command.contains("serve")) {
+        json event = create_base_event("metrics");
+        event["format"] = "openmetrics";
+        event["text"] = metrics();
+        return event;
+    }
+
+    const json& serve = command["serve"];
+    if (serve.is_boolean() && !serve.get<bool>()) {
+        metrics_server_.stop();
+    }
+    else {
+        const json opts = serve.is_object() ? serve : json::object();
+        SocketEndpoint ep;
+        ep.unix_domain = opts.value("transport", std::string("tcp")) == "unix";
+#ifdef _WIN32
+        const char* tmp = std::getenv("TEMP");
+        const std::string default_path = std::string(tmp ? tmp : ".") + "\\ra1_metrics.sock";
+#else
+        const std::string default_path = "/tmp/ra1_metrics.sock";
+#endif
+        ep.path = opts.value("path", ep.unix_domain ? default_path : std::string());
+        ep.port = opts.value("port", uint16_t(9464));
+        std::string err;
+        if (!metrics_server_.start(ep, err)) {
+            std::cerr << make_error_event("metrics_serve", err) << std::endl;
+        }
     }
-    else if (current_mechanism_ == "socket" && socket_module_) {
-        j["socket_running"] = socket_module_->is_running();
-        j["socket_connected"] = socket_module_->is_connected();
+
+    json event = create_base_event("metrics_endpoint");
+    event["serving"] = metrics_server_.is_running();
+    if (metrics_server_.is_running()) event["endpoint"] = metrics_server_.endpoint().describe();
+    return event;
+}
+
+int IPCManager::run_child_process(int argc, char* argv[]) {
+    // Modo filho para pipes: eco SIMPLES (pipe_child <line|binary> <json|binary> [work_us])
+    if (argc > 1 && std::string(argv[1]) == "pipe_child") {
+        const FrameMode framing = parse_frame_mode(argc > 2 ? argv[2] : "line");
+        const CodecKind codec = parse_codec(argc > 3 ? argv[3] : "json");
+        const int work_us = argc > 4 ? std::stoi(argv[4]) : 0;
+        return PipeModule::run_child(framing, codec, work_us);
     }
-    else if (current_mechanism_ == "shm" && shm_) {
-        // Adicione o status especfico da memria compartilhada
-        json shm_status = shm_->status_json();
-        j.update(shm_status); // Mescla os dados de status do shm
+
+    // Modo filho para memria compartilhada: anexa ao mapeamento do pai (PID em argv[2])
+    if (argc > 2 && std::string(argv[1]) == "shm_child") {
+        SharedMemoryModule child(nullptr);
+        return child.run_child(std::stoul(argv[2]), argc > 3 ? std::stoi(argv[3]) : -1);
     }
 
-    return j;
+    // Modo cliente do hub: shm_hub_client <pid_do_hub> <mensagens> <bytes>
+    if (argc > 4 && std::string(argv[1]) == "shm_hub_client") {
+        ShmHub client(nullptr);
+        return client.run_client(std::stoul(argv[2]), std::stoul(argv[3]), std::stoul(argv[4]));
+    }
+    return -1;
 }
 
 void IPCManager::run_child_mode() {
     // Pipe child process mode - simples echo server
-    std::cout << make_simple_event("child_started", "Pipe child process started") << std::endl;
+    emit_event(make_simple_event("child_started", "Pipe child process started"));
 
     char buffer[1024];
-    DWORD bytesRead;
 
     while (true) {
-        if (ReadFile(GetStdHandle(STD_INPUT_HANDLE), buffer, sizeof(buffer) - 1, &bytesRead, nullptr)) {
-            if (bytesRead > 0) {
-                buffer[bytesRead] = '\0';
-                std::string message(buffer);
-
-                // Echo back to parent with acknowledgment
-                std::string response = "ECHO: " + message;
-                DWORD bytesWritten;
-                WriteFile(GetStdHandle(STD_OUTPUT_HANDLE), response.c_str(), response.size(), &bytesWritten, nullptr);
-            }
+        const long bytesRead = pipe_read(pipe_stdin(), buffer, sizeof(buffer) - 1);
+        if (bytesRead > 0) {
+            buffer[bytesRead] = '\0';
+            std::string message(buffer);
+
+            // Echo back to parent with acknowledgment
+            std::string response = "ECHO: " + message;
+            pipe_write_all(pipe_stdout(), response.data(), response.size());
         }
         else {
-            DWORD error = GetLastError();
-            if (error == ERROR_BROKEN_PIPE) {
-                std::cout << make_simple_event("child_exiting", "Parent process disconnected") << std::endl;
+            if (bytesRead == 0) {
+                emit_event(make_simple_event("child_exiting", "Parent process disconnected"));
             }
             break;
         }
@@ -1,13 +1,15 @@
 #include "ipc_common.hpp"
+#include "event_writer.hpp"
+#include "shm_platform.hpp"
+#include "timestamp.hpp"
 #include <iostream>
 
 // Cria um evento JSON base com timestamp e PID
 json create_base_event(const std::string& event_type) {
     json event;
     event["event"] = event_type;
-    // TODO (Dia 3): Adicionar timestamp ISO 8601 e PID real.
-    event["ts"] = "2024-01-01T12:00:00Z"; // Placeholder
-    event["pid"] = 0; // Placeholder
+    event["ts"] = iso_timestamp();
+    event["pid"] = current_pid();
     return event;
 }
 
@@ -20,10 +22,14 @@ std::string make_simple_event(const std::string& event_type, const std::string&
 }
 
 std::string make_error_event(const std::string& where, const std::string& message) {
-    json event = create_base_event("error");
-    event["where"] = where;
-    event["message"] = message;
-    return event.dump();
+    // create_base_event("error") + where/message, direto (event_writer.hpp)
+    return std::string(EventWriter()
+        .field("event", "error")
+        .field("message", message)
+        .field("pid", current_pid())
+        .ts()
+        .field("where", where)
+        .finish());
 }
 
 std::optional<json> parse_json_command(const std::string& input) {
@@ -3,27 +3,18 @@
 #include <memory>
 #include <thread>
 #include "ipc_common.hpp"
+#include "event_sink.hpp"
+#include "log.hpp"
 #include "pipe_module.hpp"
 #include "socket_module.hpp"
+#include "shared_memory_module.hpp"
+#include "shm_hub.hpp"
 #include "ipc_manager.hpp"
 
 int main(int argc, char* argv[]) {
-    // Modo filho para pipes - DEVE SER A PRIMEIRA COISA
-    if (argc > 1 && std::string(argv[1]) == "pipe_child") {
-        // Processo filho: modo eco SIMPLES
-        std::string line;
-        while (std::getline(std::cin, line)) {
-            if (!line.empty()) {
-                // Responde com JSON formatado
-                json response;
-                response["event"] = "received";
-                response["text"] = "ECHO: " + line;
-                response["from"] = "child";
-                std::cout << response.dump() << std::endl;
-                std::cout.flush();
-            }
-        }
-        return 0;
+    // Modos filho (pipe_child, shm_child, shm_hub_client) - DEVE SER A PRIMEIRA COISA
+    if (const int rc = IPCManager::run_child_process(argc, argv); rc >= 0) {
+        return rc;
     }
 
     // Configurao inicial para evitar buffering no stdin/stdout
@@ -37,7 +28,7 @@ int main(int argc, char* argv[]) {
     std::string line;
     while (std::getline(std::cin, line)) {
         // DEBUG: Log da linha recebida
-        std::cerr << "DEBUG [INPUT]: " << line << std::endl;
+        LOG_TRACE("INPUT", line);
 
         // Tenta parsear a linha de entrada como JSON
         auto maybe_json = parse_json_command(line);
@@ -52,56 +43,75 @@ int main(int argc, char* argv[]) {
             std::string cmd = command.at("cmd").get<std::string>();
 
             // DEBUG: Log do comando recebido
-            std::cerr << "DEBUG [COMANDO]: " << cmd << std::endl;
+            LOG_TRACE("COMANDO", cmd);
 
             if (cmd == "start") {
                 std::string mechanism = command.at("mechanism").get<std::string>();
-                std::cerr << "DEBUG [MECANISMO]: " << mechanism << std::endl;
+                LOG_DEBUG("MECANISMO", mechanism);
 
-                if (manager.start(mechanism)) {
-                    std::cerr << "DEBUG [START SUCESSO]: Mecanismo " << mechanism << " iniciado" << std::endl;
+                if (manager.start(mechanism, command)) {
+                    LOG_DEBUG("START SUCESSO", "Mecanismo " << mechanism << " iniciado");
                 }
                 else {
-                    std::cerr << "DEBUG [START FALHA]: Falha ao iniciar mecanismo " << mechanism << std::endl;
+                    LOG_WARN("START FALHA", "Falha ao iniciar mecanismo " << mechanism);
                 }
             }
             else if (cmd == "stop") {
-                std::cerr << "DEBUG [STOP]: Parando mecanismo" << std::endl;
+                LOG_DEBUG("STOP", "Parando mecanismo");
                 manager.stop();
-                std::cerr << "DEBUG [STOP COMPLETO]: Mecanismo parado" << std::endl;
+                LOG_DEBUG("STOP COMPLETO", "Mecanismo parado");
             }
             else if (cmd == "send") {
-                std::cerr << "DEBUG [SEND]: Entrou no comando send" << std::endl;
+                LOG_TRACE("SEND", "Entrou no comando send");
 
                 std::string text = command.at("text").get<std::string>();
-                std::cerr << "DEBUG [SEND TEXT]: " << text << std::endl;
+                LOG_TRACE("SEND TEXT", text);
 
-                if (manager.send(text)) {
-                    std::cerr << "DEBUG [SEND SUCESSO]: Mensagem enviada" << std::endl;
+                // "id" opcional: correlao escolhida pelo frontend (seno o mecanismo numera)
+                if (manager.send(text, command.value("key", std::string()), command.value("id", uint64_t(0)))) {
+                    LOG_TRACE("SEND SUCESSO", "Mensagem enviada");
                 }
                 else {
-                    std::cerr << "DEBUG [SEND FALHA]: Falha ao enviar mensagem" << std::endl;
-                    std::cerr << "DEBUG [STATUS ATUAL]: " << manager.get_status() << std::endl;
+                    LOG_WARN("SEND FALHA", "Falha ao enviar mensagem");
+                    LOG_WARN("STATUS ATUAL", manager.get_status());
+                }
+            }
+            else if (cmd == "flush") {
+                if (!manager.flush()) {
+                    LOG_WARN("FLUSH FALHA", "Falha ao esvaziar o buffer de escrita");
                 }
+                EventSink::instance().flush(); // e os eventos j enfileirados para o stdout
+            }
+            else if (cmd == "log_level") {
+                // nvel do log de diagnstico em execuo; s filtra o que foi compilado (log.hpp)
+                log_set_level(parse_log_level(command.value("level", std::string()), log_level()));
+                json ev = create_base_event("log_level");
+                ev["level"] = log_level_name(log_level());
+                ev["compiled_min"] = log_level_name(static_cast<LogLevel>(RA1_LOG_MIN_LEVEL));
+                emit_event(ev);
+            }
+            else if (cmd == "metrics") {
+                // texto OpenMetrics num evento, ou liga/desliga o endpoint local ("serve")
+                emit_event(manager.metrics_command(command));
             }
             else if (cmd == "status") {
-                std::cerr << "DEBUG [STATUS]: Solicitando status" << std::endl;
+                LOG_DEBUG("STATUS", "Solicitando status");
                 std::string status = manager.get_status();
-                std::cerr << "DEBUG [STATUS RESULTADO]: " << status << std::endl;
-                std::cout << status << std::endl;
+                LOG_DEBUG("STATUS RESULTADO", status);
+                emit_event(status);
             }
             else {
-                std::cerr << "DEBUG [COMANDO DESCONHECIDO]: " << cmd << std::endl;
+                LOG_WARN("COMANDO DESCONHECIDO", cmd);
                 std::cerr << make_error_event("unknown_command", "Command not implemented: " + cmd) << std::endl;
             }
 
         }
         catch (const std::exception& e) {
-            std::cerr << "DEBUG [EXCEO]: " << e.what() << std::endl;
+            LOG_WARN("EXCEO", e.what());
             std::cerr << make_error_event("process_command", e.what()) << std::endl;
         }
     }
 
-    std::cout << make_simple_event("backend_stopped") << std::endl;
+    emit_event(make_simple_event("backend_stopped"));
     return 0;
 }
\ No newline at end of file
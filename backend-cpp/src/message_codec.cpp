@@ -0,0 +1,176 @@
+#include "message_codec.hpp"
+
+namespace {
+
+constexpr unsigned char BINARY_MAGIC = 0xB7;
+
+// Bits da máscara: um por campo do esquema. Ordem de escrita: event, mechanism, from,
+// id, text, number, ts, pid (id entrou depois, no bit livre, mas vai antes do texto
+// para que o texto continue podendo ser o último campo; ver encode_head)
+enum : uint8_t {
+    F_EVENT = 1 << 0,
+    F_MECHANISM = 1 << 1,
+    F_FROM = 1 << 2,
+    F_TEXT = 1 << 3,
+    F_NUMBER = 1 << 4,
+    F_TS = 1 << 5,
+    F_PID = 1 << 6,
+    F_ID = 1 << 7,
+};
+
+void put_varint(std::string& out, uint64_t v) {
+    char tmp[10];
+    size_t n = 0;
+    while (v >= 0x80) {
+        tmp[n++] = static_cast<char>((v & 0x7F) | 0x80);
+        v >>= 7;
+    }
+    tmp[n++] = static_cast<char>(v);
+    out.append(tmp, n);
+}
+
+bool get_varint(std::string_view& in, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (in.empty()) return false;
+        const auto b = static_cast<unsigned char>(in.front());
+        in.remove_prefix(1);
+        v |= static_cast<uint64_t>(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+uint64_t zigzag(int64_t v) { return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63); }
+int64_t unzigzag(uint64_t v) { return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); }
+
+void put_string(std::string& out, std::string_view s) {
+    put_varint(out, s.size());
+    out.append(s);
+}
+
+bool get_string(std::string_view& in, std::string_view& s) {
+    uint64_t n;
+    if (!get_varint(in, n) || n > in.size()) return false;
+    s = in.substr(0, n);
+    in.remove_prefix(n);
+    return true;
+}
+
+// Copia um campo string do JSON para o armazenamento do codec (sem realocar se couber)
+std::string_view take_string(const nlohmann::json& j, const char* key, std::string& store) {
+    auto it = j.find(key);
+    if (it == j.end() || !it->is_string()) return {};
+    store = it->get_ref<const std::string&>();
+    return store;
+}
+
+} // namespace
+
+CodecKind parse_codec(const std::string& s) {
+    return s == "binary" ? CodecKind::binary : CodecKind::json;
+}
+
+const char* codec_name(CodecKind k) {
+    return k == CodecKind::binary ? "binary" : "json";
+}
+
+void MessageCodec::encode(const Message& m, std::string& out) const {
+    if (kind_ == CodecKind::json) {
+        out += to_event(m).dump();
+        return;
+    }
+
+    const uint8_t mask = (m.event.empty() ? 0 : F_EVENT) | (m.mechanism.empty() ? 0 : F_MECHANISM) |
+                         (m.from.empty() ? 0 : F_FROM) | (m.text.empty() ? 0 : F_TEXT) |
+                         (m.message_number ? F_NUMBER : 0) | (m.ts ? F_TS : 0) | (m.pid ? F_PID : 0) |
+                         (m.id ? F_ID : 0);
+    out.reserve(out.size() + 64 + m.event.size() + m.mechanism.size() + m.from.size() + m.text.size());
+    out += static_cast<char>(BINARY_MAGIC);
+    out += static_cast<char>(mask);
+    if (mask & F_EVENT) put_string(out, m.event);
+    if (mask & F_MECHANISM) put_string(out, m.mechanism);
+    if (mask & F_FROM) put_string(out, m.from);
+    if (mask & F_ID) put_varint(out, m.id);
+    if (mask & F_TEXT) put_string(out, m.text);
+    if (mask & F_NUMBER) put_varint(out, zigzag(m.message_number));
+    if (mask & F_TS) put_varint(out, zigzag(m.ts));
+    if (mask & F_PID) put_varint(out, m.pid);
+}
+
+bool MessageCodec::decode(std::string_view in, Message& m) {
+    m = Message{};
+
+    if (kind_ == CodecKind::json) {
+        // sem exceções: texto que não é JSON é o caso comum do frontend
+        const auto j = nlohmann::json::parse(in.begin(), in.end(), nullptr, false);
+        if (j.is_discarded() || !j.is_object()) return false;
+        m.event = take_string(j, "event", event_);
+        m.mechanism = take_string(j, "mechanism", mechanism_);
+        m.from = take_string(j, "from", from_);
+        m.text = take_string(j, "text", text_);
+        try {
+            m.id = j.value("id", uint64_t(0));
+            m.message_number = j.value("message_number", int64_t(0));
+            m.ts = j.value("timestamp", int64_t(0));
+            m.pid = j.value("pid", uint32_t(0));
+        }
+        catch (const nlohmann::json::type_error&) {
+            return false; // campo numérico com outro tipo: não é do esquema
+        }
+        return true;
+    }
+
+    if (in.size() < 2 || static_cast<unsigned char>(in[0]) != BINARY_MAGIC) return false;
+    const auto mask = static_cast<uint8_t>(in[1]);
+    in.remove_prefix(2);
+
+    uint64_t v = 0;
+    if ((mask & F_EVENT) && !get_string(in, m.event)) return false;
+    if ((mask & F_MECHANISM) && !get_string(in, m.mechanism)) return false;
+    if ((mask & F_FROM) && !get_string(in, m.from)) return false;
+    if ((mask & F_ID) && !get_varint(in, m.id)) return false;
+    if ((mask & F_TEXT) && !get_string(in, m.text)) return false;
+    if (mask & F_NUMBER) {
+        if (!get_varint(in, v)) return false;
+        m.message_number = unzigzag(v);
+    }
+    if (mask & F_TS) {
+        if (!get_varint(in, v)) return false;
+        m.ts = unzigzag(v);
+    }
+    if (mask & F_PID) {
+        if (!get_varint(in, v)) return false;
+        m.pid = static_cast<uint32_t>(v);
+    }
+    return in.empty();
+}
+
+void MessageCodec::encode_head(const Message& m, size_t tail_bytes, std::string& out) const {
+    const size_t text_len = m.text.size() + tail_bytes;
+    const uint8_t mask = (m.event.empty() ? 0 : F_EVENT) | (m.mechanism.empty() ? 0 : F_MECHANISM) |
+                         (m.from.empty() ? 0 : F_FROM) | (text_len ? F_TEXT : 0) | (m.id ? F_ID : 0);
+    out += static_cast<char>(BINARY_MAGIC);
+    out += static_cast<char>(mask);
+    if (mask & F_EVENT) put_string(out, m.event);
+    if (mask & F_MECHANISM) put_string(out, m.mechanism);
+    if (mask & F_FROM) put_string(out, m.from);
+    if (mask & F_ID) put_varint(out, m.id);
+    if (mask & F_TEXT) {
+        put_varint(out, text_len);
+        out.append(m.text);
+    }
+}
+
+nlohmann::json MessageCodec::to_event(const Message& m) {
+    nlohmann::json j = nlohmann::json::object();
+    if (!m.event.empty()) j["event"] = m.event;
+    if (!m.mechanism.empty()) j["mechanism"] = m.mechanism;
+    if (!m.from.empty()) j["from"] = m.from;
+    if (m.id) j["id"] = m.id;
+    if (!m.text.empty()) j["text"] = m.text;
+    if (m.message_number) j["message_number"] = m.message_number;
+    if (m.ts) j["timestamp"] = m.ts;
+    if (m.pid) j["pid"] = m.pid;
+    return j;
+}
@@ -0,0 +1,139 @@
+#include "metrics_server.hpp"
+#include <chrono>
+#include <cstring>
+#include <string_view>
+
+namespace {
+
+constexpr size_t MAX_REQUEST_BYTES = 8 * 1024;
+
+bool send_all(SOCKET s, const std::string& bytes) {
+    size_t off = 0;
+    while (off < bytes.size()) {
+        const int n = ::send(s, bytes.data() + off, static_cast<int>(bytes.size() - off), SOCKET_SEND_FLAGS);
+        if (n == SOCKET_ERROR || n == 0) return false;
+        off += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+std::string http_response(std::string_view status, std::string_view content_type, const std::string& body) {
+    std::string r;
+    r.reserve(body.size() + 160);
+    r.append("HTTP/1.0 ").append(status).append("\r\n");
+    r.append("Content-Type: ").append(content_type).append("\r\n");
+    r.append("Content-Length: ").append(std::to_string(body.size())).append("\r\n");
+    r.append("Connection: close\r\n\r\n");
+    r.append(body);
+    return r;
+}
+
+// Scraper parado no meio da requisição não prende a thread
+void set_recv_timeout(SOCKET s, int ms) {
+#ifdef _WIN32
+    const DWORD t = static_cast<DWORD>(ms);
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&t), sizeof(t));
+#else
+    timeval tv{};
+    tv.tv_sec = ms / 1000;
+    tv.tv_usec = (ms % 1000) * 1000;
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+#endif
+}
+
+} // namespace
+
+bool MetricsServer::start(const SocketEndpoint& ep, std::string& err) {
+    stop();
+    if (!socket_startup(err)) return false;
+
+    SOCKET ls = open_stream_socket(ep);
+    if (ls == INVALID_SOCKET) {
+        err = "socket failed: " + std::to_string(socket_last_error());
+        socket_cleanup();
+        return false;
+    }
+    int enable = 1;
+    if (!ep.unix_domain) setsockopt(ls, SOL_SOCKET, SO_REUSEADDR, (char*)&enable, sizeof(enable));
+
+    // listening = false: endereço de loopback, o endpoint não fica exposto na rede
+    sockaddr_storage addr;
+    socklen_t len = 0;
+    if (!endpoint_sockaddr(ep, false, addr, len, err)) {
+        closesocket(ls);
+        socket_cleanup();
+        return false;
+    }
+    unlink_endpoint(ep);
+    if (bind(ls, (sockaddr*)&addr, len) == SOCKET_ERROR || listen(ls, 16) == SOCKET_ERROR) {
+        err = "bind/listen on " + ep.describe() + " failed: " + std::to_string(socket_last_error());
+        closesocket(ls);
+        socket_cleanup();
+        return false;
+    }
+
+    endpoint_ = ep;
+    if (!ep.unix_domain) {
+        // port 0 = porta livre escolhida pelo sistema; devolve a real
+        sockaddr_in bound{};
+        socklen_t blen = sizeof(bound);
+        if (getsockname(ls, (sockaddr*)&bound, &blen) == 0) endpoint_.port = ntohs(bound.sin_port);
+    }
+    listen_ = ls;
+    running_.store(true);
+    thread_ = std::thread(&MetricsServer::serve, this, ls);
+    return true;
+}
+
+void MetricsServer::stop() {
+    if (!running_.exchange(false)) return;
+    socket_close(listen_); // acorda o accept
+    listen_ = INVALID_SOCKET;
+    if (thread_.joinable()) thread_.join();
+    unlink_endpoint(endpoint_);
+    socket_cleanup();
+}
+
+void MetricsServer::serve(SOCKET ls) {
+    while (running_.load()) {
+        SOCKET s = accept(ls, nullptr, nullptr);
+        if (s == INVALID_SOCKET) {
+            if (!running_.load()) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(50)); // EMFILE etc.: não gira em falso
+            continue;
+        }
+        respond(s);
+        socket_close(s);
+    }
+}
+
+void MetricsServer::respond(SOCKET s) {
+    set_recv_timeout(s, 1000);
+    std::string req;
+    char buf[1024];
+    while (req.find("\r\n\r\n") == std::string::npos && req.find("\n\n") == std::string::npos &&
+           req.size() < MAX_REQUEST_BYTES) {
+        const int n = recv(s, buf, sizeof(buf), 0);
+        if (n <= 0) break;
+        req.append(buf, static_cast<size_t>(n));
+    }
+
+    // Só a linha de requisição importa: "GET /metrics HTTP/1.1"
+    const std::string_view line = std::string_view(req).substr(0, req.find_first_of("\r\n"));
+    const size_t sp1 = line.find(' ');
+    const std::string_view method = line.substr(0, sp1);
+    std::string_view path = sp1 == std::string_view::npos ? std::string_view() : line.substr(sp1 + 1);
+    path = path.substr(0, path.find(' '));
+    path = path.substr(0, path.find('?'));
+
+    if (method != "GET") {
+        send_all(s, http_response("405 Method Not Allowed", "text/plain; charset=utf-8", "GET /metrics\n"));
+        return;
+    }
+    if (path != "/metrics" && path != "/") {
+        send_all(s, http_response("404 Not Found", "text/plain; charset=utf-8", "GET /metrics\n"));
+        return;
+    }
+    requests_.fetch_add(1, std::memory_order_relaxed);
+    send_all(s, http_response("200 OK", "application/openmetrics-text; version=1.0.0; charset=utf-8", render_()));
+}
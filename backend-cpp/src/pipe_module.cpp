@@ -1,6 +1,12 @@
 #include "pipe_module.hpp"
+#include "event_sink.hpp"
+#include "event_writer.hpp"
 #include "ipc_common.hpp"
-#include <windows.h>
+#include "shm_platform.hpp"
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <string_view>
 #include <thread>
 #include <iostream>
 #include <sstream>
@@ -9,119 +15,117 @@
 // Forward declaration da classe principal
 class IPCManager;
 
+namespace {
+
+// Quadro binary acima de FRAME_MAX_PAYLOAD: recusado no send, antes de chegar ao filho
+std::string frame_limit_error(size_t payload_len) {
+    std::stringstream ss;
+    ss << "message of " << payload_len << " bytes exceeds the frame limit of " << FRAME_MAX_PAYLOAD << " bytes";
+    return ss.str();
+}
+
+} // namespace
+
 PipeModule::PipeModule(IPCManager* manager) : manager_(manager),
 running_(false),
 reader_running_(false),
 messages_sent_(0),
 messages_received_(0),
-read_pipe_(nullptr),
-write_pipe_(nullptr),
-child_process_(nullptr) {
+framing_(FrameMode::line),
+codec_(CodecKind::json),
+dispatch_(PipeDispatch::round_robin),
+next_worker_(0),
+batch_bytes_(0),
+batch_delay_(200),
+flusher_running_(false),
+flushes_{},
+batch_hist_{},
+splice_min_(0) {
 }
 
 PipeModule::~PipeModule() {
     stop();
 }
 
-bool PipeModule::start() {
+bool PipeModule::start(const json& opts) {
     if (running_) return true;
 
-    SECURITY_ATTRIBUTES saAttr;
-    saAttr.nLength = sizeof(SECURITY_ATTRIBUTES);
-    saAttr.bInheritHandle = TRUE;
-    saAttr.lpSecurityDescriptor = nullptr;
-
-    HANDLE hChildStd_IN_Rd = nullptr;
-    HANDLE hChildStd_IN_Wr = nullptr;
-    HANDLE hChildStd_OUT_Rd = nullptr;
-    HANDLE hChildStd_OUT_Wr = nullptr;
-
-    // Create pipes for child process
-    if (!CreatePipe(&hChildStd_OUT_Rd, &hChildStd_OUT_Wr, &saAttr, 0)) {
-        std::cerr << make_error_event("pipe_create", "Failed to create output pipe") << std::endl;
-        return false;
-    }
-
-    if (!CreatePipe(&hChildStd_IN_Rd, &hChildStd_IN_Wr, &saAttr, 0)) {
-        std::cerr << make_error_event("pipe_create", "Failed to create input pipe") << std::endl;
-        CloseHandle(hChildStd_OUT_Rd);
-        CloseHandle(hChildStd_OUT_Wr);
-        return false;
-    }
-
-    // CORREO 1: Pai NO deve herdar os handles que vai usar
-    SetHandleInformation(hChildStd_OUT_Rd, HANDLE_FLAG_INHERIT, 0); // pai l
-    SetHandleInformation(hChildStd_IN_Wr, HANDLE_FLAG_INHERIT, 0);  // pai escreve
-
-    // Create child process
-    PROCESS_INFORMATION piProcInfo;
-    STARTUPINFO siStartInfo;
-    ZeroMemory(&piProcInfo, sizeof(PROCESS_INFORMATION));
-    ZeroMemory(&siStartInfo, sizeof(STARTUPINFO));
-
-    siStartInfo.cb = sizeof(STARTUPINFO);
-    // CORREO 2: Redirecionar stderr para o mesmo pipe do stdout
-    siStartInfo.hStdError = hChildStd_OUT_Wr;
-    siStartInfo.hStdOutput = hChildStd_OUT_Wr;
-    siStartInfo.hStdInput = hChildStd_IN_Rd;
-    siStartInfo.dwFlags |= STARTF_USESTDHANDLES;
-
-    // CORREO 3: Usar caminho do executvel atual
-    wchar_t exePath[MAX_PATH];
-    GetModuleFileNameW(nullptr, exePath, MAX_PATH);
-    std::wstring cmdLine = L"\"" + std::wstring(exePath) + L"\" pipe_child";
-
-    // Converter para TCHAR (suporte a UNICODE/ANSI)
-    std::vector<TCHAR> cmdLineBuffer(cmdLine.begin(), cmdLine.end());
-    cmdLineBuffer.push_back('\0');
-
-    BOOL success = CreateProcess(
-        nullptr,           // Application name
-        cmdLineBuffer.data(), // Command line
-        nullptr,           // Process security attributes
-        nullptr,           // Primary thread security attributes
-        TRUE,              // Handles are inherited
-        CREATE_NO_WINDOW,  // Creation flags
-        nullptr,           // Use parent's environment
-        nullptr,           // Use parent's current directory
-        &siStartInfo,      // STARTUPINFO pointer
-        &piProcInfo        // PROCESS_INFORMATION pointer
-    );
-
-    if (!success) {
-        DWORD error = GetLastError();
-        std::stringstream ss;
-        ss << "Failed to create child process. Error code: " << error;
-        std::cerr << make_error_event("pipe_process", ss.str()) << std::endl;
-
-        CloseHandle(hChildStd_IN_Rd);
-        CloseHandle(hChildStd_IN_Wr);
-        CloseHandle(hChildStd_OUT_Rd);
-        CloseHandle(hChildStd_OUT_Wr);
-        return false;
+    framing_ = parse_frame_mode(opts.value("framing", std::string("line")));
+    codec_ = parse_codec(opts.value("codec", std::string("json")));
+    if (codec_ == CodecKind::binary) framing_ = FrameMode::binary; // payload binrio pode conter '\n'
+    const size_t pipe_bytes = opts.value("pipe_bytes", size_t(1024 * 1024));
+    batch_bytes_ = opts.value("batch_bytes", size_t(0));
+    batch_delay_ = std::chrono::microseconds(opts.value("batch_us", int64_t(200)));
+    splice_min_ = framing_ == FrameMode::binary ? opts.value("splice_min", size_t(1024 * 1024)) : 0;
+    const size_t n_workers = std::max<size_t>(1, opts.value("workers", size_t(1)));
+    const std::string dispatch = opts.value("dispatch", std::string("round_robin"));
+    dispatch_ = dispatch == "least_outstanding" ? PipeDispatch::least_outstanding
+              : dispatch == "hash"              ? PipeDispatch::key_hash
+                                                : PipeDispatch::round_robin;
+    const int work_us = opts.value("work_us", 0);
+    inflight_.reset(opts.value("inflight", size_t(0)));
+
+    // Pipes + processos filhos (o prprio executvel em modo pipe_child), um par por filho
+    std::vector<std::string> args = { "pipe_child",
+                                      frame_mode_name(framing_),
+                                      codec_name(codec_),
+                                      std::to_string(work_us) };
+    workers_.clear();
+    for (size_t i = 0; i < n_workers; ++i) {
+        auto w = std::make_unique<PipeWorker>();
+        w->id = static_cast<int>(i);
+        std::string err;
+        if (!spawn_pipe_child(args, pipe_bytes, w->child, err)) {
+            log_error("pipe_process", err);
+            for (auto& started : workers_) {
+                close_pipe_child(started->child, 2000);
+                pipe_close(started->child.from_child);
+            }
+            workers_.clear();
+            return false;
+        }
+        w->splicer.reset(splice_min_ > 0 ? w->child.pipe_bytes : 0);
+        if (batch_bytes_ > 0) w->batch.reserve(batch_bytes_ + 4096);
+        workers_.push_back(std::move(w));
     }
 
-    // Close handles we don't need in parent
-    CloseHandle(hChildStd_OUT_Wr);
-    CloseHandle(hChildStd_IN_Rd);
-    CloseHandle(piProcInfo.hThread);
-
-    read_pipe_ = hChildStd_OUT_Rd;
-    write_pipe_ = hChildStd_IN_Wr;
-    child_process_ = piProcInfo.hProcess;
     running_ = true;
     messages_sent_ = 0;
     messages_received_ = 0;
+    latency_.reset();
+    next_worker_ = 0;
 
-    // Start reader thread
+    // Start reader thread (uma s, com pipe_poll sobre os pipes de todos os filhos)
     reader_running_ = true;
     reader_thread_ = std::thread(&PipeModule::reader_thread, this);
 
-    // Log do processo filho criado
-    json event = create_base_event("process_created");
-    event["child_pid"] = piProcInfo.dwProcessId;
-    event["mechanism"] = "pipe";
-    std::cout << event.dump() << std::endl;
+    // Coalescncia: a thread de flush cuida do prazo (batch_us); o tamanho  checado no send
+    {
+        std::lock_guard<std::mutex> lk(batch_mutex_);
+        flushes_[0] = flushes_[1] = flushes_[2] = 0;
+        batch_hist_.fill(0);
+        flusher_running_ = batch_bytes_ > 0;
+    }
+    if (batch_bytes_ > 0) {
+        flusher_thread_ = std::thread(&PipeModule::flusher_thread, this);
+    }
+
+    // Log dos processos filhos criados
+    for (const auto& w : workers_) {
+        json event = create_base_event("process_created");
+        event["child_pid"] = w->child.pid;
+        event["worker"] = w->id;
+        event["workers"] = workers_.size();
+        event["dispatch"] = dispatch;
+        event["mechanism"] = "pipe";
+        event["framing"] = frame_mode_name(framing_);
+        event["codec"] = codec_name(codec_);
+        event["pipe_bytes"] = w->child.pipe_bytes;
+        event["batch_bytes"] = batch_bytes_;
+        event["splice_min"] = w->splicer.active() ? splice_min_ : 0;
+        event["inflight"] = inflight_.limit();
+        emit_event(event);
+    }
 
     return true;
 }
@@ -129,109 +133,374 @@ bool PipeModule::start() {
 void PipeModule::stop() {
     if (!running_) return;
 
+    // O que ainda est nos buffers de coalescncia vai aos filhos antes do EOF
+    if (flusher_thread_.joinable()) {
+        flush_all(FlushReason::explicit_);
+        {
+            std::lock_guard<std::mutex> lk(batch_mutex_);
+            flusher_running_ = false;
+        }
+        batch_cv_.notify_all();
+        flusher_thread_.join();
+    }
+
     running_ = false;
     reader_running_ = false;
 
+    // EOF no stdin de cada filho: ele sai, o stdout fecha e o leitor termina quando todos
+    // derem EOF (aps 2 s o filho  encerrado  fora, o que tambm destrava o leitor)
+    for (auto& w : workers_) close_pipe_child(w->child, 2000);
     if (reader_thread_.joinable()) {
         reader_thread_.join();
     }
 
     cleanup();
 
-    json event = create_base_event("stopped");
-    event["mechanism"] = "pipe";
-    event["messages_sent"] = messages_sent_;
-    event["messages_received"] = messages_received_;
-    std::cout << event.dump() << std::endl;
+    static const unsigned long pid = current_pid();
+    EventWriter()
+        .field("event", "stopped")
+        .field("mechanism", "pipe")
+        .field("messages_received", messages_received_.load())
+        .field("messages_sent", messages_sent_.load())
+        .field("pid", pid)
+        .ts()
+        .emit();
 }
 
 void PipeModule::cleanup() {
-    if (read_pipe_) CloseHandle(static_cast<HANDLE>(read_pipe_));
-    if (write_pipe_) CloseHandle(static_cast<HANDLE>(write_pipe_));
-    if (child_process_) CloseHandle(static_cast<HANDLE>(child_process_));
-
-    read_pipe_ = write_pipe_ = child_process_ = nullptr;
+    for (auto& w : workers_) {
+        pipe_close(w->child.to_child);
+        pipe_close(w->child.from_child);
+    }
 }
 
 void PipeModule::reader_thread() {
-    HANDLE hPipe = static_cast<HANDLE>(read_pipe_);
-    char buffer[1024];
-    DWORD bytesRead;
-
-    while (reader_running_) {
-        if (ReadFile(hPipe, buffer, sizeof(buffer) - 1, &bytesRead, nullptr)) {
-            if (bytesRead > 0) {
-                buffer[bytesRead] = '\0';
-                std::string message(buffer);
-
-                if (!message.empty() && message.back() == '\r') message.pop_back(); // trata CRLF
-
-                try {
-                    json j = json::parse(message);        // se o filho mandar JSON, reaproveita
-                    j["event"] = j.value("event", "received");
-                    j["mechanism"] = "pipe";
-                    j["from"] = j.value("from", "child");
-                    if (!j.contains("text")) j["text"] = message;
-
-                    ++messages_received_;
-                    j["message_number"] = messages_received_;
-                    std::cout << j.dump() << std::endl;
-                }
-                catch (...) {
-                    ++messages_received_;
-                    json ev;
-                    ev["event"] = "received";
-                    ev["mechanism"] = "pipe";
-                    ev["from"] = "child";
-                    ev["text"] = message;
-                    ev["bytes"] = bytesRead;       // opcional
-                    ev["message_number"] = messages_received_;
-                    std::cout << ev.dump() << std::endl;
+    // Reagrupa o fluxo em mensagens: uma leitura pode trazer metade de uma mensagem
+    // ou vrias juntas. O read escreve direto no buffer do decodificador (sem alocao
+    // por leitura) e mensagens de qualquer tamanho crescem o buffer uma vez s.
+    // Um decodificador por filho; pipe_poll diz quais pipes tm dados.
+    std::vector<PipeHandle> hs;
+    for (const auto& w : workers_) hs.push_back(w->child.from_child);
+    std::vector<FrameDecoder> decoders(workers_.size(), FrameDecoder(framing_));
+    std::vector<char> ready;
+    size_t open = hs.size();
+    Frame frame;
+    MessageCodec codec(codec_);
+    Message m;
+
+    while (open > 0) {
+        if (pipe_poll(hs, ready, -1) < 0) {
+            std::stringstream ss;
+            ss << "Poll error. Code: " << pipe_last_error();
+            log_error("pipe_read", ss.str());
+            break;
+        }
+        for (size_t i = 0; i < hs.size(); ++i) {
+            if (!ready[i]) continue;
+            PipeWorker& w = *workers_[i];
+            FrameDecoder& in = decoders[i];
+
+            const size_t want = in.read_hint(64 * 1024);
+            const long bytesRead = pipe_read(hs[i], in.prepare(want), want);
+            if (bytesRead <= 0) {
+                // 0 = EOF (filho saiu); < 0 = erro de leitura
+                if (bytesRead < 0 && reader_running_) {
+                    std::stringstream ss;
+                    ss << "Read error. Code: " << pipe_last_error();
+                    log_error("pipe_read", ss.str());
                 }
+                hs[i] = INVALID_PIPE; // sai do poll
+                --open;
+                continue;
+            }
+
+            const uint64_t recv_ns = mono_ns(); // chegada: vale para todos os quadros desta leitura
+            in.commit(static_cast<size_t>(bytesRead));
+            while (in.next(frame)) {
+                std::string_view message = frame.payload;
+
+                if (framing_ == FrameMode::line && !message.empty() && message.back() == '\r') message.remove_suffix(1); // trata CRLF
+                if (message.empty()) continue;
+
+                w.received.fetch_add(1, std::memory_order_relaxed);
+                w.outstanding.fetch_sub(1, std::memory_order_relaxed);
+                // id de correlao: no esquema da resposta ou, no framing binary, no seq do quadro
+                const bool decoded = codec.decode(message, m);
+                const uint64_t id = decoded && m.id ? m.id : framing_ == FrameMode::binary ? frame.seq : 0;
+                uint64_t sent_ns = 0;
+                const int64_t rtt_us = id ? inflight_.complete(id, recv_ns, &sent_ns) : -1;
+                const int number = ++messages_received_;
+                counters_.messages_received.add();
+                counters_.bytes_received.add(message.size());
+                latency_.count(message.size(), recv_ns);
+                if (rtt_us >= 0) latency_.record_rtt(sent_ns, recv_ns);
+
+                // Se o filho mandar o esquema, reaproveita os campos dele; seno o texto vai cru.
+                // Chaves em ordem alfabtica (event_writer.hpp)
+                EventWriter ev;
+                if (!decoded) ev.field("bytes", message.size());
+                ev.field("event", decoded && !m.event.empty() ? m.event : "received")
+                  .field("from", decoded && !m.from.empty() ? m.from : "child");
+                if (id) ev.field("id", id);
+                ev.field("mechanism", "pipe").field("message_number", number);
+                if (decoded && m.pid) ev.field("pid", m.pid);
+                ev.field("recv_ns", recv_ns);
+                if (rtt_us >= 0) ev.field("rtt_us", rtt_us).field("sent_ns", sent_ns);
+                ev.field("text", decoded && !m.text.empty() ? m.text : message);
+                if (decoded && m.ts) ev.field("timestamp", m.ts);
+                ev.field("worker", w.id);
+                ev.emit(true);
+            }
+            if (in.corrupt()) {
+                log_error("pipe_read", "invalid frame header from child");
+                hs[i] = INVALID_PIPE;
+                --open;
             }
         }
-        else {
-            DWORD error = GetLastError();
-            if (error != ERROR_BROKEN_PIPE && reader_running_) {
-                std::stringstream ss;
-                ss << "Read error. Code: " << error;
-                std::cerr << make_error_event("pipe_read", ss.str()) << std::endl;
+    }
+}
+
+void PipeModule::log_error(const std::string& where, const std::string& what) {
+    counters_.errors.add();
+    std::cerr << make_error_event(where, what) << std::endl;
+}
+
+PipeWorker* PipeModule::pick_worker(const std::string& message, const std::string& key) {
+    const size_t n = workers_.size();
+    size_t first = 0;
+    if (n > 1) {
+        switch (dispatch_) {
+        case PipeDispatch::least_outstanding: {
+            // comea do cursor, que gira: empates no caem sempre no filho 0
+            const size_t start = next_worker_.fetch_add(1, std::memory_order_relaxed);
+            PipeWorker* best = nullptr;
+            for (size_t k = 0; k < n; ++k) {
+                PipeWorker* w = workers_[(start + k) % n].get();
+                if (w->failed.load(std::memory_order_relaxed)) continue;
+                if (!best || w->outstanding.load(std::memory_order_relaxed) < best->outstanding.load(std::memory_order_relaxed)) best = w;
             }
+            return best;
+        }
+        case PipeDispatch::key_hash:
+            first = std::hash<std::string_view>{}(key.empty() ? message : key) % n;
+            break;
+        default:
+            first = next_worker_.fetch_add(1, std::memory_order_relaxed) % n;
             break;
         }
     }
+    // Filho derrubado (send_large) no recebe mais nada: vai para o prximo vivo
+    for (size_t k = 0; k < n; ++k) {
+        PipeWorker* w = workers_[(first + k) % n].get();
+        if (!w->failed.load(std::memory_order_relaxed)) return w;
+    }
+    return nullptr;
 }
 
-bool PipeModule::send(const std::string& message) {
+bool PipeModule::send(const std::string& message, const std::string& key, uint64_t id) {
     if (!running_) return false;
 
-    HANDLE hPipe = static_cast<HANDLE>(write_pipe_);
-    DWORD bytesWritten;
-
-    // CORREO 4: Adicionar nova linha para o processo filho
-    std::string payload = message;
-    if (payload.back() != '\n') {
-        payload += '\n';
+    // No espera a resposta: s uma vaga na janela de pedidos em voo. O id vai no seq do
+    // quadro (framing binary) ou dentro da mensagem, e o filho o devolve no eco.
+    uint64_t sent_ns = 0;
+    const uint64_t seq = inflight_.begin(id, &sent_ns);
+    if (seq == 0) {
+        log_error("pipe_send", "in-flight window full (no reply in 5 s)");
+        return false;
     }
 
-    BOOL success = WriteFile(hPipe, payload.c_str(), payload.size(), &bytesWritten, nullptr);
-    if (success) {
-        ++messages_sent_;
-        json event = create_base_event("sent");
-        event["mechanism"] = "pipe";          // << padronizao
-        event["text"] = message;
-        event["bytes"] = bytesWritten;        // se quiser manter
-        event["message_number"] = messages_sent_;
-        std::cout << event.dump() << std::endl;
+    PipeWorker* picked = pick_worker(message, key);
+    if (!picked) {
+        inflight_.cancel(seq);
+        log_error("pipe_send", "no pipe worker left (all failed)");
+        return false;
+    }
+    PipeWorker& w = *picked;
+    size_t frame_bytes = 0;
+    w.outstanding.fetch_add(1, std::memory_order_relaxed); // antes da escrita: a resposta pode chegar j
+
+    if (w.splicer.active() && message.size() >= splice_min_) {
+        if (!send_large(w, message, seq, frame_bytes)) {
+            w.outstanding.fetch_sub(1, std::memory_order_relaxed);
+            inflight_.cancel(seq);
+            return false;
+        }
+        emit_sent(w, message, frame_bytes, seq, sent_ns);
         return true;
     }
+
+    // CORREO 4: Adicionar nova linha para o processo filho (ou cabealho, no modo binary)
+    // Framing line no tem seq: o id vai no esquema, {"id":N,"text":...}
+    std::string body;
+    if (codec_ == CodecKind::binary || framing_ == FrameMode::line) {
+        Message m;
+        m.text = message;
+        m.id = seq;
+        MessageCodec(codec_).encode(m, body);
+    }
+    const std::string_view frame_body = body.empty() ? std::string_view(message) : std::string_view(body);
+    if (framing_ == FrameMode::binary && frame_body.size() > FRAME_MAX_PAYLOAD) {
+        // o FrameDecoder do filho trataria o quadro como fluxo corrompido
+        w.outstanding.fetch_sub(1, std::memory_order_relaxed);
+        inflight_.cancel(seq);
+        log_error("pipe_send", frame_limit_error(frame_body.size()));
+        return false;
+    }
+
+    if (batch_bytes_ > 0) {
+        // Quadro vai direto para o buffer do lote; a escrita no pipe fica para o flush
+        bool full = false;
+        {
+            std::lock_guard<std::mutex> lk(batch_mutex_);
+            const size_t before = w.batch.size();
+            encode_frame(w.batch, framing_, FrameType::data, seq, frame_body);
+            frame_bytes = w.batch.size() - before;
+            w.batch_seqs.push_back(seq);
+            if (w.batch_msgs++ == 0) {
+                w.batch_first = std::chrono::steady_clock::now();
+                batch_cv_.notify_one(); // arma o prazo na thread de flush
+            }
+            full = w.batch.size() >= batch_bytes_;
+        }
+        if (full && !flush_batch(w, FlushReason::size)) return false;
+    }
     else {
-        DWORD error = GetLastError();
+        std::string payload;
+        encode_frame(payload, framing_, FrameType::data, seq, frame_body);
+        // mesmo lock dos lotes e do send_large: quadros de dois send() no se intercalam
+        std::lock_guard<std::mutex> wl(w.write_mutex);
+        if (!pipe_write_all(w.child.to_child, payload.data(), payload.size())) {
+            w.outstanding.fetch_sub(1, std::memory_order_relaxed);
+            inflight_.cancel(seq);
+            std::stringstream ss;
+            ss << "Write error. Code: " << pipe_last_error();
+            log_error("pipe_send", ss.str());
+            return false;
+        }
+        frame_bytes = payload.size();
+    }
+
+    emit_sent(w, message, frame_bytes, seq, sent_ns);
+    return true;
+}
+
+void PipeModule::emit_sent(PipeWorker& w, const std::string& message, size_t frame_bytes, uint64_t seq, uint64_t sent_ns) {
+    static const unsigned long pid = current_pid();
+    const int number = ++messages_sent_;
+    counters_.messages_sent.add();
+    counters_.bytes_sent.add(frame_bytes);
+    w.sent.fetch_add(1, std::memory_order_relaxed);
+    // mesmos campos de create_base_event("sent") + os do envio, em ordem alfabtica
+    EventWriter()
+        .field("bytes", frame_bytes)
+        .field("event", "sent")
+        .field("id", seq)
+        .field("mechanism", "pipe")
+        .field("message_number", number)
+        .field("pid", pid)
+        .field("sent_ns", sent_ns)
+        .field("text", message)
+        .ts()
+        .field("worker", w.id)
+        .emit(true);
+}
+
+bool PipeModule::send_large(PipeWorker& w, const std::string& message, uint64_t seq, size_t& frame_bytes) {
+    // Cabealho do quadro (+ comeo da mensagem no codec binary) por write; o texto sai
+    // direto de 'message' por vmsplice, sem montar o quadro inteiro numa string
+    std::string head(FRAME_HEADER_BYTES, '\0');
+    if (codec_ == CodecKind::binary) {
+        Message m;
+        m.id = seq;
+        MessageCodec(codec_).encode_head(m, message.size(), head);
+    }
+    const size_t payload_len = head.size() - FRAME_HEADER_BYTES + message.size();
+    if (framing_ == FrameMode::binary && payload_len > FRAME_MAX_PAYLOAD) {
+        log_error("pipe_send", frame_limit_error(payload_len));
+        return false;
+    }
+    write_frame_header(head.data(), FrameType::data, 0, seq, payload_len);
+
+    if (batch_bytes_ > 0 && !flush_batch(w, FlushReason::size)) return false; // lote pendente sai antes
+    std::lock_guard<std::mutex> wl(w.write_mutex);
+    if (!pipe_write_all(w.child.to_child, head.data(), head.size()) ||
+        !w.splicer.write(w.child.to_child, message.data(), message.size())) {
         std::stringstream ss;
-        ss << "Write error. Code: " << error;
-        std::cerr << make_error_event("pipe_send", ss.str()) << std::endl;
+        ss << "Write error. Code: " << pipe_last_error();
+        log_error("pipe_send", ss.str());
+        // Pginas de 'message' podem ter ficado no pipe (vmsplice sem o filho ler tudo) e o
+        // quadro saiu pela metade: o filho morre antes de o buffer voltar a quem chamou, e
+        // o worker sai do despacho. O leitor v o EOF e tira o pipe do poll.
+        w.failed.store(true, std::memory_order_relaxed);
+        close_pipe_child(w.child, 0);
         return false;
     }
+    frame_bytes = head.size() + message.size();
+    return true;
+}
+
+bool PipeModule::flush() {
+    if (!running_ || batch_bytes_ == 0) return true;
+    return flush_all(FlushReason::explicit_);
+}
+
+bool PipeModule::flush_all(FlushReason reason) {
+    bool ok = true;
+    for (auto& w : workers_) ok = flush_batch(*w, reason) && ok;
+    return ok;
+}
+
+bool PipeModule::flush_batch(PipeWorker& w, FlushReason reason) {
+    // write_mutex cobre troca + escrita: dois flushes nunca invertem a ordem dos lotes,
+    // e quem s acumula (send) no espera a escrita terminar
+    std::lock_guard<std::mutex> wl(w.write_mutex);
+    size_t msgs = 0;
+    {
+        std::lock_guard<std::mutex> lk(batch_mutex_);
+        if (w.batch_msgs == 0) return true;
+        w.batch_out.clear();
+        w.batch_out.swap(w.batch); // batch herda a capacidade do lote anterior
+        w.batch_out_seqs.clear();
+        w.batch_out_seqs.swap(w.batch_seqs);
+        msgs = w.batch_msgs;
+        w.batch_msgs = 0;
+        ++flushes_[static_cast<int>(reason)];
+        ++batch_hist_[std::min<size_t>(std::bit_width(msgs) - 1, BATCH_BUCKETS - 1)];
+    }
+
+    if (!pipe_write_all(w.child.to_child, w.batch_out.data(), w.batch_out.size())) {
+        // o lote inteiro fica sem eco: devolve as vagas da janela de pedidos em voo
+        w.outstanding.fetch_sub(static_cast<int64_t>(msgs), std::memory_order_relaxed);
+        for (uint64_t seq : w.batch_out_seqs) inflight_.cancel(seq);
+        std::stringstream ss;
+        ss << "Write error. Code: " << pipe_last_error() << " (" << msgs << " messages in batch)";
+        log_error("pipe_send", ss.str());
+        return false;
+    }
+    return true;
+}
+
+void PipeModule::flusher_thread() {
+    std::unique_lock<std::mutex> lk(batch_mutex_);
+    while (flusher_running_) {
+        // lote pendente mais antigo entre os filhos
+        PipeWorker* due = nullptr;
+        for (auto& w : workers_) {
+            if (w->batch_msgs > 0 && (!due || w->batch_first < due->batch_first)) due = w.get();
+        }
+        if (!due) {
+            batch_cv_.wait(lk);
+            continue;
+        }
+        const auto deadline = due->batch_first + batch_delay_;
+        if (std::chrono::steady_clock::now() < deadline) {
+            batch_cv_.wait_until(lk, deadline); // lote pode ter sado por tamanho nesse meio-tempo
+            continue;
+        }
+        lk.unlock();
+        flush_batch(*due, FlushReason::timer);
+        lk.lock();
+    }
 }
 
 std::string PipeModule::get_status() const {
@@ -239,12 +508,112 @@ std::string PipeModule::get_status() const {
     ss << "Pipe Module - ";
     ss << (running_ ? "Running" : "Stopped");
     if (running_) {
-        ss << " | Sent: " << messages_sent_;
-        ss << " | Received: " << messages_received_;
+        ss << " | Sent: " << messages_sent_.load();
+        ss << " | Received: " << messages_received_.load();
     }
     return ss.str();
 }
 
+json PipeModule::status_json() const {
+    json j;
+    j["pipe_running"] = running_.load();
+    j["messages_sent"] = messages_sent_.load();
+    j["messages_received"] = messages_received_.load();
+    latency_.append_json(j); // "latency" (percentis do RTT) e "rate" (janela deslizante)
+    j["framing"] = frame_mode_name(framing_);
+    j["codec"] = codec_name(codec_);
+    j["pipe_bytes"] = workers_.empty() ? 0 : workers_[0]->child.pipe_bytes;
+    j["batch_bytes"] = batch_bytes_;
+    j["splice_min"] = !workers_.empty() && workers_[0]->splicer.active() ? splice_min_ : 0;
+    j["dispatch"] = dispatch_ == PipeDispatch::least_outstanding ? "least_outstanding"
+                  : dispatch_ == PipeDispatch::key_hash          ? "hash"
+                                                                 : "round_robin";
+    // por filho: o despacho e o equilbrio de carga ficam visveis no status
+    uint64_t spliced = 0;
+    json per_worker = json::array();
+    for (const auto& w : workers_) {
+        spliced += w->splicer.spliced_bytes();
+        per_worker.push_back({ { "worker", w->id },
+                               { "pid", w->child.pid },
+                               { "sent", w->sent.load(std::memory_order_relaxed) },
+                               { "received", w->received.load(std::memory_order_relaxed) },
+                               { "outstanding", w->outstanding.load(std::memory_order_relaxed) },
+                               { "failed", w->failed.load(std::memory_order_relaxed) } });
+    }
+    j["spliced_bytes"] = spliced;
+    j["workers"] = per_worker;
+    j["in_flight"] = inflight_.in_flight();
+    j["inflight_limit"] = inflight_.limit();
+    if (batch_bytes_ > 0) {
+        static const char* const labels[BATCH_BUCKETS] = { "1", "2-3", "4-7", "8-15", "16-31", "32-63", "64-127", "128+" };
+        std::lock_guard<std::mutex> lk(batch_mutex_);
+        j["batch_us"] = batch_delay_.count();
+        size_t pending = 0;
+        for (const auto& w : workers_) pending += w->batch_msgs;
+        j["batch_pending"] = pending;
+        j["flush_size"] = flushes_[static_cast<int>(FlushReason::size)];
+        j["flush_timer"] = flushes_[static_cast<int>(FlushReason::timer)];
+        j["flush_explicit"] = flushes_[static_cast<int>(FlushReason::explicit_)];
+        // mensagens por escrita no pipe (quantos lotes caram em cada faixa)
+        json hist = json::object();
+        for (size_t i = 0; i < BATCH_BUCKETS; ++i) hist[labels[i]] = batch_hist_[i];
+        j["batch_hist"] = hist;
+    }
+    return j;
+}
+
 bool PipeModule::is_running() const {
     return running_;
+}
+
+int PipeModule::run_child(FrameMode mode, CodecKind codec_kind, int work_us) {
+    // Processo filho: modo eco SIMPLES. L e escreve direto nos handles (sem traduo de
+    // CRLF do CRT), ento os quadros binrios atravessam intactos.
+    const PipeHandle in = pipe_stdin();
+    const PipeHandle out = pipe_stdout();
+    FrameDecoder decoder(mode);
+    Frame frame;
+    MessageCodec codec(codec_kind);
+    Message request;
+    std::string reply, text, body;
+
+    // O payload chega por read mesmo quando o pai usou vmsplice: as pginas emprestadas
+    // pelo pai no podem seguir adiante por splice (pipe_platform.hpp, PipeSplicer)
+    for (;;) {
+        const size_t want = decoder.read_hint(64 * 1024);
+        const long n = pipe_read(in, decoder.prepare(want), want);
+        if (n <= 0) break;
+        decoder.commit(static_cast<size_t>(n));
+
+        reply.clear();
+        while (decoder.next(frame)) {
+            std::string_view line = frame.payload;
+            if (mode == FrameMode::line && !line.empty() && line.back() == '\r') line.remove_suffix(1);
+            if (line.empty()) continue;
+
+            if (work_us > 0) {
+                // handler "pesado" simulado: ocupa a CPU (no dorme), como um processamento real
+                const auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(work_us);
+                while (std::chrono::steady_clock::now() < until) {
+                }
+            }
+
+            // Responde no codec negociado; mensagem com "text" preserva o texto, seno ecoa a linha
+            const bool decoded = codec.decode(line, request) && !request.text.empty();
+            text.assign("ECHO: ").append(decoded ? request.text : line);
+            Message response;
+            response.event = "received";
+            response.text = text;
+            response.from = "child";
+            response.id = decoded ? request.id : 0; // no framing binary o seq j devolve o id
+            body.clear();
+            codec.encode(response, body);
+            encode_frame(reply, mode, FrameType::data, frame.seq, body);
+        }
+        if (decoder.corrupt()) return 1;
+
+        // Respostas de uma mesma leitura saem numa nica escrita
+        if (!reply.empty() && !pipe_write_all(out, reply.data(), reply.size())) return 1;
+    }
+    return 0;
 }
\ No newline at end of file
@@ -0,0 +1,327 @@
+#include "pipe_platform.hpp"
+#include <chrono>
+#include <thread>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char** environ;
+#endif
+
+// ---------------------- Processo filho ----------------------
+
+bool spawn_pipe_child(const std::vector<std::string>& args, size_t pipe_bytes, PipeChild& out, std::string& err) {
+#ifdef _WIN32
+    SECURITY_ATTRIBUTES saAttr;
+    saAttr.nLength = sizeof(SECURITY_ATTRIBUTES);
+    saAttr.bInheritHandle = TRUE;
+    saAttr.lpSecurityDescriptor = nullptr;
+
+    HANDLE hChildStd_IN_Rd = nullptr;
+    HANDLE hChildStd_IN_Wr = nullptr;
+    HANDLE hChildStd_OUT_Rd = nullptr;
+    HANDLE hChildStd_OUT_Wr = nullptr;
+
+    // nSize é só uma sugestão de buffer para o sistema
+    if (!CreatePipe(&hChildStd_OUT_Rd, &hChildStd_OUT_Wr, &saAttr, static_cast<DWORD>(pipe_bytes))) {
+        err = "Failed to create output pipe: " + std::to_string(GetLastError());
+        return false;
+    }
+    if (!CreatePipe(&hChildStd_IN_Rd, &hChildStd_IN_Wr, &saAttr, static_cast<DWORD>(pipe_bytes))) {
+        err = "Failed to create input pipe: " + std::to_string(GetLastError());
+        CloseHandle(hChildStd_OUT_Rd);
+        CloseHandle(hChildStd_OUT_Wr);
+        return false;
+    }
+
+    // Pai NÃO deve herdar os handles que vai usar
+    SetHandleInformation(hChildStd_OUT_Rd, HANDLE_FLAG_INHERIT, 0); // pai lê
+    SetHandleInformation(hChildStd_IN_Wr, HANDLE_FLAG_INHERIT, 0);  // pai escreve
+
+    PROCESS_INFORMATION piProcInfo;
+    STARTUPINFOW siStartInfo;
+    ZeroMemory(&piProcInfo, sizeof(PROCESS_INFORMATION));
+    ZeroMemory(&siStartInfo, sizeof(STARTUPINFOW));
+    siStartInfo.cb = sizeof(STARTUPINFOW);
+    // stderr vai para o mesmo pipe do stdout
+    siStartInfo.hStdError = hChildStd_OUT_Wr;
+    siStartInfo.hStdOutput = hChildStd_OUT_Wr;
+    siStartInfo.hStdInput = hChildStd_IN_Rd;
+    siStartInfo.dwFlags |= STARTF_USESTDHANDLES;
+
+    // Caminho do executável atual + argumentos
+    wchar_t exePath[MAX_PATH];
+    GetModuleFileNameW(nullptr, exePath, MAX_PATH);
+    std::wstring cmdLine = L"\"" + std::wstring(exePath) + L"\"";
+    for (const auto& a : args) cmdLine += L" " + std::wstring(a.begin(), a.end());
+    std::vector<wchar_t> cmdLineBuffer(cmdLine.begin(), cmdLine.end());
+    cmdLineBuffer.push_back(L'\0');
+
+    if (!CreateProcessW(nullptr, cmdLineBuffer.data(), nullptr, nullptr, TRUE,
+        CREATE_NO_WINDOW, nullptr, nullptr, &siStartInfo, &piProcInfo)) {
+        err = "Failed to create child process. Error code: " + std::to_string(GetLastError());
+        CloseHandle(hChildStd_IN_Rd);
+        CloseHandle(hChildStd_IN_Wr);
+        CloseHandle(hChildStd_OUT_Rd);
+        CloseHandle(hChildStd_OUT_Wr);
+        return false;
+    }
+
+    // Close handles we don't need in parent
+    CloseHandle(hChildStd_OUT_Wr);
+    CloseHandle(hChildStd_IN_Rd);
+    CloseHandle(piProcInfo.hThread);
+
+    out.pid = piProcInfo.dwProcessId;
+    out.process = piProcInfo.hProcess;
+    out.to_child = hChildStd_IN_Wr;
+    out.from_child = hChildStd_OUT_Rd;
+    out.pipe_bytes = pipe_bytes;
+#else
+    // pai escrevendo num filho que morreu: EPIPE em vez de SIGPIPE derrubar o backend
+    std::signal(SIGPIPE, SIG_IGN);
+
+    int to_child[2], from_child[2];
+    if (pipe2(to_child, O_CLOEXEC) != 0) {
+        err = "pipe2 failed: " + std::to_string(errno);
+        return false;
+    }
+    if (pipe2(from_child, O_CLOEXEC) != 0) {
+        err = "pipe2 failed: " + std::to_string(errno);
+        close(to_child[0]);
+        close(to_child[1]);
+        return false;
+    }
+
+    // Capacidade maior = menos trocas de contexto por mensagem grande (falha não é fatal)
+    if (pipe_bytes > 0) {
+        fcntl(to_child[1], F_SETPIPE_SZ, static_cast<int>(pipe_bytes));
+        fcntl(from_child[1], F_SETPIPE_SZ, static_cast<int>(pipe_bytes));
+    }
+    const int effective = fcntl(from_child[1], F_GETPIPE_SZ);
+    out.pipe_bytes = effective > 0 ? static_cast<size_t>(effective) : 0;
+
+    char exePath[4096];
+    const ssize_t n = readlink("/proc/self/exe", exePath, sizeof(exePath) - 1);
+    if (n <= 0) {
+        err = "readlink(/proc/self/exe) failed: " + std::to_string(errno);
+        for (int fd : { to_child[0], to_child[1], from_child[0], from_child[1] }) close(fd);
+        return false;
+    }
+    exePath[n] = '\0';
+
+    std::vector<std::string> copy(args);
+    std::vector<char*> argv;
+    argv.push_back(exePath);
+    for (auto& a : copy) argv.push_back(a.data());
+    argv.push_back(nullptr);
+
+    // stdin/stdout (e stderr) do filho nos pipes; o resto fecha sozinho (O_CLOEXEC)
+    posix_spawn_file_actions_t fa;
+    posix_spawn_file_actions_init(&fa);
+    posix_spawn_file_actions_adddup2(&fa, to_child[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&fa, from_child[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&fa, from_child[1], STDERR_FILENO);
+
+    pid_t pid = -1;
+    const int rc = posix_spawn(&pid, exePath, &fa, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&fa);
+    close(to_child[0]);
+    close(from_child[1]);
+    if (rc != 0) {
+        err = "posix_spawn failed: " + std::to_string(rc);
+        close(to_child[1]);
+        close(from_child[0]);
+        return false;
+    }
+
+    out.pid = static_cast<unsigned long>(pid);
+    out.to_child = to_child[1];
+    out.from_child = from_child[0];
+#endif
+    return true;
+}
+
+void close_pipe_child(PipeChild& child, int timeout_ms) {
+    // Só fecha a escrita: o filho vê EOF e sai, e o leitor do pai drena from_child até o EOF
+    pipe_close(child.to_child);
+#ifdef _WIN32
+    if (!child.process) return;
+    if (WaitForSingleObject(child.process, timeout_ms) == WAIT_TIMEOUT) {
+        TerminateProcess(child.process, 1);
+    }
+    CloseHandle(child.process);
+    child.process = nullptr;
+#else
+    if (child.pid == 0) return;
+    const pid_t pid = static_cast<pid_t>(child.pid);
+    for (int waited = 0; waited < timeout_ms; waited += 10) {
+        if (waitpid(pid, nullptr, WNOHANG) == pid) { child.pid = 0; return; }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+#endif
+    child.pid = 0;
+}
+
+// ---------------------- E/S ----------------------
+
+PipeHandle pipe_stdin() {
+#ifdef _WIN32
+    return GetStdHandle(STD_INPUT_HANDLE);
+#else
+    return STDIN_FILENO;
+#endif
+}
+
+PipeHandle pipe_stdout() {
+#ifdef _WIN32
+    return GetStdHandle(STD_OUTPUT_HANDLE);
+#else
+    return STDOUT_FILENO;
+#endif
+}
+
+long pipe_read(PipeHandle h, void* buf, size_t n) {
+#ifdef _WIN32
+    DWORD got = 0;
+    if (!ReadFile(h, buf, static_cast<DWORD>(n), &got, nullptr)) {
+        return GetLastError() == ERROR_BROKEN_PIPE ? 0 : -1;
+    }
+    return static_cast<long>(got);
+#else
+    for (;;) {
+        const ssize_t got = read(h, buf, n);
+        if (got < 0 && errno == EINTR) continue;
+        return static_cast<long>(got);
+    }
+#endif
+}
+
+bool pipe_write_all(PipeHandle h, const void* data, size_t n) {
+    const char* p = static_cast<const char*>(data);
+    while (n > 0) {
+#ifdef _WIN32
+        DWORD written = 0;
+        if (!WriteFile(h, p, static_cast<DWORD>(n), &written, nullptr)) return false;
+#else
+        const ssize_t written = write(h, p, n);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+#endif
+        p += written;
+        n -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+int pipe_poll(const std::vector<PipeHandle>& hs, std::vector<char>& ready, int timeout_ms) {
+    ready.assign(hs.size(), 0);
+#ifdef _WIN32
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    for (;;) {
+        int n = 0;
+        for (size_t i = 0; i < hs.size(); ++i) {
+            if (hs[i] == INVALID_PIPE) continue;
+            DWORD avail = 0;
+            // falha = pipe quebrado: conta como pronto para o ReadFile ver o EOF
+            if (!PeekNamedPipe(hs[i], nullptr, 0, nullptr, &avail, nullptr) || avail > 0) {
+                ready[i] = 1;
+                ++n;
+            }
+        }
+        if (n > 0) return n;
+        if (timeout_ms >= 0 && std::chrono::steady_clock::now() >= deadline) return 0;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+#else
+    std::vector<pollfd> fds(hs.size());
+    for (size_t i = 0; i < hs.size(); ++i) fds[i] = { hs[i], POLLIN, 0 }; // fd < 0 é ignorado
+    for (;;) {
+        const int n = poll(fds.data(), fds.size(), timeout_ms);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return n;
+        for (size_t i = 0; i < hs.size(); ++i) ready[i] = fds[i].revents != 0;
+        return n;
+    }
+#endif
+}
+
+void pipe_close(PipeHandle& h) {
+    if (h == INVALID_PIPE) return;
+#ifdef _WIN32
+    CloseHandle(h);
+#else
+    close(h);
+#endif
+    h = INVALID_PIPE;
+}
+
+int pipe_last_error() {
+#ifdef _WIN32
+    return static_cast<int>(GetLastError());
+#else
+    return errno;
+#endif
+}
+
+// ---------------------- Cópia zero (Linux) ----------------------
+
+void PipeSplicer::reset(size_t pipe_bytes) {
+    spliced_ = 0;
+#ifndef _WIN32
+    active_ = pipe_bytes > 0;
+#else
+    (void)pipe_bytes;
+    active_ = false;
+#endif
+}
+
+bool PipeSplicer::write(PipeHandle h, const void* data, size_t n) {
+#ifndef _WIN32
+    if (active_) {
+        iovec iov{ const_cast<void*>(data), n };
+        while (iov.iov_len > 0) {
+            const ssize_t r = vmsplice(h, &iov, 1, 0);
+            if (r < 0) {
+                if (errno == EINTR) continue;
+                if ((errno == EINVAL || errno == ENOSYS) && iov.iov_len == n) {
+                    active_ = false; // sem vmsplice para este descritor: segue com write
+                    return pipe_write_all(h, data, n);
+                }
+                return false;
+            }
+            iov.iov_base = static_cast<char*>(iov.iov_base) + r;
+            iov.iov_len -= static_cast<size_t>(r);
+        }
+        spliced_ += n;
+
+        // Devolve o buffer só com o pipe vazio: até lá o leitor ainda lê destas páginas.
+        // Leitor parado por 5 s: erro com as páginas ainda emprestadas; quem chama mata o
+        // leitor antes de mexer no buffer (ver pipe_platform.hpp)
+        const auto until = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        for (unsigned spins = 0;; ++spins) {
+            int queued = 0;
+            if (ioctl(h, FIONREAD, &queued) != 0) return false;
+            if (queued == 0) return true;
+            if (std::chrono::steady_clock::now() >= until) {
+                errno = ETIMEDOUT; // o "Code" do erro de escrita no PipeModule
+                return false;
+            }
+            if (spins < 64) std::this_thread::yield();
+            else std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+#endif
+    return pipe_write_all(h, data, n);
+}
@@ -1,16 +1,15 @@
 ﻿#include "shared_memory_module.hpp"
-#include <chrono>
+#include "event_sink.hpp"
+#include "event_writer.hpp"
+#include "timestamp.hpp"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <sstream>
+#include <vector>
 
 using nlohmann::json;
 
-static std::wstring to_wstr(DWORD v) {
-    wchar_t buf[32];
-    _itow_s(static_cast<int>(v), buf, 10);
-    return std::wstring(buf);
-}
-
 SharedMemoryModule::SharedMemoryModule(IPCManager* manager)
     : manager_(manager) {
 }
@@ -23,218 +22,508 @@ bool SharedMemoryModule::is_running() const {
     return running_.load();
 }
 
-std::wstring SharedMemoryModule::make_name(const wchar_t* base) const {
-    // Gera nomes únicos por PID (evita colisão quando roda múltiplas instâncias)
-    const auto pid = GetCurrentProcessId();
-    return std::wstring(L"Local\\RA1_IPC_SHM_") + base + L"_" + to_wstr(pid);
-}
-
-void SharedMemoryModule::clear_channel(Channel& ch) {
-    ch.len = 0;
-}
-
-bool SharedMemoryModule::write_channel(Channel& ch, const std::string& s) {
-    if (s.size() > SHM_MAX_MSG) return false;
-    // protocolo: primeiro grava len, depois copia bytes
-    // Para evitar o leitor ver len>0 com dados incompletos, zere, copie, depois set len
-    ch.len = 0;
-    memcpy(ch.data, s.data(), s.size());
-    // memory barrier "coarse" (melhoraria com _mm_sfence em x86, mas ok p/ skeleton)
-    ch.len = static_cast<uint32_t>(s.size());
-    return true;
-}
-
-std::string SharedMemoryModule::read_channel(Channel& ch) {
-    const uint32_t n = ch.len;
-    if (n == 0 || n > SHM_MAX_MSG) return {};
-    std::string out(ch.data, ch.data + n);
-    ch.len = 0; // esvazia
-    return out;
-}
-
 json SharedMemoryModule::base_event(const std::string& type) const {
     json j;
     j["event"] = type;
     j["mechanism"] = "shm";
-    j["timestamp"] = static_cast<int64_t>(
-        std::chrono::duration_cast<std::chrono::seconds>(
-            std::chrono::system_clock::now().time_since_epoch()).count());
+    j["ts"] = iso_timestamp();
     return j;
 }
 
-void SharedMemoryModule::log_json(const json& j) const {
-    std::cout << j.dump() << std::endl;
+void SharedMemoryModule::log_json(const json& j, bool data) const {
+    EventSink::instance().emit(j.dump(), data);
 }
 
-void SharedMemoryModule::log_error(const std::string& where, const std::string& what) const {
-    auto j = base_event("error");
-    j["where"] = where;
-    j["message"] = what;
-    log_json(j);
+void SharedMemoryModule::log_error(const std::string& where, const std::string& what) {
+    counters_.errors.add();
+    EventWriter()
+        .field("event", "error")
+        .field("mechanism", "shm")
+        .field("message", what)
+        .ts()
+        .field("where", where)
+        .emit();
 }
 
-bool SharedMemoryModule::start() {
-    if (running_.load()) return true;
+// ---------------------- Mapeamento / sinais ----------------------
 
-    map_name_ = make_name(L"MAP");
-    ev_p2c_name_ = make_name(L"EV_P2C");
-    ev_c2p_name_ = make_name(L"EV_C2P");
-    ev_stop_name_ = make_name(L"EV_STOP");
-
-    // 1) CreateFileMapping + MapViewOfFile
-    hMap_ = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
-        0, static_cast<DWORD>(sizeof(ShmLayout)),
-        map_name_.c_str());
-    if (!hMap_) {
-        log_error("shm_start", "CreateFileMapping failed: " + std::to_string(GetLastError()));
+bool SharedMemoryModule::attach(bool create, unsigned long owner_pid) {
+    // CreateFileMapping/OpenFileMapping (Windows) ou shm_open + mmap (Linux), pelo nome
+    std::string err;
+    const std::string map_name = shm_object_name("SHM_MAP", owner_pid);
+    const bool ok = create ? region_.create(map_name, SHM_MAP_BYTES, err)
+                           : region_.open(map_name, SHM_MAP_BYTES, err);
+    if (!ok) {
+        log_error("shm_map", err);
         return false;
     }
-    layout_ = reinterpret_cast<ShmLayout*>(MapViewOfFile(hMap_, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(ShmLayout)));
-    if (!layout_) {
-        log_error("shm_start", "MapViewOfFile failed: " + std::to_string(GetLastError()));
-        CloseHandle(hMap_); hMap_ = nullptr;
+
+    char* base = static_cast<char*>(region_.data());
+    if (create) {
+        // controle zerado + anéis vazios: P→C logo após o controle, C→P em seguida
+        ctl_ = new (base) ShmControl{};
+        p2c_ = ShmRing::create(base + sizeof(ShmControl), SHM_RING_BYTES);
+        c2p_ = ShmRing::create(base + sizeof(ShmControl) + ShmRing::footprint(SHM_RING_BYTES), SHM_RING_BYTES);
+    }
+    else {
+        ctl_ = reinterpret_cast<ShmControl*>(base);
+        p2c_ = reinterpret_cast<ShmRing*>(base + sizeof(ShmControl));
+        c2p_ = reinterpret_cast<ShmRing*>(base + sizeof(ShmControl) + ShmRing::footprint(SHM_RING_BYTES));
+    }
+
+    // Sinais P→C / C→P: evento nomeado (Windows) ou futex na palavra do controle (Linux)
+    if (!sig_p2c_.attach(&ctl_->p2c, shm_object_name("SHM_EV_P2C", owner_pid), err) ||
+        !sig_c2p_.attach(&ctl_->c2p, shm_object_name("SHM_EV_C2P", owner_pid), err)) {
+        log_error("shm_start", err);
+        detach();
         return false;
     }
+    return true;
+}
 
-    clear_channel(layout_->p2c);
-    clear_channel(layout_->c2p);
+void SharedMemoryModule::detach() {
+    sig_p2c_.detach();
+    sig_c2p_.detach();
+    ctl_ = nullptr;
+    p2c_ = c2p_ = nullptr;
+    reserved_ = nullptr;
+    region_.close();
+}
 
-    // 2) Eventos (auto-reset)
-    ev_p2c_ = CreateEventW(nullptr, FALSE, FALSE, ev_p2c_name_.c_str());
-    ev_c2p_ = CreateEventW(nullptr, FALSE, FALSE, ev_c2p_name_.c_str());
-    ev_stop_ = CreateEventW(nullptr, TRUE, FALSE, ev_stop_name_.c_str()); // manual-reset para broadcast de stop
-    if (!ev_p2c_ || !ev_c2p_ || !ev_stop_) {
-        log_error("shm_start", "CreateEvent failed: " + std::to_string(GetLastError()));
-        stop();
-        return false;
+bool SharedMemoryModule::wait(ShmSignal& s) {
+    return s.wait(ctl_->wait_strategy, ctl_->spin_iters, ctl_->stop);
+}
+
+bool SharedMemoryModule::stop_requested() const {
+    return ctl_->stop.load(std::memory_order_acquire) != 0;
+}
+
+// ---------------------- Mensagens (fragmentação) ----------------------
+
+ShmRing::PushResult SharedMemoryModule::push_message(ShmRing* ring, ShmSignal& sig, uint64_t seq, const std::string& data, bool wait_if_full) {
+    // Publica um registro (cabeçalho de quadro + payload, escritos direto no anel);
+    // anel cheio => acorda o consumidor e tenta de novo (se permitido)
+    auto push_one = [&](const void* src, size_t n, uint16_t flags, bool may_fail) {
+        for (;;) {
+            ShmRing::PushResult r;
+            if (char* dst = ring->reserve(FRAME_HEADER_BYTES + n, &r)) {
+                write_frame_header(dst, FrameType::data, flags, seq, n);
+                std::memcpy(dst + FRAME_HEADER_BYTES, src, n);
+                ring->commit(FRAME_HEADER_BYTES + n);
+                return r;
+            }
+            if (r != ShmRing::PushResult::full || may_fail || stop_requested()) return r;
+            sig.notify();
+            std::this_thread::yield();
+        }
+    };
+
+    // Caso comum: cabe num registro. Uma cópia (string -> anel).
+    if (data.size() <= SHM_CHUNK_BYTES) {
+        return push_one(data.data(), data.size(), 0, !wait_if_full);
+    }
+
+    // Mensagem grande: streaming em fragmentos; o consumidor começa a drenar antes do fim.
+    // Ainda uma cópia por byte do lado produtor (cada chunk vai direto da string para o anel).
+    const uint64_t total = data.size();
+    auto r = push_one(&total, sizeof(total), FRAME_FRAG_BEGIN, false);
+    for (size_t off = 0; r == ShmRing::PushResult::ok && off < data.size(); off += SHM_CHUNK_BYTES) {
+        const size_t n = std::min(SHM_CHUNK_BYTES, data.size() - off);
+        const uint16_t flags = off + n < data.size() ? FRAME_FRAG_MORE : 0;
+        r = push_one(data.data() + off, n, flags, false);
+        sig.notify();
+    }
+    return r;
+}
+
+bool SharedMemoryModule::next_message(ShmRing* ring, Reassembly& r, ShmRecordView& view, std::string_view& msg, uint64_t& seq) {
+    // Próxima mensagem completa. Registro único: 'msg' aponta direto para o anel (emprestado
+    // por 'view' até o chamador liberar). Fragmentada: remontada em r.buf; estado parcial
+    // fica em 'r' entre chamadas. 'seq' = seq do quadro (o id de correlação).
+    Frame f;
+    while (view.acquire(*ring)) {
+        if (!decode_frame(view.bytes(), f)) {
+            view.release();
+            log_error("shm_frame", "invalid frame in ring");
+            continue;
+        }
+        if (f.flags & FRAME_FRAG_BEGIN) {
+            uint64_t total = 0;
+            std::memcpy(&total, f.payload.data(), std::min(sizeof(total), f.payload.size()));
+            view.release();
+            r.buf.clear();
+            r.buf.reserve(total); // sem realocações: uma cópia por byte do lado consumidor
+            r.seq = f.seq;
+            r.active = true;
+            continue;
+        }
+        if (r.active) {
+            if (f.seq != r.seq) {
+                // fragmento de outra mensagem: a remontagem em curso é descartada
+                r.active = false;
+                view.release();
+                log_error("shm_frame", "fragment sequence mismatch");
+                continue;
+            }
+            r.buf.append(f.payload);
+            view.release();
+            if (f.flags & FRAME_FRAG_MORE) continue;
+            r.active = false;
+            msg = r.buf;
+            seq = r.seq;
+            return true;
+        }
+        msg = f.payload;
+        seq = f.seq;
+        return true;
     }
+    return false;
+}
+
+std::string_view SharedMemoryModule::clip_text(std::string_view text) {
+    // Eventos vão para o stdout do frontend: não replica payloads de vários MB na UI.
+    // Cortado: o evento leva também "bytes" (tamanho original) e "truncated"
+    return text.substr(0, SHM_EVENT_TEXT_MAX);
+}
+
+// ---------------------- Processo filho ----------------------
+
+int SharedMemoryModule::run_child(unsigned long parent_pid, int cpu) {
+    if (!attach(false, parent_pid)) return 1;
+
+    pin_current_thread(cpu);
+    ctl_->child_pid.store(static_cast<uint32_t>(current_pid()));
+
+    child_echo_loop();
+
+    detach();
+    return 0;
+}
+
+// ---------------------- Ciclo de vida ----------------------
+
+bool SharedMemoryModule::start(const json& opts) {
+    if (running_.load()) return true;
+
+    process_mode_ = opts.value("mode", std::string("thread")) == "process";
+    const int child_cpu = opts.value("child_cpu", -1);
+    const int reader_cpu = opts.value("reader_cpu", -1);
+    const unsigned long owner_pid = current_pid();
+
+    // 1) Mapeamento nomeado + 2) sinais
+    if (!attach(true, owner_pid)) return false;
+    ctl_->wait_strategy = parse_wait_strategy(opts.value("wait", std::string("block")));
+    ctl_->spin_iters = opts.value("spin_iters", 4096u);
+    ctl_->codec = parse_codec(opts.value("codec", std::string("json")));
+    inflight_.reset(opts.value("inflight", size_t(0)));
 
     running_.store(true);
     messages_sent_.store(0);
     messages_received_.store(0);
+    latency_.reset();
+    send_full_.store(0);
+
+    // 3) Lado "filho":
+    //    - mode=process: processo shm_child anexa pelo nome e roda o eco (IPC real entre espaços de endereço)
+    //    - mode=thread: child_echo_loop numa thread deste processo
+    if (process_mode_) {
+        std::vector<std::string> args = { "shm_child", std::to_string(owner_pid) };
+        if (child_cpu >= 0) args.push_back(std::to_string(child_cpu));
+        std::string err;
+        if (!spawn_self(args, child_, err)) {
+            log_error("shm_process", err);
+            running_.store(false);
+            detach();
+            return false;
+        }
 
-    // 3) Threads:
-    //    - child_echo_loop: simula o "filho", consumindo p2c e produzindo c2p
-    //    - parent_reader_loop: consome c2p e imprime JSON "received"
-    child_thread_ = std::thread(&SharedMemoryModule::child_echo_loop, this);
-    reader_thread_ = std::thread(&SharedMemoryModule::parent_reader_loop, this);
+        // Log do processo filho criado
+        auto ev = base_event("process_created");
+        ev["child_pid"] = child_.pid;
+        log_json(ev);
+    }
+    else {
+        child_thread_ = std::thread([this, child_cpu] {
+            pin_current_thread(child_cpu);
+            child_echo_loop();
+        });
+    }
+
+    // 4) parent_reader_loop: consome c2p e imprime JSON "received"
+    reader_thread_ = std::thread([this, reader_cpu] {
+        pin_current_thread(reader_cpu);
+        parent_reader_loop();
+    });
 
     // evento "started"
     auto j = base_event("started");
     j["message"] = "Shared memory started";
+    j["mode"] = process_mode_ ? "process" : "thread";
+    j["wait"] = wait_strategy_name(ctl_->wait_strategy);
+    j["codec"] = codec_name(ctl_->codec);
+    j["inflight"] = inflight_.limit();
     log_json(j);
     return true;
 }
 
-bool SharedMemoryModule::send(const std::string& msg) {
+size_t SharedMemoryModule::max_record_bytes() const {
+    return SHM_CHUNK_BYTES;
+}
+
+std::span<char> SharedMemoryModule::reserve(size_t n, uint64_t id) {
+    if (!running_.load() || n > SHM_CHUNK_BYTES) return {};
+    if (reserved_) {
+        // reserva anterior sem commit: o anel ainda não publicou nada dela
+        inflight_.cancel(reserved_seq_);
+        reserved_ = nullptr;
+    }
+
+    // A vaga na janela vem antes do registro: a espera (janela cheia) não segura o anel
+    uint64_t sent_ns = 0;
+    const uint64_t seq = inflight_.begin(id, &sent_ns);
+    if (seq == 0) {
+        log_error("shm_send", "in-flight window full (no echo in 5 s)");
+        return {};
+    }
+    char* dst = p2c_->reserve(FRAME_HEADER_BYTES + n);
+    if (!dst) {
+        inflight_.cancel(seq);
+        ++send_full_;
+        sig_p2c_.notify(); // garante que o consumidor está drenando
+        return {};
+    }
+    reserved_ = dst;
+    reserved_len_ = n;
+    reserved_seq_ = seq;
+    reserved_sent_ns_ = sent_ns;
+    return { dst + FRAME_HEADER_BYTES, n };
+}
+
+bool SharedMemoryModule::commit(size_t n) {
+    if (!running_.load() || !reserved_ || n > reserved_len_) return false;
+    write_frame_header(reserved_, FrameType::data, 0, reserved_seq_, n);
+
+    // "sent" como no send(), com o texto lido do payload antes de publicar (depois do
+    // commit o registro já pode ter sido consumido). No codec binary, o texto do Message
+    const std::string_view payload(reserved_ + FRAME_HEADER_BYTES, n);
+    ++messages_sent_;
+    Message m;
+    if (ctl_->codec == CodecKind::binary && MessageCodec(CodecKind::binary).decode(payload, m))
+        log_sent(reserved_seq_, reserved_sent_ns_, m.text);
+    else
+        log_sent(reserved_seq_, reserved_sent_ns_, payload);
+
+    p2c_->commit(FRAME_HEADER_BYTES + n);
+    reserved_ = nullptr;
+    counters_.messages_sent.add();
+    counters_.bytes_sent.add(n);
+    sig_p2c_.notify();
+    return true;
+}
+
+bool SharedMemoryModule::send(const std::string& msg, uint64_t id) {
     if (!running_.load()) return false;
 
-    // Grava no canal P→C e sinaliza
-    if (!write_channel(layout_->p2c, msg)) {
+    // Vaga na janela de pedidos em voo; o id viaja no seq do registro e volta no eco
+    uint64_t sent_ns = 0;
+    const uint64_t seq = inflight_.begin(id, &sent_ns);
+    if (seq == 0) {
+        log_error("shm_send", "in-flight window full (no echo in 5 s)");
+        return false;
+    }
+
+    // Grava no anel P→C e sinaliza; anel cheio = backpressure para quem chamou.
+    // Mensagens grandes são fragmentadas e bloqueiam até o último fragmento entrar no anel.
+    // Codec json: o texto vai como veio (o eco aceita texto ou {"text": ...});
+    // binary: embrulhado no esquema compacto
+    const std::string* data = &msg;
+    if (ctl_->codec == CodecKind::binary) {
+        send_buf_.clear();
+        Message m;
+        m.text = msg;
+        MessageCodec(CodecKind::binary).encode(m, send_buf_);
+        data = &send_buf_;
+    }
+
+    switch (push_message(p2c_, sig_p2c_, seq, *data, false)) {
+    case ShmRing::PushResult::ok:
+        break;
+    case ShmRing::PushResult::full:
+        inflight_.cancel(seq);
+        ++send_full_;
+        sig_p2c_.notify(); // garante que o consumidor está drenando
+        log_error("shm_full", "ring full, retry later");
+        return false;
+    case ShmRing::PushResult::too_large:
+        inflight_.cancel(seq);
         log_error("shm_send", "message too large");
         return false;
     }
     ++messages_sent_;
-    SetEvent(ev_p2c_);
-
-    // log "sent"
-    auto ev = base_event("sent");
-    ev["text"] = msg;
-    ev["message_number"] = messages_sent_.load();
-    log_json(ev);
+    counters_.messages_sent.add();
+    counters_.bytes_sent.add(data->size());
+    sig_p2c_.notify();
+    log_sent(seq, sent_ns, msg);
     return true;
 }
 
+void SharedMemoryModule::log_sent(uint64_t seq, uint64_t sent_ns, std::string_view msg) {
+    // chaves em ordem alfabética (event_writer.hpp)
+    const std::string_view text = clip_text(msg);
+    EventWriter ev;
+    if (text.size() < msg.size()) ev.field("bytes", msg.size());
+    ev.field("event", "sent")
+      .field("id", seq)
+      .field("mechanism", "shm")
+      .field("message_number", messages_sent_.load())
+      .field("sent_ns", sent_ns)
+      .field("text", text);
+    if (text.size() < msg.size()) ev.field("truncated", true);
+    ev.ts().emit(true);
+}
+
 void SharedMemoryModule::stop() {
     if (!running_.load()) return;
 
     running_.store(false);
-    if (ev_stop_) SetEvent(ev_stop_); // acorda threads
+
+    // acorda os dois lados (thread ou processo filho) e espera saírem;
+    // o filho sai sozinho ao ver ctl_->stop, depois de 2 s é encerrado à força
+    ctl_->stop.store(1, std::memory_order_release);
+    sig_p2c_.kick();
+    sig_c2p_.kick();
 
     if (child_thread_.joinable())  child_thread_.join();
     if (reader_thread_.joinable()) reader_thread_.join();
-
-    if (layout_) { UnmapViewOfFile(layout_); layout_ = nullptr; }
-    if (hMap_) { CloseHandle(hMap_); hMap_ = nullptr; }
-
-    if (ev_p2c_) { CloseHandle(ev_p2c_); ev_p2c_ = nullptr; }
-    if (ev_c2p_) { CloseHandle(ev_c2p_); ev_c2p_ = nullptr; }
-    if (ev_stop_) { CloseHandle(ev_stop_); ev_stop_ = nullptr; }
-
-    auto ev = base_event("stopped");
-    ev["message"] = "Shared memory mechanism stopped";
-    ev["messages_sent"] = messages_sent_.load();
-    ev["messages_received"] = messages_received_.load();
-    ev["running"] = false;
-    log_json(ev);
+    if (process_mode_) reap_child(child_, 2000);
+
+    detach();
+
+    EventWriter()
+        .field("event", "stopped")
+        .field("mechanism", "shm")
+        .field("message", "Shared memory mechanism stopped")
+        .field("messages_received", messages_received_.load())
+        .field("messages_sent", messages_sent_.load())
+        .field("running", false)
+        .ts()
+        .emit();
 }
 
 nlohmann::json SharedMemoryModule::status_json() const {
     auto j = base_event("status");
     j["shm_running"] = running_.load();
+    j["shm_mode"] = process_mode_ ? "process" : "thread";
     j["messages_sent"] = messages_sent_.load();
     j["messages_received"] = messages_received_.load();
+    j["send_full"] = send_full_.load();
+    j["in_flight"] = inflight_.in_flight();
+    j["inflight_limit"] = inflight_.limit();
+    latency_.append_json(j); // "latency" (percentis do RTT) e "rate" (janela deslizante)
+    j["ring_bytes"] = SHM_RING_BYTES;
+    if (ctl_) {
+        // wake-ups por lado: spin = resolvido sem dormir; block = custou futex/evento
+        j["wait_strategy"] = wait_strategy_name(ctl_->wait_strategy);
+        j["codec"] = codec_name(ctl_->codec);
+        j["echo_wakeups_spin"] = ctl_->p2c.spin_wakeups.load(std::memory_order_relaxed);
+        j["echo_wakeups_block"] = ctl_->p2c.block_wakeups.load(std::memory_order_relaxed);
+        j["reader_wakeups_spin"] = ctl_->c2p.spin_wakeups.load(std::memory_order_relaxed);
+        j["reader_wakeups_block"] = ctl_->c2p.block_wakeups.load(std::memory_order_relaxed);
+    }
     return j;
 }
 
 // ---------------------- Threads ----------------------
 
 void SharedMemoryModule::child_echo_loop() {
-    // Espera "mensagem do pai" (ev_p2c_) OU "parar" (ev_stop_)
-    HANDLE waits[2] = { ev_p2c_, ev_stop_ };
-
-    while (running_.load()) {
-        DWORD w = WaitForMultipleObjects(2, waits, FALSE, INFINITE);
-        if (w == WAIT_OBJECT_0 + 1) break; // ev_stop_
-
-        // Chegou dado em P→C
-        std::string incoming = read_channel(layout_->p2c);
-        if (incoming.empty()) continue;
-
-        // Monte resposta (sempre JSON de evento "received" com from:"shm_server")
-        json resp = base_event("received");
-        resp["from"] = "shm_server";
-        // Se veio JSON com {"text": "..."} preserva, senão ecoa a linha
-        try {
-            auto j = json::parse(incoming);
-            resp["text"] = std::string("ECHO: ") + (j.contains("text") ? j["text"].get<std::string>() : incoming);
+    // Espera "mensagem do pai" (sig_p2c_) OU "parar" (ctl_->stop)
+    std::string_view incoming;
+    uint64_t seq = 0;
+    ShmRecordView view;
+    Reassembly partial;
+    int echoed = 0;
+    MessageCodec codec(ctl_->codec);
+    Message in;
+    std::string reply_text, out;
+
+    // Drena antes da primeira espera: no modo processo o pai pode ter enviado antes de anexarmos
+    do {
+        // Um wake-up pode cobrir vários registros: drena o anel P→C inteiro
+        while (!stop_requested() && next_message(p2c_, partial, view, incoming, seq)) {
+            // Monte resposta (sempre evento "received" com from:"shm_server", no codec negociado)
+            // Se veio uma mensagem com "text" preserva, senão ecoa o registro (lido direto do anel)
+            const bool decoded = codec.decode(incoming, in) && !in.text.empty();
+            reply_text.assign("ECHO: ").append(decoded ? in.text : incoming);
+            view.release(); // devolve o espaço em P→C antes de (talvez) esperar por espaço em C→P
+
+            Message resp;
+            resp.event = "received";
+            resp.mechanism = "shm";
+            resp.from = "shm_server";
+            resp.text = reply_text;
+            resp.message_number = ++echoed;
+            resp.ts = wall_us();
+
+            // Escreve resposta no anel C→P; se cheio, acorda o leitor e tenta de novo
+            out.clear();
+            codec.encode(resp, out);
+            // a resposta leva o seq do pedido: é a correlação que o leitor do pai fecha
+            if (push_message(c2p_, sig_c2p_, seq, out, true) == ShmRing::PushResult::too_large) {
+                log_error("shm_echo", "reply too large");
+            }
         }
-        catch (...) {
-            resp["text"] = std::string("ECHO: ") + incoming;
-        }
-        resp["message_number"] = messages_received_.load() + 1;
-
-        // Escreve resposta no canal C→P e sinaliza
-        const std::string out = resp.dump();
-        write_channel(layout_->c2p, out);
-        SetEvent(ev_c2p_);
-    }
+        sig_c2p_.notify();
+    } while (wait(sig_p2c_));
 }
 
 void SharedMemoryModule::parent_reader_loop() {
-    HANDLE waits[2] = { ev_c2p_, ev_stop_ };
-
-    while (running_.load()) {
-        DWORD w = WaitForMultipleObjects(2, waits, FALSE, INFINITE);
-        if (w == WAIT_OBJECT_0 + 1) break; // ev_stop_
-
-        // Chegou resposta do "filho"
-        std::string s = read_channel(layout_->c2p);
-        if (s.empty()) continue;
-
-        try {
-            auto j = json::parse(s);
-            ++messages_received_;
-            log_json(j);
-        }
-        catch (...) {
-            // fallback: se não for JSON, embrulhe
+    std::string_view s;
+    uint64_t seq = 0;
+    ShmRecordView view;
+    Reassembly partial;
+    MessageCodec codec(ctl_->codec);
+    Message m;
+
+    while (wait(sig_c2p_)) {
+        // Chegaram respostas do "filho": consome todas as disponíveis, decodificando direto do anel
+        while (next_message(c2p_, partial, view, s, seq)) {
+            const uint64_t recv_ns = mono_ns();
+            uint64_t sent_ns = 0;
+            const int64_t rtt_us = seq ? inflight_.complete(seq, recv_ns, &sent_ns) : -1;
+            counters_.messages_received.add();
+            counters_.bytes_received.add(s.size());
+            latency_.count(s.size(), recv_ns);
+            if (rtt_us >= 0) latency_.record_rtt(sent_ns, recv_ns);
+            // Campos do esquema (to_event) ou, se não decodificar no codec, o texto cru
+            // embrulhado como base_event("received"); as views apontam para o anel, então o
+            // evento é escrito antes do release. Chaves em ordem alfabética (event_writer.hpp)
+            const bool decoded = codec.decode(s, m);
             ++messages_received_;
-            auto j = base_event("received");
-            j["from"] = "shm_server";
-            j["text"] = s;
-            j["message_number"] = messages_received_.load();
-            log_json(j);
+            const std::string_view raw = decoded ? m.text : s;
+            const std::string_view text = clip_text(raw);
+            const uint64_t id = seq ? seq : decoded ? m.id : 0;
+            EventWriter ev;
+            if (text.size() < raw.size()) ev.field("bytes", raw.size());
+            if (!decoded) ev.field("event", "received").field("from", "shm_server");
+            else {
+                if (!m.event.empty()) ev.field("event", m.event);
+                if (!m.from.empty()) ev.field("from", m.from);
+            }
+            if (id) ev.field("id", id);
+            if (!decoded) ev.field("mechanism", "shm").field("message_number", messages_received_.load());
+            else {
+                if (!m.mechanism.empty()) ev.field("mechanism", m.mechanism);
+                if (m.message_number) ev.field("message_number", m.message_number);
+                if (m.pid) ev.field("pid", m.pid);
+            }
+            ev.field("recv_ns", recv_ns);
+            if (rtt_us >= 0) ev.field("rtt_us", rtt_us).field("sent_ns", sent_ns);
+            if (!decoded || !text.empty()) ev.field("text", text);
+            if (decoded && m.ts) ev.field("timestamp", m.ts);
+            if (text.size() < raw.size()) ev.field("truncated", true);
+            if (!decoded) ev.ts();
+            view.release();
+            ev.emit(true);
         }
     }
 }
\ No newline at end of file
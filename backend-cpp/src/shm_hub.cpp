@@ -0,0 +1,478 @@
+#include "shm_hub.hpp"
+#include "event_sink.hpp"
+#include "timestamp.hpp"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+using nlohmann::json;
+
+ShmHub::ShmHub(IPCManager* manager)
+    : manager_(manager) {
+}
+
+ShmHub::~ShmHub() {
+    stop();
+}
+
+bool ShmHub::is_running() const {
+    return running_.load();
+}
+
+json ShmHub::base_event(const std::string& type) const {
+    json j;
+    j["event"] = type;
+    j["mechanism"] = "shm_hub";
+    j["ts"] = iso_timestamp();
+    return j;
+}
+
+void ShmHub::log_json(const json& j) const {
+    emit_event(j);
+}
+
+void ShmHub::log_error(const std::string& where, const std::string& what) {
+    counters_.errors.add();
+    auto j = base_event("error");
+    j["where"] = where;
+    j["message"] = what;
+    log_json(j);
+}
+
+// ---------------------- Mapeamento ----------------------
+
+bool ShmHub::attach(bool create, unsigned long hub_pid) {
+    std::string err;
+    const std::string map_name = shm_object_name("HUB_MAP", hub_pid);
+    const bool ok = create ? region_.create(map_name, HUB_MAP_BYTES, err)
+                           : region_.open(map_name, HUB_MAP_BYTES, err);
+    if (!ok) {
+        log_error("shm_hub_map", err);
+        return false;
+    }
+
+    char* base = static_cast<char*>(region_.data());
+    if (create) {
+        hdr_ = new (base) HubHeader{};
+        for (uint32_t i = 0; i < HUB_MAX_CLIENTS; ++i) {
+            ShmRing::create(req_ring(i), HUB_RING_BYTES);
+            ShmRing::create(resp_ring(i), HUB_RING_BYTES);
+        }
+    }
+    else {
+        hdr_ = reinterpret_cast<HubHeader*>(base);
+    }
+    return true;
+}
+
+void ShmHub::detach() {
+    for (auto& s : bells_) s.detach();
+    for (auto& s : resp_sigs_) s.detach();
+    hdr_ = nullptr;
+    region_.close();
+}
+
+ShmRing* ShmHub::req_ring(uint32_t slot) const {
+    char* base = static_cast<char*>(region_.data()) + sizeof(HubHeader);
+    return reinterpret_cast<ShmRing*>(base + (2 * size_t(slot)) * ShmRing::footprint(HUB_RING_BYTES));
+}
+
+ShmRing* ShmHub::resp_ring(uint32_t slot) const {
+    char* base = static_cast<char*>(region_.data()) + sizeof(HubHeader);
+    return reinterpret_cast<ShmRing*>(base + (2 * size_t(slot) + 1) * ShmRing::footprint(HUB_RING_BYTES));
+}
+
+// ---------------------- Ciclo de vida ----------------------
+
+bool ShmHub::start(const json& opts) {
+    if (running_.load()) return true;
+
+    const uint32_t clients = std::min(opts.value("clients", 4u), HUB_MAX_CLIENTS);
+    const uint32_t threads = std::clamp(opts.value("threads", 1u), 1u, HUB_MAX_THREADS);
+    const uint32_t messages = opts.value("messages", 1000u);
+    const size_t size = opts.value("size", size_t(64));
+    const unsigned long hub_pid = current_pid();
+
+    if (size > HUB_MAX_SIZE) {
+        log_error("shm_hub_start", "size " + std::to_string(size) + " exceeds the hub limit of " +
+                  std::to_string(HUB_MAX_SIZE) + " bytes per request");
+        return false;
+    }
+    if (!attach(true, hub_pid)) return false;
+    hdr_->threads = threads;
+    hdr_->wait_strategy = parse_wait_strategy(opts.value("wait", std::string("block")));
+    hdr_->spin_iters = opts.value("spin_iters", 4096u);
+
+    // Campainhas das threads servidoras + sinal de resposta de cada slot
+    std::string err;
+    bool ok = true;
+    for (uint32_t t = 0; ok && t < threads; ++t)
+        ok = bells_[t].attach(&hdr_->bells[t].sig, shm_object_name("HUB_BELL" + std::to_string(t), hub_pid), err);
+    for (uint32_t i = 0; ok && i < HUB_MAX_CLIENTS; ++i)
+        ok = resp_sigs_[i].attach(&hdr_->slots[i].resp, shm_object_name("HUB_RESP" + std::to_string(i), hub_pid), err);
+    if (!ok) {
+        log_error("shm_hub_start", err);
+        detach();
+        return false;
+    }
+
+    reported_.fill(false);
+    clients_done_.store(0);
+    requests_released_.store(0);
+    clients_spawned_.store(clients);
+    running_.store(true);
+
+    for (uint32_t t = 0; t < threads; ++t)
+        server_threads_.emplace_back([this, t] { server_loop(t); });
+
+    // Clientes: processos "shm_hub_client" que se registram sozinhos num slot livre
+    for (uint32_t i = 0; i < clients; ++i) {
+        ChildProcess child;
+        if (!spawn_self({ "shm_hub_client", std::to_string(hub_pid), std::to_string(messages), std::to_string(size) }, child, err)) {
+            log_error("shm_hub_client", err);
+            break;
+        }
+        children_.push_back(child);
+    }
+    clients_spawned_.store(static_cast<uint32_t>(children_.size()));
+
+    auto j = base_event("started");
+    j["message"] = "Shared memory hub started";
+    j["clients"] = clients_spawned_.load();
+    j["capacity"] = HUB_MAX_CLIENTS;
+    j["threads"] = threads;
+    j["wait"] = wait_strategy_name(hdr_->wait_strategy);
+    log_json(j);
+    return true;
+}
+
+bool ShmHub::send(const std::string&) {
+    log_error("send_failed", "shm_hub is driven by its clients; use status to follow them");
+    return false;
+}
+
+void ShmHub::stop() {
+    if (!running_.load()) return;
+
+    // acorda servidores e clientes ainda esperando resposta; clientes saem ao ver hdr_->stop
+    hdr_->stop.store(1, std::memory_order_release);
+    for (auto& s : bells_) if (s.block()) s.kick();
+    for (auto& s : resp_sigs_) if (s.block()) s.kick();
+
+    for (auto& t : server_threads_) if (t.joinable()) t.join();
+    server_threads_.clear();
+    for (auto& c : children_) reap_child(c, 2000);
+    children_.clear();
+
+    auto j = base_event("stopped");
+    j["message"] = "Shared memory hub stopped";
+    j["clients_done"] = clients_done_.load();
+    j["running"] = false;
+
+    detach();
+    running_.store(false);
+    log_json(j);
+}
+
+// ---------------------- Servidor ----------------------
+
+void ShmHub::server_loop(uint32_t index) {
+    HubDoorbell& bell = hdr_->bells[index];
+    bool backlog = false; // algum anel de resposta estava cheio: não dormir
+
+    while (hdr_->stop.load(std::memory_order_acquire) == 0) {
+        if (!backlog && !bells_[index].wait(hdr_->wait_strategy, hdr_->spin_iters, hdr_->stop)) break;
+        if (backlog) std::this_thread::yield();
+        backlog = false;
+
+        // Só os slots que tocaram a campainha: exchange(0) consome os bits; um cliente que
+        // escrever depois disso volta a marcar o bit e incrementa o sinal
+        for (uint32_t w = 0; w < HUB_MAX_CLIENTS / 64; ++w) {
+            uint64_t bits = bell.pending[w].exchange(0, std::memory_order_acq_rel);
+            while (bits) {
+                const uint32_t b = static_cast<uint32_t>(std::countr_zero(bits));
+                bits &= bits - 1;
+                const uint32_t slot = w * 64 + b;
+
+                if (hdr_->slots[slot].state.load(std::memory_order_acquire) == SLOT_ABANDONED) {
+                    report_client(slot); // dono morto: nada a responder, o release drena os anéis
+                    continue;
+                }
+                if (!serve_slot(slot)) {
+                    bell.pending[w].fetch_or(uint64_t(1) << b, std::memory_order_relaxed);
+                    backlog = true;
+                }
+                else if (hdr_->slots[slot].state.load(std::memory_order_acquire) == SLOT_DONE) {
+                    report_client(slot);
+                }
+            }
+        }
+    }
+}
+
+bool ShmHub::serve_slot(uint32_t slot) {
+    ShmRing* req = req_ring(slot);
+    ShmRing* resp = resp_ring(slot);
+    HubSlot& s = hdr_->slots[slot];
+
+    // Eco zero-copy: lê a requisição direto do anel e escreve a resposta direto no outro
+    ShmRecordView view;
+    uint64_t served = 0;
+    uint64_t bytes = 0;
+    bool ok = true;
+    while (view.acquire(*req)) {
+        const std::string_view in = view.bytes();
+        char* dst = resp->reserve(HUB_ECHO_PREFIX + in.size()); // in <= HUB_MAX_SIZE (run_client)
+        if (!dst) {
+            ok = false; // cliente atrasado: a requisição fica no anel
+            break;
+        }
+        std::memcpy(dst, "ECHO: ", HUB_ECHO_PREFIX);
+        std::memcpy(dst + HUB_ECHO_PREFIX, in.data(), in.size());
+        resp->commit(HUB_ECHO_PREFIX + in.size());
+        bytes += in.size();
+        view.release();
+        ++served;
+    }
+
+    if (served) {
+        s.served.fetch_add(served, std::memory_order_relaxed);
+        counters_.messages_received.add(served);
+        counters_.bytes_received.add(bytes);
+        counters_.messages_sent.add(served);
+        counters_.bytes_sent.add(bytes + served * HUB_ECHO_PREFIX);
+        resp_sigs_[slot].notify();
+    }
+    return ok;
+}
+
+void ShmHub::report_client(uint32_t slot) {
+    if (reported_[slot]) return;
+    reported_[slot] = true;
+
+    auto ev = base_event("client_done");
+    ev.update(slot_json(slot));
+    log_json(ev);
+    release_slot(slot); // antes do hub_done: um status logo depois já vê os slots livres
+
+    if (clients_done_.fetch_add(1) + 1 == clients_spawned_.load()) {
+        auto all = base_event("hub_done");
+        all["clients_done"] = clients_spawned_.load();
+        log_json(all);
+    }
+}
+
+void ShmHub::release_slot(uint32_t slot) {
+    HubSlot& s = hdr_->slots[slot];
+
+    // O cliente já saiu dos dois anéis (DONE vem depois do último release dele): a thread
+    // dona do slot descarta o que sobrou (cliente parado no meio) e zera as métricas
+    ShmRecordView view;
+    while (view.acquire(*req_ring(slot))) view.release();
+    while (view.acquire(*resp_ring(slot))) view.release();
+
+    requests_released_.fetch_add(s.requests.load(std::memory_order_acquire), std::memory_order_relaxed);
+    s.pid.store(0, std::memory_order_relaxed);
+    s.requests.store(0, std::memory_order_relaxed);
+    s.bytes.store(0, std::memory_order_relaxed);
+    s.rtt_sum_ns.store(0, std::memory_order_relaxed);
+    s.rtt_max_ns.store(0, std::memory_order_relaxed);
+    s.t_first_ns.store(0, std::memory_order_relaxed);
+    s.t_last_ns.store(0, std::memory_order_relaxed);
+    s.served.store(0, std::memory_order_relaxed);
+    reported_[slot] = false;
+    hdr_->clients_attached.fetch_sub(1);
+
+    // FREE por último: o próximo CAS de um cliente vê o slot já limpo
+    s.state.store(SLOT_FREE, std::memory_order_release);
+}
+
+// ---------------------- Cliente ----------------------
+
+int ShmHub::run_client(unsigned long hub_pid, uint32_t messages, size_t size) {
+    if (size > HUB_MAX_SIZE) {
+        log_error("shm_hub_client", "size " + std::to_string(size) + " exceeds the hub limit of " +
+                  std::to_string(HUB_MAX_SIZE) + " bytes per request");
+        return 2;
+    }
+    if (!attach(false, hub_pid)) return 1;
+
+    // Registro: primeiro slot livre (CAS FREE -> ACTIVE). Sem nenhum livre, devolve os de
+    // clientes que morreram no meio e espera as threads donas liberarem (até ~1 s)
+    uint32_t slot = HUB_MAX_CLIENTS;
+    for (int attempt = 0; attempt < 100 && slot == HUB_MAX_CLIENTS; ++attempt) {
+        for (uint32_t i = 0; i < HUB_MAX_CLIENTS; ++i) {
+            uint32_t expected = SLOT_FREE;
+            if (hdr_->slots[i].state.compare_exchange_strong(expected, SLOT_ACTIVE, std::memory_order_acq_rel)) {
+                slot = i;
+                break;
+            }
+        }
+        if (slot != HUB_MAX_CLIENTS || hdr_->stop.load(std::memory_order_acquire)) break;
+        if (attempt == 0 && reclaim_dead_slots(hub_pid) == 0) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (slot == HUB_MAX_CLIENTS) {
+        log_error("shm_hub_client", "no free slot (capacity " + std::to_string(HUB_MAX_CLIENTS) + ")");
+        detach();
+        return 2;
+    }
+
+    HubSlot& s = hdr_->slots[slot];
+    s.pid.store(static_cast<uint32_t>(current_pid()), std::memory_order_relaxed);
+    hdr_->clients_attached.fetch_add(1);
+
+    const uint32_t bell_index = slot % hdr_->threads;
+    HubDoorbell& bell = hdr_->bells[bell_index];
+    ShmSignal& bell_sig = bells_[bell_index];
+    ShmSignal& resp_sig = resp_sigs_[slot];
+    std::string err;
+    if (!bell_sig.attach(&bell.sig, shm_object_name("HUB_BELL" + std::to_string(bell_index), hub_pid), err) ||
+        !resp_sig.attach(&s.resp, shm_object_name("HUB_RESP" + std::to_string(slot), hub_pid), err)) {
+        log_error("shm_hub_client", err);
+        // sem campainha o servidor não veria o DONE: devolve o slot (ainda limpo) direto
+        s.pid.store(0, std::memory_order_relaxed);
+        hdr_->clients_attached.fetch_sub(1);
+        s.state.store(SLOT_FREE, std::memory_order_release);
+        detach();
+        return 1;
+    }
+
+    ShmRing* req = req_ring(slot);
+    ShmRing* resp = resp_ring(slot);
+    const uint64_t bit = uint64_t(1) << (slot % 64);
+    auto ring_bell = [&] {
+        bell.pending[slot / 64].fetch_or(bit, std::memory_order_release);
+        bell_sig.notify();
+    };
+
+    const std::string payload(size, 'x');
+    ShmRecordView view;
+    bool stopped = false;
+
+    for (uint32_t n = 0; n < messages && !stopped; ++n) {
+        const uint64_t t0 = mono_ns(); // monotônico: comparável entre processos (timestamp.hpp)
+        while (req->push(payload.data(), payload.size()) != ShmRing::PushResult::ok) {
+            if (hdr_->stop.load(std::memory_order_acquire)) { stopped = true; break; }
+            std::this_thread::yield();
+        }
+        if (stopped) break;
+        ring_bell();
+
+        while (!view.acquire(*resp)) {
+            if (!resp_sig.wait(hdr_->wait_strategy, hdr_->spin_iters, hdr_->stop)) { stopped = true; break; }
+        }
+        if (stopped) break;
+        const size_t got = view.bytes().size();
+        view.release();
+
+        // métricas do slot: só este processo escreve, o servidor só lê (status)
+        const uint64_t t1 = mono_ns();
+        const uint64_t rtt = t1 - t0;
+        if (n == 0) s.t_first_ns.store(t0, std::memory_order_relaxed);
+        s.t_last_ns.store(t1, std::memory_order_relaxed);
+        s.rtt_sum_ns.store(s.rtt_sum_ns.load(std::memory_order_relaxed) + rtt, std::memory_order_relaxed);
+        if (rtt > s.rtt_max_ns.load(std::memory_order_relaxed)) s.rtt_max_ns.store(rtt, std::memory_order_relaxed);
+        s.bytes.store(s.bytes.load(std::memory_order_relaxed) + payload.size() + got, std::memory_order_relaxed);
+        s.requests.store(n + 1, std::memory_order_release);
+    }
+
+    // avisa o servidor (client_done) e solta os sinais/mapeamento
+    s.state.store(SLOT_DONE, std::memory_order_release);
+    ring_bell();
+    detach();
+    return 0;
+}
+
+uint32_t ShmHub::reclaim_dead_slots(unsigned long hub_pid) {
+    uint32_t reclaimed = 0;
+    for (uint32_t i = 0; i < HUB_MAX_CLIENTS; ++i) {
+        HubSlot& s = hdr_->slots[i];
+        if (s.state.load(std::memory_order_acquire) != SLOT_ACTIVE) continue;
+        const uint32_t pid = s.pid.load(std::memory_order_relaxed);
+        if (pid == 0 || process_alive(pid)) continue; // 0: dono entre o CAS e o registro do pid
+
+        uint32_t expected = SLOT_ACTIVE;
+        if (!s.state.compare_exchange_strong(expected, SLOT_ABANDONED, std::memory_order_acq_rel)) continue;
+        if (s.pid.load(std::memory_order_relaxed) != pid) {
+            // o slot foi devolvido e tomado por outro cliente entre a leitura e o CAS
+            expected = SLOT_ABANDONED;
+            s.state.compare_exchange_strong(expected, SLOT_ACTIVE, std::memory_order_acq_rel);
+            continue;
+        }
+
+        // Bit antes do sinal: sem conseguir tocar, o slot sai no próximo toque dessa campainha
+        const uint32_t bell_index = i % hdr_->threads;
+        hdr_->bells[bell_index].pending[i / 64].fetch_or(uint64_t(1) << (i % 64), std::memory_order_release);
+        ShmSignal& bell_sig = bells_[bell_index];
+        std::string err;
+        if (!bell_sig.block() &&
+            !bell_sig.attach(&hdr_->bells[bell_index].sig,
+                             shm_object_name("HUB_BELL" + std::to_string(bell_index), hub_pid), err)) {
+            log_error("shm_hub_client", err);
+            continue;
+        }
+        bell_sig.notify();
+        ++reclaimed;
+    }
+    return reclaimed;
+}
+
+// ---------------------- Status ----------------------
+
+json ShmHub::slot_json(uint32_t slot) const {
+    const HubSlot& s = hdr_->slots[slot];
+    const uint64_t requests = s.requests.load(std::memory_order_acquire);
+    const uint64_t first = s.t_first_ns.load(std::memory_order_relaxed);
+    const uint64_t last = s.t_last_ns.load(std::memory_order_relaxed);
+    const double secs = (requests && last > first) ? (last - first) / 1e9 : 0.0;
+
+    json j;
+    j["slot"] = slot;
+    j["pid"] = s.pid.load(std::memory_order_relaxed);
+    const uint32_t state = s.state.load(std::memory_order_acquire);
+    j["done"] = state == SLOT_DONE;
+    if (state == SLOT_ABANDONED) j["abandoned"] = true; // dono morreu antes do DONE
+    j["requests"] = requests;
+    j["served"] = s.served.load(std::memory_order_relaxed);
+    j["bytes"] = s.bytes.load(std::memory_order_relaxed);
+    j["throughput_msg_s"] = secs > 0 ? requests / secs : 0.0;
+    j["throughput_mb_s"] = secs > 0 ? s.bytes.load(std::memory_order_relaxed) / secs / (1024.0 * 1024.0) : 0.0;
+    j["avg_rtt_us"] = requests ? s.rtt_sum_ns.load(std::memory_order_relaxed) / 1e3 / requests : 0.0;
+    j["max_rtt_us"] = s.rtt_max_ns.load(std::memory_order_relaxed) / 1e3;
+    return j;
+}
+
+json ShmHub::status_json() const {
+    json j;
+    j["shm_hub_running"] = running_.load();
+    if (!hdr_) return j;
+
+    j["capacity"] = HUB_MAX_CLIENTS;
+    j["threads"] = hdr_->threads;
+    j["wait_strategy"] = wait_strategy_name(hdr_->wait_strategy);
+    j["clients_attached"] = hdr_->clients_attached.load(); // slots ocupados agora
+    j["clients_done"] = clients_done_.load();
+
+    json bells = json::array();
+    for (uint32_t t = 0; t < hdr_->threads; ++t) {
+        const ShmSignalBlock& b = hdr_->bells[t].sig;
+        bells.push_back({ { "thread", t },
+                          { "wakeups_spin", b.spin_wakeups.load(std::memory_order_relaxed) },
+                          { "wakeups_block", b.block_wakeups.load(std::memory_order_relaxed) } });
+    }
+    j["doorbells"] = bells;
+
+    json clients = json::array();
+    uint64_t total = requests_released_.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < HUB_MAX_CLIENTS; ++i) {
+        if (hdr_->slots[i].state.load(std::memory_order_acquire) == SLOT_FREE) continue;
+        clients.push_back(slot_json(i));
+        total += clients.back()["requests"].get<uint64_t>();
+    }
+    j["requests_total"] = total;
+    j["clients"] = clients;
+    return j;
+}
@@ -0,0 +1,362 @@
+#include "shm_platform.hpp"
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sched.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char** environ;
+#endif
+
+namespace {
+
+// Dica de spin para o núcleo (libera recursos para o hyperthread irmão)
+inline void cpu_relax() {
+#if defined(_M_X64) || defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+#ifndef _WIN32
+// futex compartilhado entre processos (sem FUTEX_PRIVATE_FLAG: a palavra vive no mapeamento)
+void futex_wait(std::atomic<uint32_t>* word, uint32_t expected) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, nullptr, nullptr, 0);
+}
+void futex_wake(std::atomic<uint32_t>* word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+}
+#endif
+
+} // namespace
+
+unsigned long current_pid() {
+#ifdef _WIN32
+    return GetCurrentProcessId();
+#else
+    return static_cast<unsigned long>(getpid());
+#endif
+}
+
+void pin_current_thread(int cpu) {
+    if (cpu < 0) return;
+#ifdef _WIN32
+    SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu);
+#else
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    sched_setaffinity(0, sizeof(set), &set);
+#endif
+}
+
+std::string shm_object_name(const std::string& base, unsigned long owner_pid) {
+    // Gera nomes únicos por PID do dono (evita colisão quando roda múltiplas instâncias);
+    // o filho recebe esse PID na linha de comando e chega nos mesmos nomes
+#ifdef _WIN32
+    return "Local\\RA1_IPC_" + base + "_" + std::to_string(owner_pid);
+#else
+    return "/RA1_IPC_" + base + "_" + std::to_string(owner_pid);
+#endif
+}
+
+// ---------------------- ShmRegion ----------------------
+
+bool ShmRegion::create(const std::string& name, size_t bytes, std::string& err) {
+    close();
+    name_ = name;
+    bytes_ = bytes;
+    owner_ = true;
+#ifdef _WIN32
+    map_ = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+        static_cast<DWORD>(uint64_t(bytes) >> 32), static_cast<DWORD>(bytes), name.c_str());
+    if (!map_) {
+        err = "CreateFileMapping failed: " + std::to_string(GetLastError());
+        return false;
+    }
+    view_ = MapViewOfFile(map_, FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+    if (!view_) {
+        err = "MapViewOfFile failed: " + std::to_string(GetLastError());
+        close();
+        return false;
+    }
+#else
+    fd_ = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd_ < 0) {
+        err = "shm_open failed: " + std::to_string(errno);
+        owner_ = false;
+        return false;
+    }
+    if (ftruncate(fd_, static_cast<off_t>(bytes)) != 0) {
+        err = "ftruncate failed: " + std::to_string(errno);
+        close();
+        return false;
+    }
+    void* v = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (v == MAP_FAILED) {
+        err = "mmap failed: " + std::to_string(errno);
+        close();
+        return false;
+    }
+    view_ = v;
+#endif
+    return true;
+}
+
+bool ShmRegion::open(const std::string& name, size_t bytes, std::string& err) {
+    close();
+    name_ = name;
+    bytes_ = bytes;
+    owner_ = false;
+#ifdef _WIN32
+    map_ = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name.c_str());
+    if (!map_) {
+        err = "OpenFileMapping failed: " + std::to_string(GetLastError());
+        return false;
+    }
+    view_ = MapViewOfFile(map_, FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+    if (!view_) {
+        err = "MapViewOfFile failed: " + std::to_string(GetLastError());
+        close();
+        return false;
+    }
+#else
+    fd_ = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd_ < 0) {
+        err = "shm_open failed: " + std::to_string(errno);
+        return false;
+    }
+    void* v = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (v == MAP_FAILED) {
+        err = "mmap failed: " + std::to_string(errno);
+        close();
+        return false;
+    }
+    view_ = v;
+#endif
+    return true;
+}
+
+void ShmRegion::close() {
+#ifdef _WIN32
+    if (view_) { UnmapViewOfFile(view_); view_ = nullptr; }
+    if (map_) { CloseHandle(map_); map_ = nullptr; }
+#else
+    if (view_) { munmap(view_, bytes_); view_ = nullptr; }
+    if (fd_ >= 0) { ::close(fd_); fd_ = -1; }
+    if (owner_) shm_unlink(name_.c_str());
+#endif
+    owner_ = false;
+}
+
+// ---------------------- Sinalização ----------------------
+
+ShmWaitStrategy parse_wait_strategy(const std::string& name) {
+    if (name == "spin") return ShmWaitStrategy::spin;
+    if (name == "busy") return ShmWaitStrategy::busy;
+    return ShmWaitStrategy::block;
+}
+
+const char* wait_strategy_name(ShmWaitStrategy s) {
+    static const char* names[] = { "block", "spin", "busy" };
+    return names[static_cast<uint32_t>(s)];
+}
+
+bool ShmSignal::attach(ShmSignalBlock* blk, const std::string& event_name, std::string& err) {
+    detach();
+    blk_ = blk;
+    seen_ = blk_->seq.load();
+#ifdef _WIN32
+    // CreateEvent abre o evento se o outro lado já o criou (auto-reset)
+    ev_ = CreateEventA(nullptr, FALSE, FALSE, event_name.c_str());
+    if (!ev_) {
+        err = "CreateEvent failed: " + std::to_string(GetLastError());
+        blk_ = nullptr;
+        return false;
+    }
+#else
+    (void)event_name;
+    (void)err;
+#endif
+    return true;
+}
+
+void ShmSignal::detach() {
+#ifdef _WIN32
+    if (ev_) { CloseHandle(ev_); ev_ = nullptr; }
+#endif
+    blk_ = nullptr;
+}
+
+void ShmSignal::notify() {
+    // seq_cst em ambos os lados (seq / waiters): ou o consumidor vê o novo seq antes de
+    // dormir, ou nós vemos waiters != 0 e pagamos o syscall de wake
+    blk_->seq.fetch_add(1, std::memory_order_seq_cst);
+    if (blk_->waiters.load(std::memory_order_seq_cst) == 0) return;
+#ifdef _WIN32
+    SetEvent(ev_);
+#else
+    futex_wake(&blk_->seq);
+#endif
+}
+
+void ShmSignal::kick() {
+    blk_->seq.fetch_add(1, std::memory_order_seq_cst);
+#ifdef _WIN32
+    SetEvent(ev_);
+#else
+    futex_wake(&blk_->seq);
+#endif
+}
+
+bool ShmSignal::spin_until_changed(uint32_t budget, const std::atomic<uint32_t>& stop) {
+    // pause com backoff exponencial (1, 2, 4 ... 64 pausas entre leituras)
+    uint32_t backoff = 1;
+    for (uint32_t spent = 0; spent < budget && !stop.load(std::memory_order_relaxed); spent += backoff) {
+        const uint32_t cur = blk_->seq.load(std::memory_order_acquire);
+        if (cur != seen_) { seen_ = cur; return true; }
+        for (uint32_t i = 0; i < backoff; ++i) cpu_relax();
+        if (backoff < 64) backoff <<= 1;
+    }
+    return false;
+}
+
+void ShmSignal::block_until_changed(const std::atomic<uint32_t>& stop) {
+    blk_->waiters.store(1, std::memory_order_seq_cst);
+    const uint32_t cur = blk_->seq.load(std::memory_order_seq_cst);
+    if (cur == seen_ && !stop.load(std::memory_order_acquire)) {
+#ifdef _WIN32
+        WaitForSingleObject(ev_, INFINITE);
+#else
+        futex_wait(&blk_->seq, cur);
+#endif
+    }
+    blk_->waiters.store(0, std::memory_order_relaxed);
+}
+
+bool ShmSignal::wait(ShmWaitStrategy strategy, uint32_t spin_iters, const std::atomic<uint32_t>& stop) {
+    // Contadores distinguem wake-ups resolvidos em spin dos que custaram um bloqueio
+    while (!stop.load(std::memory_order_acquire)) {
+        const uint32_t cur = blk_->seq.load(std::memory_order_acquire);
+        if (cur != seen_) { seen_ = cur; blk_->spin_wakeups.fetch_add(1, std::memory_order_relaxed); return true; }
+
+        if (strategy == ShmWaitStrategy::busy) {
+            cpu_relax();
+            continue;
+        }
+        if (strategy == ShmWaitStrategy::spin && spin_until_changed(spin_iters, stop)) {
+            blk_->spin_wakeups.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        block_until_changed(stop);
+        const uint32_t now = blk_->seq.load(std::memory_order_acquire);
+        if (now != seen_) { seen_ = now; blk_->block_wakeups.fetch_add(1, std::memory_order_relaxed); return true; }
+    }
+    return false;
+}
+
+// ---------------------- Processos filhos ----------------------
+
+bool spawn_self(const std::vector<std::string>& args, ChildProcess& out, std::string& err) {
+#ifdef _WIN32
+    char exePath[MAX_PATH];
+    GetModuleFileNameA(nullptr, exePath, MAX_PATH);
+    std::string cmdLine = "\"" + std::string(exePath) + "\"";
+    for (const auto& a : args) cmdLine += " " + a;
+    std::vector<char> cmdLineBuffer(cmdLine.begin(), cmdLine.end());
+    cmdLineBuffer.push_back('\0');
+
+    STARTUPINFOA si;
+    PROCESS_INFORMATION pi;
+    ZeroMemory(&si, sizeof(si));
+    ZeroMemory(&pi, sizeof(pi));
+    si.cb = sizeof(si);
+
+    if (!CreateProcessA(nullptr, cmdLineBuffer.data(), nullptr, nullptr, FALSE,
+        CREATE_NO_WINDOW, nullptr, nullptr, &si, &pi)) {
+        err = "CreateProcess failed: " + std::to_string(GetLastError());
+        return false;
+    }
+    CloseHandle(pi.hThread);
+    out.handle = pi.hProcess;
+    out.pid = pi.dwProcessId;
+#else
+    char exePath[4096];
+    const ssize_t n = readlink("/proc/self/exe", exePath, sizeof(exePath) - 1);
+    if (n <= 0) {
+        err = "readlink(/proc/self/exe) failed: " + std::to_string(errno);
+        return false;
+    }
+    exePath[n] = '\0';
+
+    std::vector<std::string> copy(args);
+    std::vector<char*> argv;
+    argv.push_back(exePath);
+    for (auto& a : copy) argv.push_back(a.data());
+    argv.push_back(nullptr);
+
+    pid_t pid = -1;
+    const int rc = posix_spawn(&pid, exePath, nullptr, nullptr, argv.data(), environ);
+    if (rc != 0) {
+        err = "posix_spawn failed: " + std::to_string(rc);
+        return false;
+    }
+    out.pid = static_cast<unsigned long>(pid);
+#endif
+    return true;
+}
+
+void reap_child(ChildProcess& child, int timeout_ms) {
+#ifdef _WIN32
+    if (!child.handle) return;
+    if (WaitForSingleObject(child.handle, timeout_ms) == WAIT_TIMEOUT) {
+        TerminateProcess(child.handle, 1);
+    }
+    CloseHandle(child.handle);
+    child.handle = nullptr;
+#else
+    if (child.pid == 0) return;
+    const pid_t pid = static_cast<pid_t>(child.pid);
+    for (int waited = 0; waited < timeout_ms; waited += 10) {
+        if (waitpid(pid, nullptr, WNOHANG) == pid) { child.pid = 0; return; }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+#endif
+    child.pid = 0;
+}
+
+bool process_alive(unsigned long pid) {
+    if (pid == 0) return false;
+#ifdef _WIN32
+    HANDLE h = OpenProcess(SYNCHRONIZE, FALSE, static_cast<DWORD>(pid));
+    if (!h) return GetLastError() == ERROR_ACCESS_DENIED; // existe, só não é nosso
+    const bool alive = WaitForSingleObject(h, 0) == WAIT_TIMEOUT;
+    CloseHandle(h);
+    return alive;
+#else
+    if (kill(static_cast<pid_t>(pid), 0) != 0 && errno != EPERM) return false;
+    // /proc/<pid>/stat: "pid (comm) S ..."; o estado vem depois do último ')'
+    std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+    std::string line;
+    std::getline(stat, line);
+    const size_t p = line.rfind(')');
+    return p == std::string::npos || p + 2 >= line.size() || line[p + 2] != 'Z';
+#endif
+}
@@ -1,6 +1,12 @@
 #include "socket_module.hpp"
+#include "event_sink.hpp"
+#include "event_writer.hpp"
+#include "log.hpp"
 #include "ipc_common.hpp"
 #include "ipc_manager.hpp"
+#include "timestamp.hpp"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <thread>
@@ -11,331 +17,713 @@ SocketModule::~SocketModule() {
     stop();
 }
 
-bool SocketModule::setup_winsock() {
-    WSADATA wsaData;
-    int result = WSAStartup(MAKEWORD(2, 2), &wsaData);
-    if (result != 0) {
-        std::cerr << make_error_event("winsock_init", "WSAStartup failed: " + std::to_string(result)) << std::endl;
+bool SocketModule::setup_sockets() {
+    std::string err;
+    if (!socket_startup(err)) {
+        log_error("winsock_init", err);
         return false;
     }
     return true;
 }
 
-bool SocketModule::start() {
-    if (running_.load()) return true;
+SOCKET SocketModule::open_listen_socket(bool reuse_port) {
+    // Create server socket (TCP ou AF_UNIX, conforme o endpoint)
+    SOCKET ls = open_stream_socket(endpoint_);
+    if (ls == INVALID_SOCKET) {
+        log_error("socket_create", "Failed to create server socket: " + std::to_string(socket_last_error()));
+        return INVALID_SOCKET;
+    }
 
-    // Setup Winsock
-    if (!setup_winsock()) {
-        return false;
+    // Set socket options (s TCP; no AF_UNIX o arquivo antigo  removido antes do bind)
+    int enable = 1;
+    if (!endpoint_.unix_domain &&
+        (setsockopt(ls, SOL_SOCKET, SO_REUSEADDR, (char*)&enable, sizeof(enable)) == SOCKET_ERROR ||
+         (reuse_port && !socket_reuse_port(ls)))) {
+        log_error("socket_option", "Failed to set socket options: " + std::to_string(socket_last_error()));
+        closesocket(ls);
+        return INVALID_SOCKET;
     }
 
-    // Create server socket
-    server_socket_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (server_socket_ == INVALID_SOCKET) {
-        std::cerr << make_error_event("socket_create", "Failed to create server socket: " + std::to_string(WSAGetLastError())) << std::endl;
-        return false;
+    // Bind socket
+    sockaddr_storage server_addr;
+    socklen_t addr_len = 0;
+    std::string err;
+    if (!endpoint_sockaddr(endpoint_, true, server_addr, addr_len, err)) {
+        log_error("socket_bind", err);
+        closesocket(ls);
+        return INVALID_SOCKET;
     }
+    unlink_endpoint(endpoint_); // socket AF_UNIX de uma execuo anterior
 
-    // Set socket options
-    int enable = 1;
-    if (setsockopt(server_socket_, SOL_SOCKET, SO_REUSEADDR, (char*)&enable, sizeof(enable)) == SOCKET_ERROR) {
-        std::cerr << make_error_event("socket_option", "Failed to set socket options: " + std::to_string(WSAGetLastError())) << std::endl;
-        closesocket(server_socket_);
-        return false;
+    if (bind(ls, (sockaddr*)&server_addr, addr_len) == SOCKET_ERROR) {
+        log_error("socket_bind", "Failed to bind " + endpoint_.describe() + ": " + std::to_string(socket_last_error()));
+        closesocket(ls);
+        return INVALID_SOCKET;
     }
 
-    // Bind socket
-    sockaddr_in server_addr;
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_addr.s_addr = INADDR_ANY;
-    server_addr.sin_port = htons(7070);
-
-    if (bind(server_socket_, (sockaddr*)&server_addr, sizeof(server_addr)) == SOCKET_ERROR) {
-        std::cerr << make_error_event("socket_bind", "Failed to bind socket: " + std::to_string(WSAGetLastError())) << std::endl;
-        closesocket(server_socket_);
-        return false;
+    // Listen for connections (no bloqueante: vrios loops podem disputar o mesmo socket)
+    if (listen(ls, SOMAXCONN) == SOCKET_ERROR || !set_nonblocking(ls, true)) {
+        log_error("socket_listen", "Failed to listen on socket: " + std::to_string(socket_last_error()));
+        closesocket(ls);
+        return INVALID_SOCKET;
     }
+    return ls;
+}
+
+bool SocketModule::start(const nlohmann::json& opts) {
+    if (running_.load()) return true;
 
-    // Listen for connections
-    if (listen(server_socket_, 5) == SOCKET_ERROR) {
-        std::cerr << make_error_event("socket_listen", "Failed to listen on socket: " + std::to_string(WSAGetLastError())) << std::endl;
-        closesocket(server_socket_);
+    const size_t connections = std::clamp<size_t>(opts.value("connections", size_t(1)), 1, 16);
+    window_ = std::max(1u, opts.value("window", 64u));
+    inflight_.reset(opts.value("inflight", size_t(0)));
+    const size_t loops = std::clamp<size_t>(opts.value("loop_threads", size_t(1)), 1, 64);
+
+    // Transporte: TCP em 127.0.0.1:7070 (padro) ou AF_UNIX num caminho/nome abstrato
+    endpoint_ = SocketEndpoint{};
+    endpoint_.unix_domain = opts.value("transport", std::string("tcp")) == "unix";
+    endpoint_.path = opts.value("path", endpoint_.unix_domain ? default_unix_socket_path() : std::string());
+    endpoint_.port = opts.value("port", uint16_t(7070));
+    unix_domain_.store(endpoint_.unix_domain);
+    framing_ = parse_frame_mode(opts.value("framing", std::string("line")));
+    codec_ = parse_codec(opts.value("codec", std::string("json")));
+    if (codec_ == CodecKind::binary) framing_ = FrameMode::binary; // payload binrio pode conter '\n'
+
+    // Setup Winsock
+    if (!setup_sockets()) {
         return false;
     }
 
-    running_.store(true);
+    // Um socket de escuta por loop (o kernel distribui os accept); sem SO_REUSEPORT,
+    // todos os loops observam o mesmo socket no bloqueante
+    listen_sockets_.clear();
+    for (size_t i = 0; i < loops; ++i) {
+        // AF_UNIX no tem SO_REUSEPORT: os loops compartilham um nico socket
+        SOCKET ls = open_listen_socket(loops > 1 && !endpoint_.unix_domain);
+        if (ls == INVALID_SOCKET) {
+            if (i > 0) break; // sem SO_REUSEPORT: fica com o primeiro
+            if (loops > 1 && !endpoint_.unix_domain) ls = open_listen_socket(false);
+            if (ls == INVALID_SOCKET) {
+                socket_cleanup();
+                return false;
+            }
+        }
+        listen_sockets_.push_back(ls);
+        if (endpoint_.unix_domain) break;
+    }
 
-    // Start both server and client threads
-    server_thread_ = std::thread(&SocketModule::server_thread, this);
+    {
+        std::lock_guard<std::mutex> lk(listener_mtx_);
+        listener_failed_ = false;
+    }
+    running_.store(true);
+    messages_sent_ = 0;
+    messages_received_.store(0);
+    latency_.reset();
+    reconnects_.store(0);
+    peers_open_.store(0);
+    peers_accepted_.store(0);
+
+    // Pool remetente: as conexes abrem no primeiro send() de cada uma
+    senders_.clear();
+    for (size_t i = 0; i < connections; ++i) senders_.push_back(std::make_unique<SenderConn>());
+    next_sender_.store(0);
+
+    // Start both server loops and client thread
+    for (size_t i = 0; i < loops; ++i) loop_threads_.emplace_back(&SocketModule::loop_thread, this, i);
     client_thread_ = std::thread(&SocketModule::client_thread, this);
 
-    std::cout << make_simple_event("ready", "Socket mechanism started on port 7070") << std::endl;
+    // "ready" s com o listener interno registrado: um eco anterior no teria para onde ir
+    bool registered;
+    {
+        std::unique_lock<std::mutex> lk(listener_mtx_);
+        registered = listener_cv_.wait_for(lk, std::chrono::seconds(5), [this] {
+            return listener_socket_ != INVALID_SOCKET || listener_failed_;
+        }) && !listener_failed_;
+    }
+    if (!registered) {
+        log_error("socket_start", "internal listener not registered");
+        stop();
+        return false;
+    }
+
+    emit_event(make_simple_event("ready", "Socket mechanism started on " + endpoint_.describe()));
     return true;
 }
 
-void SocketModule::server_thread() {
-    sockaddr_in caddr{};
-    int clen = sizeof(caddr);
+// ---------------------- Servidor (loop de eventos) ----------------------
+
+void SocketModule::loop_thread(size_t index) {
+    SOCKET listen_sock = listen_sockets_[index % listen_sockets_.size()];
+
+    SocketPoller poller;
+    std::string err;
+    if (!poller.open(err) || !poller.add(listen_sock)) {
+        log_error("socket_poll", err.empty() ? "poller add failed: " + std::to_string(socket_last_error()) : err);
+        return;
+    }
 
+    PeerMap peers;
+    SOCKET listener = INVALID_SOCKET; // listener aceito por este loop: EPOLLOUT da fila de ecos
+    bool listener_want_write = false;
+    std::vector<PollEvent> events;
     while (running_.load()) {
-        SOCKET s = accept(server_socket_, (sockaddr*)&caddr, &clen);
-        if (s == INVALID_SOCKET) {
-            if (running_.load()) {
-                std::cerr << make_error_event("socket_accept", "accept failed: " + std::to_string(WSAGetLastError())) << std::endl;
-            }
+        // timeout curto s para enxergar running_ == false
+        if (poller.wait(events, 100) < 0) {
+            log_error("socket_poll", "wait failed: " + std::to_string(socket_last_error()));
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
             continue;
         }
 
-        std::cerr << "DEBUG [SERVER]: Client connected " << inet_ntoa(caddr.sin_addr) << ":" << ntohs(caddr.sin_port) << std::endl;
-
-        // ---- Leitura da primeira linha para detectar o listener
-        std::string firstline;
-        {
-            char ch;
-            // bloqueia at receber 1a linha (para o listener vir com o hello imediatamente)
-            while (true) {
-                int r = recv(s, &ch, 1, 0);
-                if (r <= 0) break;
-                if (ch == '\n') break;
-                firstline.push_back(ch);
+        for (const auto& ev : events) {
+            if (ev.sock == listen_sock) {
+                accept_ready(poller, listen_sock, peers);
+                continue;
             }
-        }
-
-        bool is_listener = false;
-        if (!firstline.empty()) {
-            try {
-                auto hello = nlohmann::json::parse(firstline);
-                if (hello.value("role", "") == "listener") {
-                    is_listener = true;
+            if (ev.sock == listener) {
+                if (!on_listener_event(ev)) {
+                    poller.remove(listener);
+                    drop_listener(listener);
+                    listener = INVALID_SOCKET;
                 }
+                continue;
+            }
+            auto it = peers.find(ev.sock);
+            if (it == peers.end()) continue;
+
+            PeerResult r = PeerResult::keep;
+            if (ev.writable && !flush_acks(poller, ev.sock, it->second)) r = PeerResult::close;
+            if (r == PeerResult::keep && ev.readable) {
+                r = on_readable(ev.sock, it->second);
+                if (r == PeerResult::keep && !flush_acks(poller, ev.sock, it->second)) r = PeerResult::close;
             }
-            catch (...) { /* no  JSON; ento  j a 1a mensagem do remetente */ }
-        }
 
-        if (is_listener) {
-            // Registra o socket aceito como canal de broadcast para o frontend
-            {
-                std::lock_guard<std::mutex> lk(listener_mtx_);
-                if (listener_socket_ != INVALID_SOCKET) {
-                    closesocket(listener_socket_);
+            if (r == PeerResult::close) {
+                close_peer(poller, peers, ev.sock);
+            }
+            else if (r == PeerResult::listener) {
+                // sai dos remetentes: o socket do listener s recebe ecos (server -> frontend)
+                // e fica neste poller para o EPOLLOUT da fila de sada e para ver o fechamento
+                const SOCKET s = ev.sock;
+                peers.erase(it);
+                --peers_open_;
+                if (register_listener(s)) {
+                    listener = s;
+                    listener_want_write = false;
+                }
+                else {
+                    poller.remove(s);
+                    closesocket(s);
                 }
-                listener_socket_ = s;
             }
-            std::cout << make_simple_event("socket_listener_registered", "frontend listener ready") << std::endl;
-            // NO bloqueie lendo desse socket; ele  s para envio (server -> frontend)
-            continue; // volta a aceitar prximos clientes remetentes
         }
 
-        // ---- A partir daqui, 's'  um cliente remetente (envia mensagens)
-        // Se houve uma 1a linha no-hello, processe-a como parte da mensagem
-        std::string acc;
-        if (!firstline.empty()) {
-            acc = firstline + "\n";
+        // Ecos que no couberam no socket (de qualquer loop): EPOLLOUT s enquanto houver
+        // fila. Um eco de outro loop espera no mximo um ciclo de wait (100 ms) por aqui,
+        // e o prximo handle_message j tenta escrever de novo
+        if (listener != INVALID_SOCKET) {
+            const bool pending = listener_pending_.load(std::memory_order_acquire);
+            if (pending != listener_want_write && poller.modify(listener, pending)) listener_want_write = pending;
         }
+    }
 
-        char buf[1024];
-        while (running_.load()) {
-            int n = 0;
-            if (!acc.empty()) {
-                // j temos dados na 'acc'; pule o recv primeiro
-            }
-            else {
-                n = recv(s, buf, sizeof(buf), 0);
-                if (n <= 0) {
-                    std::cerr << "DEBUG [SERVER]: Sender disconnected" << std::endl;
-                    break;
-                }
-                acc.append(buf, n);
+    for (auto& [s, c] : peers) closesocket(s);
+    peers_open_ -= static_cast<int>(peers.size());
+}
+
+void SocketModule::accept_ready(SocketPoller& poller, SOCKET listen_sock, PeerMap& peers) {
+    while (running_.load()) {
+        sockaddr_storage caddr{};
+        socklen_t clen = sizeof(caddr);
+        SOCKET s = accept(listen_sock, (sockaddr*)&caddr, &clen);
+        if (s == INVALID_SOCKET) {
+            // outro loop levou a conexo, ou acabou o backlog
+            if (!socket_would_block() && running_.load()) {
+                log_error("socket_accept", "accept failed: " + std::to_string(socket_last_error()));
             }
+            return;
+        }
+
+        if (!endpoint_.unix_domain) {
+            int nodelay = 1;
+            setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (char*)&nodelay, sizeof(nodelay));
+        }
+        if (!set_nonblocking(s, true) || !poller.add(s)) {
+            closesocket(s);
+            continue;
+        }
+        peers.emplace(s, PeerConn(framing_, codec_));
+        ++peers_open_;
+        ++peers_accepted_;
 
-            size_t pos;
-            while ((pos = acc.find('\n')) != std::string::npos) {
-                std::string line = acc.substr(0, pos);
-                acc.erase(0, pos + 1);
+        if (caddr.ss_family == AF_INET) {
+            const auto* in = reinterpret_cast<const sockaddr_in*>(&caddr);
+            LOG_DEBUG("SERVER", "Client connected " << inet_ntoa(in->sin_addr) << ":" << ntohs(in->sin_port));
+        }
+        else {
+            LOG_DEBUG("SERVER", "Client connected " << endpoint_.describe());
+        }
+    }
+}
 
-                ++messages_received_;
-                std::cerr << "DEBUG [SERVER RECEIVED FROM SENDER]: " << line << std::endl;
+SocketModule::PeerResult SocketModule::on_readable(SOCKET s, PeerConn& c) {
+    // Drena o que estiver disponvel (limitado, para no monopolizar o loop),
+    // lendo direto para o buffer de enquadramento
+    bool closed = false;
+    for (int reads = 0; reads < 4; ++reads) {
+        const size_t want = c.in.read_hint(16384);
+        int n = recv(s, c.in.prepare(want), static_cast<int>(want), 0);
+        if (n > 0) {
+            c.in.commit(n);
+            if (n < static_cast<int>(want)) break;
+            continue;
+        }
+        if (n < 0 && socket_would_block()) break;
+        closed = true; // 0 = peer fechou; erro = conexo perdida
+        break;
+    }
 
-                // Monte SEMPRE JSON de resposta para o frontend
-                nlohmann::json resp = create_base_event("received");
-                resp["from"] = "socket_server";
+    Frame f;
+    while (c.in.next(f)) {
+        // ---- 1o quadro: o listener se identifica (quadro hello, ou {"role":"listener"} no modo line)
+        if (!c.greeted) {
+            c.greeted = true;
+            if (f.type == FrameType::hello) return PeerResult::listener;
+            if (framing_ == FrameMode::line) {
                 try {
-                    auto j = nlohmann::json::parse(line);
-                    resp["text"] = std::string("ECHO: ") + (j.contains("text") ? j["text"].get<std::string>() : line);
-                }
-                catch (...) {
-                    resp["text"] = std::string("ECHO: ") + line;
-                }
-                resp["message_number"] = messages_received_;
-
-                // ENVIE o JSON para o LISTENER pelo socket ACEITO correspondente
-                {
-                    std::lock_guard<std::mutex> lk(listener_mtx_);
-                    if (listener_socket_ != INVALID_SOCKET) {
-                        std::string out = resp.dump() + "\n";
-                        int send_result = ::send(listener_socket_, out.c_str(), static_cast<int>(out.size()), 0);
-                        if (send_result == SOCKET_ERROR) {
-                            std::cerr << "DEBUG [SERVER -> LISTENER SEND ERROR]: " << WSAGetLastError() << std::endl;
-                        }
-                    }
-                    else {
-                        std::cerr << "DEBUG [SERVER]: No listener socket registered yet" << std::endl;
+                    auto hello = nlohmann::json::parse(f.payload);
+                    if (hello.is_object() && hello.value("role", "") == "listener") {
+                        return PeerResult::listener;
                     }
                 }
+                catch (...) { /* no  JSON; ento  j a 1a mensagem do remetente */ }
+            }
+        }
 
-                // (Opcional) ACK simples de volta ao remetente
-                const char* ack = "ACK\n";
-                int ack_result = ::send(s, ack, 4, 0);
-                if (ack_result == SOCKET_ERROR) {
-                    std::cerr << "DEBUG [SERVER -> SENDER ACK ERROR]: " << WSAGetLastError() << std::endl;
-                }
+        handle_message(f.payload, f.seq, c.codec);
+        // ACK por quadro; quadros que chegaram juntos (pipelining) saem num nico send
+        encode_frame(c.out, framing_, FrameType::ack, f.seq, framing_ == FrameMode::line ? "ACK" : "");
+    }
+    if (c.in.corrupt()) {
+        log_error("socket_frame", "invalid frame header from sender");
+        return PeerResult::close;
+    }
 
-            }
+    if (closed) {
+        LOG_DEBUG("SERVER", "Sender disconnected");
+        return PeerResult::close;
+    }
+    return PeerResult::keep;
+}
+
+bool SocketModule::flush_acks(SocketPoller& poller, SOCKET s, PeerConn& c) {
+    while (!c.out.empty()) {
+        int n = ::send(s, c.out.data(), static_cast<int>(c.out.size()), SOCKET_SEND_FLAGS);
+        if (n > 0) {
+            c.out.erase(0, n);
+            continue;
+        }
+        if (n < 0 && socket_would_block()) {
+            // socket cheio: termina quando ficar gravvel
+            if (!c.want_write) c.want_write = poller.modify(s, true);
+            return true;
         }
+        LOG_WARN("SERVER -> SENDER ACK ERROR", socket_last_error());
+        return false;
+    }
+    if (c.want_write) c.want_write = !poller.modify(s, false);
+    return true;
+}
+
+void SocketModule::close_peer(SocketPoller& poller, PeerMap& peers, SOCKET s) {
+    poller.remove(s);
+    closesocket(s);
+    peers.erase(s);
+    --peers_open_;
+    emit_event(make_simple_event("socket_disconnected", "Sender disconnected"));
+}
 
-        closesocket(s);
-        std::cout << make_simple_event("socket_disconnected", "Sender disconnected") << std::endl;
+bool SocketModule::register_listener(SOCKET s) {
+    // Registra o socket aceito como canal de broadcast para o frontend. Continua no
+    // bloqueante: o que no couber fica em listener_out_ e sai no EPOLLOUT do loop dono
+    {
+        std::lock_guard<std::mutex> lk(listener_mtx_);
+        if (listener_socket_ != INVALID_SOCKET) {
+            LOG_WARN("SERVER", "listener already registered; extra listener closed");
+            return false;
+        }
+        listener_socket_ = s;
+        listener_out_.clear();
+        listener_pending_.store(false);
     }
+    listener_cv_.notify_all();
+    emit_event(make_simple_event("socket_listener_registered", "frontend listener ready"));
+    return true;
 }
 
-void SocketModule::client_thread() {
-    // Este  o cliente INTERNO que se conecta para receber ecos (APENAS ESCUTA)
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+bool SocketModule::on_listener_event(const PollEvent& ev) {
+    if (ev.readable) {
+        // depois do hello o listener no manda nada: leitura aqui  fechamento (ou sobra descartada)
+        char scratch[256];
+        const int n = recv(ev.sock, scratch, sizeof(scratch), 0);
+        if (n == 0 || (n < 0 && !socket_would_block())) return false;
+    }
+    if (ev.writable) {
+        std::lock_guard<std::mutex> lk(listener_mtx_);
+        if (listener_socket_ == ev.sock && !flush_listener_locked()) {
+            LOG_WARN("SERVER -> LISTENER SEND ERROR", socket_last_error());
+            listener_out_.clear();
+            listener_pending_.store(false);
+        }
+    }
+    return true;
+}
 
-    SOCKET c = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (c == INVALID_SOCKET) {
-        std::cerr << make_error_event("socket_create", "internal client invalid: " + std::to_string(WSAGetLastError())) << std::endl;
-        return;
+bool SocketModule::flush_listener_locked() {
+    size_t off = 0;
+    bool ok = true;
+    while (off < listener_out_.size()) {
+        int n = ::send(listener_socket_, listener_out_.data() + off, static_cast<int>(listener_out_.size() - off), SOCKET_SEND_FLAGS);
+        if (n > 0) {
+            off += static_cast<size_t>(n);
+            continue;
+        }
+        ok = n < 0 && socket_would_block(); // socket cheio: o resto sai no EPOLLOUT
+        break;
     }
+    listener_out_.erase(0, off);
+    listener_pending_.store(ok && !listener_out_.empty(), std::memory_order_release);
+    return ok;
+}
 
-    sockaddr_in s{};
-    s.sin_family = AF_INET;
-    s.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
-    s.sin_port = htons(7070);
+void SocketModule::drop_listener(SOCKET s) {
+    {
+        std::lock_guard<std::mutex> lk(listener_mtx_);
+        if (listener_socket_ != s) return; // j fechado pelo stop()
+        closesocket(listener_socket_);
+        listener_socket_ = INVALID_SOCKET;
+        listener_out_.clear();
+        listener_pending_.store(false);
+    }
+    LOG_DEBUG("SERVER", "Listener connection closed");
+}
 
-    if (connect(c, (sockaddr*)&s, sizeof(s)) == SOCKET_ERROR) {
-        std::cerr << make_error_event("socket_connect", "internal client connect failed: " + std::to_string(WSAGetLastError())) << std::endl;
-        closesocket(c);
+void SocketModule::handle_message(std::string_view line, uint64_t seq, MessageCodec& codec) {
+    const int number = ++messages_received_;
+    LOG_TRACE("SERVER RECEIVED FROM SENDER", line);
+
+    // Monte SEMPRE o evento de resposta para o frontend, no codec negociado;
+    // se veio uma mensagem com "text" preserva, seno ecoa a linha
+    Message in;
+    const bool decoded = codec.decode(line, in) && !in.text.empty();
+    const std::string text = std::string("ECHO: ").append(decoded ? in.text : line);
+    const std::string mechanism = mechanism_name();
+
+    Message resp;
+    resp.event = "received";
+    resp.mechanism = mechanism;
+    resp.from = "socket_server";
+    resp.text = text;
+    // correlao: id do esquema ou, no framing binary, o seq do quadro do remetente
+    resp.id = decoded && in.id ? in.id : framing_ == FrameMode::binary ? seq : 0;
+    resp.message_number = number;
+    resp.ts = wall_us();
+    std::string body;
+    codec.encode(resp, body);
+
+    // ENVIE o JSON para o LISTENER pelo socket ACEITO correspondente: vai para a fila de
+    // sada e escreve o que couber sem bloquear (um listener lento no trava os loops)
+    std::lock_guard<std::mutex> lk(listener_mtx_);
+    if (listener_socket_ == INVALID_SOCKET || listener_out_.size() >= LISTENER_OUT_MAX) {
+        // eco perdido: devolve a vaga do id na janela (seno send() esperaria por ele)
+        if (resp.id) inflight_.cancel(resp.id);
+        if (listener_socket_ == INVALID_SOCKET) LOG_WARN("SERVER", "No listener socket registered yet");
+        else LOG_WARN("SERVER", "listener queue full, echo dropped");
+        return;
+    }
+    encode_frame(listener_out_, framing_, FrameType::data, static_cast<uint64_t>(number), body);
+    if (!flush_listener_locked()) {
+        LOG_WARN("SERVER -> LISTENER SEND ERROR", socket_last_error());
+        listener_out_.clear(); // o loop dono v o fechamento e descarta o listener
+    }
+}
+
+void SocketModule::client_thread() {
+    // Este  o cliente INTERNO que se conecta para receber ecos (APENAS ESCUTA). O listen
+    // j aconteceu no start(), que espera este socket ser registrado pelo servidor
+    SOCKET c = connect_endpoint();
+    if (c == INVALID_SOCKET) {
+        log_error("socket_connect", "internal client connect failed: " + std::to_string(socket_last_error()));
+        {
+            std::lock_guard<std::mutex> lk(listener_mtx_);
+            listener_failed_ = true;
+        }
+        listener_cv_.notify_all();
         return;
     }
 
     // Guarda o socket do cliente interno e marca como conectado
     client_socket_ = c;
     connected_.store(true);
-    std::cerr << "DEBUG [CLIENT]: Internal client connected successfully (LISTENER)" << std::endl;
+    LOG_DEBUG("CLIENT", "Internal client connected successfully (LISTENER)");
 
     // >>> ADICIONE: handshake para o servidor reconhecer este socket como listener
-    const char* hello = "{\"role\":\"listener\"}\n";
-    ::send(c, hello, static_cast<int>(strlen(hello)), 0);
-
-    std::string acc;
-    char buf[1024];
+    std::string hello;
+    encode_frame(hello, framing_, FrameType::hello, 0, "{\"role\":\"listener\"}");
+    ::send(c, hello.data(), static_cast<int>(hello.size()), SOCKET_SEND_FLAGS);
+
+    FrameDecoder acc(framing_);
+    Frame f;
+    MessageCodec codec(codec_);
+    Message m;
     while (running_.load()) {
-        int n = recv(c, buf, sizeof(buf), 0);
+        const size_t want = acc.read_hint(16384);
+        int n = recv(c, acc.prepare(want), static_cast<int>(want), 0);
         if (n <= 0) {
-            std::cerr << "DEBUG [CLIENT]: Internal listener connection lost" << std::endl;
+            LOG_DEBUG("CLIENT", "Internal listener connection lost");
             break;
         }
-        acc.append(buf, n);
-        size_t pos;
-        while ((pos = acc.find('\n')) != std::string::npos) {
-            std::string line = acc.substr(0, pos);
-            acc.erase(0, pos + 1);
-            if (!line.empty() && line.back() == '\r') line.pop_back();
+        const uint64_t recv_ns = mono_ns();
+        acc.commit(n);
+        while (acc.next(f)) {
+            std::string_view line = f.payload;
+            if (framing_ == FrameMode::line && !line.empty() && line.back() == '\r') line.remove_suffix(1);
             if (line.empty()) continue;
 
             // DEBUG: Mostre o que est chegando
-            std::cerr << "DEBUG [CLIENT RECEIVED FROM SERVER]: " << line << std::endl;
-
-            try {
-                auto j = nlohmann::json::parse(line);
-                std::cout << j.dump() << std::endl;  // reemita o JSON "puro"
+            LOG_TRACE("CLIENT RECEIVED FROM SERVER", line);
+            counters_.messages_received.add();
+            counters_.bytes_received.add(line.size());
+            latency_.count(line.size(), recv_ns);
+
+            if (codec.decode(line, m)) {
+                // reemite o esquema como JSON "puro" (os campos de to_event) + os instantes,
+                // com as chaves em ordem alfabtica (event_writer.hpp)
+                uint64_t sent_ns = 0;
+                const int64_t rtt_us = m.id ? inflight_.complete(m.id, recv_ns, &sent_ns) : -1;
+                if (rtt_us >= 0) latency_.record_rtt(sent_ns, recv_ns);
+                EventWriter ev;
+                if (!m.event.empty()) ev.field("event", m.event);
+                if (!m.from.empty()) ev.field("from", m.from);
+                if (m.id) ev.field("id", m.id);
+                if (!m.mechanism.empty()) ev.field("mechanism", m.mechanism);
+                if (m.message_number) ev.field("message_number", m.message_number);
+                if (m.pid) ev.field("pid", m.pid);
+                ev.field("recv_ns", recv_ns);
+                if (rtt_us >= 0) ev.field("rtt_us", rtt_us).field("sent_ns", sent_ns);
+                if (!m.text.empty()) ev.field("text", m.text);
+                if (m.ts) ev.field("timestamp", m.ts);
+                ev.emit(true);
             }
-            catch (const std::exception& e) {
-                // DEBUG: Mostre o erro de parse
-                std::cerr << "DEBUG [CLIENT PARSE ERROR]: " << e.what() << " for: " << line << std::endl;
-
-                nlohmann::json ev = create_base_event("received");
-                ev["from"] = "socket_client";
-                ev["text"] = line;
-                std::cout << ev.dump() << std::endl;
+            else {
+                // DEBUG: Mostre o erro de decodificao
+                LOG_WARN("CLIENT DECODE ERROR", codec_name(codec_) << " for: " << line);
+
+                EventWriter()
+                    .field("event", "received")
+                    .field("from", "socket_client")
+                    .field("mechanism", mechanism_name())
+                    .field("recv_ns", recv_ns)
+                    .field("text", line)
+                    .ts()
+                    .emit(true);
             }
         }
     }
     closesocket(c);
     client_socket_ = INVALID_SOCKET;
     connected_.store(false);
-    std::cerr << "DEBUG [CLIENT]: Internal client disconnected" << std::endl;
+    LOG_DEBUG("CLIENT", "Internal client disconnected");
 }
 
-bool SocketModule::send(const std::string& message) {
-    if (!running_.load()) {
-        std::cerr << make_error_event("socket_send", "Not running") << std::endl;
-        return false;
-    }
+SOCKET SocketModule::connect_endpoint() const {
+    sockaddr_storage addr;
+    socklen_t addr_len = 0;
+    std::string err;
+    if (!endpoint_sockaddr(endpoint_, false, addr, addr_len, err)) return INVALID_SOCKET;
 
-    // Cria um socket temporrio para enviar a mensagem
-    SOCKET temp_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (temp_socket == INVALID_SOCKET) {
-        std::cerr << make_error_event("socket_send", "Failed to create temp socket: " + std::to_string(WSAGetLastError())) << std::endl;
-        return false;
+    SOCKET c = open_stream_socket(endpoint_);
+    if (c == INVALID_SOCKET) return INVALID_SOCKET;
+
+    if (connect(c, (sockaddr*)&addr, addr_len) == SOCKET_ERROR) {
+        closesocket(c);
+        return INVALID_SOCKET;
     }
 
-    sockaddr_in server_addr{};
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
-    server_addr.sin_port = htons(7070);
+    // linhas pequenas e pipelinadas: no segure no Nagle
+    if (!endpoint_.unix_domain) {
+        int nodelay = 1;
+        setsockopt(c, IPPROTO_TCP, TCP_NODELAY, (char*)&nodelay, sizeof(nodelay));
+    }
+    return c;
+}
 
-    std::cerr << "DEBUG [SEND]: Connecting to server..." << std::endl;
+// ---------------------- Pool remetente ----------------------
 
-    if (connect(temp_socket, (sockaddr*)&server_addr, sizeof(server_addr)) == SOCKET_ERROR) {
-        int error = WSAGetLastError();
-        std::cerr << make_error_event("socket_send", "Connect failed: " + std::to_string(error)) << std::endl;
-        closesocket(temp_socket);
+bool SocketModule::open_sender(SenderConn& c) {
+    SOCKET sock = connect_endpoint();
+    if (sock == INVALID_SOCKET) {
+        log_error("socket_send", "Connect failed: " + std::to_string(socket_last_error()));
         return false;
     }
 
-    std::cerr << "DEBUG [SEND]: Connected successfully, sending message..." << std::endl;
+    c.sock = sock;
+    c.written = 0;
+    {
+        std::lock_guard<std::mutex> lk(c.ack_mtx);
+        c.unacked.clear();
+        c.broken = false;
+    }
+    c.ack_thread = std::thread(&SocketModule::ack_reader, this, &c, sock);
+    LOG_DEBUG("SEND", "Sender connection opened");
+    return true;
+}
 
-    std::string payload = message;
-    if (payload.empty() || payload.back() != '\n') payload += '\n';
+size_t SocketModule::close_sender(SenderConn& c) {
+    if (c.sock != INVALID_SOCKET) {
+        shutdown(c.sock, SD_BOTH); // destrava o recv da thread de ACK
+        closesocket(c.sock);
+        c.sock = INVALID_SOCKET;
+    }
+    if (c.ack_thread.joinable()) c.ack_thread.join();
+
+    // Linhas sem ACK foram com a conexo: devolve as vagas delas na janela de pedidos
+    std::lock_guard<std::mutex> lk(c.ack_mtx);
+    const size_t lost = c.unacked.size();
+    for (uint64_t seq : c.unacked) inflight_.cancel(seq);
+    c.unacked.clear();
+    return lost;
+}
 
-    std::cerr << "DEBUG [SEND]: Sending to server: " << payload;
+void SocketModule::ack_reader(SenderConn* c, SOCKET s) {
+    // S conta os quadros de ACK; send() usa a contagem para limitar as mensagens em voo
+    FrameDecoder acks(framing_);
+    Frame f;
+    while (true) {
+        int n = recv(s, acks.prepare(1024), 1024, 0);
+        if (n <= 0) break;
+        acks.commit(n);
+        uint64_t lines = 0;
+        while (acks.next(f)) ++lines;
+        if (acks.corrupt()) break;
+        if (lines) {
+            std::lock_guard<std::mutex> lk(c->ack_mtx);
+            c->unacked.erase(c->unacked.begin(), c->unacked.begin() + std::min<size_t>(lines, c->unacked.size()));
+        }
+        c->ack_cv.notify_all();
+    }
+    {
+        std::lock_guard<std::mutex> lk(c->ack_mtx);
+        c->broken = true;
+    }
+    c->ack_cv.notify_all();
+}
 
-    int n = ::send(temp_socket, payload.c_str(), static_cast<int>(payload.size()), 0);
+SocketModule::WindowState SocketModule::wait_window(SenderConn& c) {
+    // Janela cheia: espera ACKs (no mximo 2 s) antes de escrever mais. Servidor lento no
+    // derruba a conexo: s a thread de ACK marca broken (recv falhou)
+    std::unique_lock<std::mutex> lk(c.ack_mtx);
+    c.ack_cv.wait_for(lk, std::chrono::seconds(2), [&] {
+        return c.broken || c.unacked.size() < window_;
+    });
+    if (c.broken) return WindowState::broken;
+    return c.unacked.size() < window_ ? WindowState::ready : WindowState::timeout;
+}
 
-    if (n == SOCKET_ERROR) {
-        std::cerr << make_error_event("socket_send", "send failed: " + std::to_string(WSAGetLastError())) << std::endl;
-        closesocket(temp_socket);
+bool SocketModule::send(const std::string& message, uint64_t id) {
+    if (!running_.load()) {
+        log_error("socket_send", "Not running");
         return false;
     }
 
-    std::cerr << "DEBUG [SEND]: Message sent successfully, waiting for server response..." << std::endl;
-
-    // AGUARDA A RESPOSTA DO SERVIDOR antes de fechar
-    char response_buf[1024];
-    int response_n = recv(temp_socket, response_buf, sizeof(response_buf), 0);
-    if (response_n > 0) {
-        std::string response(response_buf, response_n);
-        std::cerr << "DEBUG [SEND]: Server response: " << response;
+    // Vaga na janela de pedidos em voo; a resposta fecha o id no client_thread
+    uint64_t sent_ns = 0;
+    const uint64_t seq = inflight_.begin(id, &sent_ns);
+    if (seq == 0) {
+        log_error("socket_send", "in-flight window full (no echo in 5 s)");
+        return false;
     }
-    else if (response_n == 0) {
-        std::cerr << "DEBUG [SEND]: Server closed connection" << std::endl;
+
+    LOG_TRACE("SEND", "Sending to server: " << message);
+
+    // Round-robin no pool; a conexo fica aberta entre mensagens
+    SenderConn& c = *senders_[next_sender_.fetch_add(1, std::memory_order_relaxed) % senders_.size()];
+    std::lock_guard<std::mutex> lk(c.mtx);
+
+    // Codec json com framing binary: o texto vai como veio e o id no seq do quadro (o
+    // servidor aceita texto ou {"text": ...}); framing line no tem seq, o id vai no esquema
+    std::string body;
+    if (codec_ == CodecKind::binary || framing_ == FrameMode::line) {
+        Message m;
+        m.text = message;
+        m.id = seq;
+        MessageCodec(codec_).encode(m, body);
     }
-    else {
-        std::cerr << "DEBUG [SEND]: Error receiving response: " << WSAGetLastError() << std::endl;
+    std::string payload;
+    encode_frame(payload, framing_, FrameType::data, seq, body.empty() ? message : body);
+
+    // Conexo cada: reconecta de forma transparente e reenvia esta linha. Janela sem ACK
+    // por 2 s com a conexo viva: s este send() falha
+    bool ok = false;
+    for (int attempt = 0; attempt < 2 && !ok; ++attempt) {
+        if (c.sock == INVALID_SOCKET) {
+            if (attempt > 0 || c.written > 0) {
+                ++reconnects_;
+                counters_.reconnects.add();
+            }
+            if (!open_sender(c)) {
+                inflight_.cancel(seq);
+                return false;
+            }
+        }
+        const WindowState window = wait_window(c);
+        if (window == WindowState::timeout) {
+            inflight_.cancel(seq);
+            log_error("socket_send", "no ACK in 2 s (" + std::to_string(window_) + " lines in flight on the connection)");
+            return false;
+        }
+        if (window == WindowState::ready) {
+            {
+                // antes da escrita: o ACK desta linha pode chegar antes do send() voltar
+                std::lock_guard<std::mutex> ack(c.ack_mtx);
+                c.unacked.push_back(seq);
+            }
+            size_t off = 0;
+            while (off < payload.size()) {
+                int n = ::send(c.sock, payload.data() + off, static_cast<int>(payload.size() - off), SOCKET_SEND_FLAGS);
+                if (n == SOCKET_ERROR) break;
+                off += static_cast<size_t>(n);
+            }
+            ok = off == payload.size();
+            if (!ok) {
+                // esta linha no saiu inteira:  reenviada (ou cancelada) por aqui, no no close
+                std::lock_guard<std::mutex> ack(c.ack_mtx);
+                if (!c.unacked.empty() && c.unacked.back() == seq) c.unacked.pop_back();
+            }
+        }
+        if (ok) ++c.written;
+        else if (const size_t lost = close_sender(c))
+            log_error("socket_send", std::to_string(lost) + " unacknowledged line(s) lost with the connection");
     }
 
-    std::cerr << "DEBUG [SEND]: Closing connection..." << std::endl;
-    closesocket(temp_socket); // Fecha o socket temporrio
+    if (!ok) {
+        inflight_.cancel(seq);
+        log_error("socket_send", "send failed: " + std::to_string(socket_last_error()));
+        return false;
+    }
 
-    ++messages_sent_;
-    json ev = create_base_event("sent");
-    ev["bytes"] = n;
-    ev["text"] = message;
-    ev["message_number"] = messages_sent_;
-    std::cout << ev.dump() << std::endl;
+    const int number = ++messages_sent_;
+    counters_.messages_sent.add();
+    counters_.bytes_sent.add(payload.size());
+    EventWriter()
+        .field("bytes", payload.size())
+        .field("event", "sent")
+        .field("id", seq)
+        .field("mechanism", mechanism_name())
+        .field("message_number", number)
+        .field("sent_ns", sent_ns)
+        .field("text", message)
+        .ts()
+        .emit(true);
     return true;
 }
 
@@ -345,38 +733,51 @@ void SocketModule::stop() {
     running_.store(false);
     connected_.store(false);
 
-    // Feche o lado servidor do listener
-    {
-        std::lock_guard<std::mutex> lk(listener_mtx_);
-        if (listener_socket_ != INVALID_SOCKET) {
-            closesocket(listener_socket_);
-            listener_socket_ = INVALID_SOCKET;
-        }
+    // Feche o pool remetente (as threads de ACK saem com o recv falhando)
+    for (auto& c : senders_) {
+        std::lock_guard<std::mutex> lk(c->mtx);
+        close_sender(*c);
     }
 
-    // Feche o lado cliente interno
+    // Acorde o cliente interno (a thread dele fecha o socket)
     if (client_socket_ != INVALID_SOCKET) {
-        closesocket(client_socket_);
-        client_socket_ = INVALID_SOCKET;
+        shutdown(client_socket_, SD_BOTH);
     }
 
-    if (server_socket_ != INVALID_SOCKET) {
-        closesocket(server_socket_);
-        server_socket_ = INVALID_SOCKET;
+    // Os loops saem em at 100 ms e fecham os remetentes que ainda estiverem abertos
+    for (auto& t : loop_threads_) if (t.joinable()) t.join();
+    loop_threads_.clear();
+
+    // Feche o lado servidor do listener (depois dos loops: o dono o tinha no poller)
+    {
+        std::lock_guard<std::mutex> lk(listener_mtx_);
+        if (listener_socket_ != INVALID_SOCKET) {
+            socket_close(listener_socket_);
+            listener_socket_ = INVALID_SOCKET;
+        }
+        listener_out_.clear();
+        listener_pending_.store(false);
     }
+    for (SOCKET ls : listen_sockets_) closesocket(ls);
+    listen_sockets_.clear();
+    unlink_endpoint(endpoint_);
 
-    if (server_thread_.joinable()) server_thread_.join();
     if (client_thread_.joinable()) client_thread_.join();
 
-    WSACleanup();
-
-    auto ev = create_base_event("stopped");
-    ev["message"] = "Socket mechanism stopped";
-    ev["messages_sent"] = messages_sent_;
-    ev["messages_received"] = messages_received_;
-    ev["running"] = running_.load();
-    ev["connected"] = connected_.load();
-    std::cout << ev.dump() << std::endl;
+    socket_cleanup();
+
+    EventWriter()
+        .field("connected", connected_.load())
+        .field("event", "stopped")
+        .field("mechanism", mechanism_name())
+        .field("message", "Socket mechanism stopped")
+        .field("messages_received", messages_received_.load())
+        .field("messages_sent", messages_sent_.load())
+        .field("peers_accepted", peers_accepted_.load())
+        .field("reconnects", reconnects_.load())
+        .field("running", running_.load())
+        .ts()
+        .emit();
 }
 
 void SocketModule::cleanup() {
@@ -387,6 +788,10 @@ bool SocketModule::is_connected() const {
     return connected_.load();
 }
 
+std::string SocketModule::mechanism_name() const {
+    return unix_domain_.load() ? "socket_unix" : "socket";
+}
+
 bool SocketModule::is_running() const {
     return running_.load();
 }
@@ -397,27 +802,40 @@ std::string SocketModule::get_status() const {
     ss << (running_.load() ? "Running" : "Stopped");
     if (running_.load()) {
         ss << " | " << (connected_.load() ? "Connected" : "Waiting");
-        ss << " | Sent: " << messages_sent_;
-        ss << " | Received: " << messages_received_;
+        ss << " | Sent: " << messages_sent_.load();
+        ss << " | Received: " << messages_received_.load();
     }
     return ss.str();
 }
 
 nlohmann::json SocketModule::status() const {
     json status = create_base_event("status");
-    status["mechanism"] = "socket";
+    status["mechanism"] = mechanism_name();
     status["running"] = running_.load();
     status["connected"] = connected_.load();
-    status["messages_sent"] = messages_sent_;
-    status["messages_received"] = messages_received_;
+    status["messages_sent"] = messages_sent_.load();
+    status["messages_received"] = messages_received_.load();
+    status["connections"] = senders_.size();
+    status["transport"] = endpoint_.unix_domain ? "unix" : "tcp";
+    status["endpoint"] = endpoint_.describe();
+    status["framing"] = frame_mode_name(framing_);
+    status["codec"] = codec_name(codec_);
+    status["window"] = window_;
+    status["in_flight"] = inflight_.in_flight();
+    status["inflight_limit"] = inflight_.limit();
+    status["reconnects"] = reconnects_.load();
+    status["loop_threads"] = loop_threads_.size();
+    status["peers_open"] = peers_open_.load();
+    status["peers_accepted"] = peers_accepted_.load();
+    latency_.append_json(status);
     return status;
 }
 
 nlohmann::json SocketModule::create_base_event(const std::string& event_type) const {
     json event;
     event["event"] = event_type;
-    event["mechanism"] = "socket";
-    event["timestamp"] = std::time(nullptr);
+    event["mechanism"] = mechanism_name();
+    event["ts"] = iso_timestamp();
     return event;
 }
 
@@ -432,4 +850,9 @@ nlohmann::json SocketModule::make_error_event(const std::string& error_type, con
     event["error_type"] = error_type;
     event["message"] = message;
     return event;
+}
+
+void SocketModule::log_error(const std::string& error_type, const std::string& message) {
+    counters_.errors.add();
+    std::cerr << make_error_event(error_type, message) << std::endl;
 }
\ No newline at end of file
@@ -0,0 +1,250 @@
+#include "socket_platform.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/stat.h>
+#endif
+
+bool socket_startup(std::string& err) {
+#ifdef _WIN32
+    WSADATA wsaData;
+    int result = WSAStartup(MAKEWORD(2, 2), &wsaData);
+    if (result != 0) {
+        err = "WSAStartup failed: " + std::to_string(result);
+        return false;
+    }
+#else
+    (void)err;
+#endif
+    return true;
+}
+
+void socket_cleanup() {
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+int socket_last_error() {
+#ifdef _WIN32
+    return WSAGetLastError();
+#else
+    return errno;
+#endif
+}
+
+bool socket_would_block() {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+bool set_nonblocking(SOCKET s, bool on) {
+#ifdef _WIN32
+    u_long mode = on ? 1 : 0;
+    return ioctlsocket(s, FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(s, F_GETFL, 0);
+    if (flags < 0) return false;
+    flags = on ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+    return fcntl(s, F_SETFL, flags) == 0;
+#endif
+}
+
+bool socket_reuse_port(SOCKET s) {
+#ifdef SO_REUSEPORT
+    int enable = 1;
+    return setsockopt(s, SOL_SOCKET, SO_REUSEPORT, (char*)&enable, sizeof(enable)) == 0;
+#else
+    (void)s;
+    return false;
+#endif
+}
+
+void socket_close(SOCKET s) {
+    if (s == INVALID_SOCKET) return;
+    shutdown(s, SD_BOTH);
+    closesocket(s);
+}
+
+// ---------------------- Endereços ----------------------
+
+std::string SocketEndpoint::describe() const {
+    return unix_domain ? "unix:" + path : "port " + std::to_string(port);
+}
+
+std::string default_unix_socket_path() {
+#ifdef _WIN32
+    const char* tmp = std::getenv("TEMP");
+    return std::string(tmp ? tmp : ".") + "\\ra1_ipc.sock";
+#else
+    return "/tmp/ra1_ipc.sock";
+#endif
+}
+
+SOCKET open_stream_socket(const SocketEndpoint& ep) {
+    return ep.unix_domain ? socket(AF_UNIX, SOCK_STREAM, 0) : socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+}
+
+bool endpoint_sockaddr(const SocketEndpoint& ep, bool listening, sockaddr_storage& ss, socklen_t& len, std::string& err) {
+    std::memset(&ss, 0, sizeof(ss));
+    if (!ep.unix_domain) {
+        auto* in = reinterpret_cast<sockaddr_in*>(&ss);
+        in->sin_family = AF_INET;
+        in->sin_addr.s_addr = listening ? htonl(INADDR_ANY) : htonl(INADDR_LOOPBACK);
+        in->sin_port = htons(ep.port);
+        len = sizeof(sockaddr_in);
+        return true;
+    }
+
+    auto* un = reinterpret_cast<sockaddr_un*>(&ss);
+    un->sun_family = AF_UNIX;
+    if (ep.path.empty() || ep.path.size() >= sizeof(un->sun_path)) {
+        err = "invalid unix socket path: '" + ep.path + "'";
+        return false;
+    }
+    std::memcpy(un->sun_path, ep.path.data(), ep.path.size());
+    len = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + ep.path.size());
+    if (ep.path[0] == '@') {
+#ifdef _WIN32
+        err = "abstract unix socket paths are Linux-only";
+        return false;
+#else
+        un->sun_path[0] = '\0'; // namespace abstrato: sem terminador, comprimento exato
+#endif
+    }
+    else {
+        len += 1; // inclui o '\0'
+    }
+    return true;
+}
+
+void unlink_endpoint(const SocketEndpoint& ep) {
+    if (!ep.unix_domain || ep.path.empty() || ep.path[0] == '@') return;
+    // Só apaga um socket (resto de uma execução anterior): um "path" que aponte para um
+    // arquivo comum fica intacto e o bind falha em seguida
+#ifdef _WIN32
+    const DWORD attrs = GetFileAttributesA(ep.path.c_str());
+    if (attrs == INVALID_FILE_ATTRIBUTES || !(attrs & FILE_ATTRIBUTE_REPARSE_POINT)) return; // AF_UNIX: ponto de reparse
+#else
+    struct stat st;
+    if (lstat(ep.path.c_str(), &st) != 0 || !S_ISSOCK(st.st_mode)) return;
+#endif
+    std::remove(ep.path.c_str());
+}
+
+// ---------------------- Poller ----------------------
+
+#ifdef _WIN32
+
+bool SocketPoller::open(std::string&) {
+    fds_.clear();
+    return true;
+}
+
+void SocketPoller::close() {
+    fds_.clear();
+}
+
+bool SocketPoller::add(SOCKET s, bool want_write) {
+    WSAPOLLFD p{};
+    p.fd = s;
+    p.events = POLLRDNORM | (want_write ? POLLWRNORM : 0);
+    fds_.push_back(p);
+    return true;
+}
+
+bool SocketPoller::modify(SOCKET s, bool want_write) {
+    for (auto& p : fds_) {
+        if (p.fd == s) {
+            p.events = POLLRDNORM | (want_write ? POLLWRNORM : 0);
+            return true;
+        }
+    }
+    return false;
+}
+
+void SocketPoller::remove(SOCKET s) {
+    fds_.erase(std::remove_if(fds_.begin(), fds_.end(), [s](const WSAPOLLFD& p) { return p.fd == s; }), fds_.end());
+}
+
+int SocketPoller::wait(std::vector<PollEvent>& out, int timeout_ms) {
+    out.clear();
+    if (fds_.empty()) {
+        Sleep(timeout_ms);
+        return 0;
+    }
+    int n = WSAPoll(fds_.data(), static_cast<ULONG>(fds_.size()), timeout_ms);
+    if (n == SOCKET_ERROR) return -1;
+    for (const auto& p : fds_) {
+        if (!p.revents) continue;
+        out.push_back({ p.fd,
+                        (p.revents & (POLLRDNORM | POLLHUP | POLLERR)) != 0,
+                        (p.revents & POLLWRNORM) != 0,
+                        (p.revents & (POLLHUP | POLLERR)) != 0 });
+    }
+    return static_cast<int>(out.size());
+}
+
+#else
+
+bool SocketPoller::open(std::string& err) {
+    close();
+    epfd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd_ < 0) {
+        err = "epoll_create1 failed: " + std::to_string(errno);
+        return false;
+    }
+    events_.resize(256);
+    return true;
+}
+
+void SocketPoller::close() {
+    if (epfd_ >= 0) ::close(epfd_);
+    epfd_ = -1;
+}
+
+bool SocketPoller::add(SOCKET s, bool want_write) {
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLRDHUP | (want_write ? uint32_t(EPOLLOUT) : 0u);
+    ev.data.fd = s;
+    return epoll_ctl(epfd_, EPOLL_CTL_ADD, s, &ev) == 0;
+}
+
+bool SocketPoller::modify(SOCKET s, bool want_write) {
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLRDHUP | (want_write ? uint32_t(EPOLLOUT) : 0u);
+    ev.data.fd = s;
+    return epoll_ctl(epfd_, EPOLL_CTL_MOD, s, &ev) == 0;
+}
+
+void SocketPoller::remove(SOCKET s) {
+    epoll_ctl(epfd_, EPOLL_CTL_DEL, s, nullptr);
+}
+
+int SocketPoller::wait(std::vector<PollEvent>& out, int timeout_ms) {
+    out.clear();
+    int n = epoll_wait(epfd_, events_.data(), static_cast<int>(events_.size()), timeout_ms);
+    if (n < 0) return errno == EINTR ? 0 : -1;
+    for (int i = 0; i < n; ++i) {
+        const uint32_t e = events_[i].events;
+        out.push_back({ events_[i].data.fd,
+                        (e & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0,
+                        (e & EPOLLOUT) != 0,
+                        (e & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0 });
+    }
+    // lote cheio: dobra para a próxima espera (milhares de conexões ativas)
+    if (n == static_cast<int>(events_.size()) && events_.size() < 8192) events_.resize(events_.size() * 2);
+    return n;
+}
+
+#endif
@@ -0,0 +1,65 @@
+// Eco de mensagens grandes pelo PipeModule no codec binary: acima do splice_min o pai
+// escreve por vmsplice e o pipe_child lê o texto de stdin (read, que copia) antes de
+// devolvê-lo em stdout. Várias mensagens distintas seguidas precisam voltar byte a byte
+// (send() só devolve cada buffer depois de o filho ter lido tudo).
+#include "test_support.hpp"
+#include "ipc_manager.hpp" // run_child_process: o PipeModule relança este executável
+#include "pipe_module.hpp"
+
+namespace {
+
+using nlohmann::json;
+
+// Conteúdo distinto por mensagem e por posição: um pedaço de outra mensagem (ou de outro
+// trecho da mesma) trocado no caminho aparece na comparação
+std::string make_text(size_t bytes, int k) {
+    std::string text(bytes, '\0');
+    for (size_t i = 0; i < bytes; ++i)
+        text[i] = static_cast<char>('A' + (k * 7 + i / 4096 * 3 + i) % 26);
+    return text;
+}
+
+void large_echoes(StdoutCapture& out, const json& extra, const char* label, uint64_t first_id) {
+    PipeModule pipe(nullptr);
+    json opts = extra;
+    opts["codec"] = "binary";
+    CHECK(pipe.start(opts), "start %s", label);
+    CHECK(pipe.status_json().value("splice_min", size_t(0)) > 0, "vmsplice ativo (%s)", label);
+
+    const int count = 3;
+    const size_t bytes = 8 * 1024 * 1024;
+    std::vector<std::string> texts;
+    for (int k = 0; k < count; ++k) {
+        texts.push_back(make_text(bytes, k));
+        CHECK(pipe.send(texts.back(), "", first_id + k), "send %d (%s)", k, label);
+    }
+    CHECK(wait_completed(pipe.inflight(), count, 30000), "%d ecos em 30 s (%s)", count, label);
+    pipe.stop();
+
+    const auto events = out.events();
+    for (int k = 0; k < count; ++k) {
+        const json* r = nullptr;
+        for (const auto& e : events)
+            if (e.value("event", "") == "received" && e.value("id", uint64_t(0)) == first_id + k) r = &e;
+        CHECK(r != nullptr, "received id=%llu (%s)", static_cast<unsigned long long>(first_id + k), label);
+        if (!r) continue;
+        const std::string got = r->value("text", "");
+        const std::string want = "ECHO: " + texts[k];
+        size_t diff = 0;
+        while (diff < got.size() && diff < want.size() && got[diff] == want[diff]) ++diff;
+        CHECK(got == want, "eco %d (%s): %zu bytes, esperado %zu, primeira diferença em %zu",
+              k, label, got.size(), want.size(), diff);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (const int rc = IPCManager::run_child_process(argc, argv); rc >= 0) return rc;
+
+    StdoutCapture out;
+    large_echoes(out, json::object(), "splice_min padrão", 101);
+    large_echoes(out, { { "pipe_bytes", 64 * 1024 }, { "splice_min", 64 * 1024 } }, "pipe de 64 KiB", 201);
+    std::fprintf(stderr, "pipe_splice_echo_test: %s\n", g_test_failures ? "FALHOU" : "ok");
+    return g_test_failures ? 1 : 0;
+}
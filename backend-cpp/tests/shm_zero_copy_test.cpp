@@ -0,0 +1,97 @@
+// reserve()/commit() do SharedMemoryModule: o payload escrito direto no anel P→C volta
+// intacto pelo eco, que o lê emprestado do anel (ShmRecordView), nos dois codecs; o
+// commit emite o "sent" como o send() e recusa mais bytes que o reservado; e a vaga da
+// janela é tomada no reserve() (id de correlação no eco, reserva abandonada devolve a vaga).
+#include "test_support.hpp"
+#include "message_codec.hpp"
+#include "shared_memory_module.hpp"
+#include <cstring>
+
+namespace {
+
+using nlohmann::json;
+
+const json* find_event(const std::vector<json>& events, const char* name, uint64_t id) {
+    for (const auto& e : events)
+        if (e.value("event", "") == name && e.value("id", uint64_t(0)) == id) return &e;
+    return nullptr;
+}
+
+// Escreve 'payload' (já no codec da sessão) via reserve/commit com a correlação 'id'
+bool send_zero_copy(SharedMemoryModule& shm, std::string_view payload, uint64_t id, size_t slack) {
+    std::span<char> dst = shm.reserve(payload.size() + slack, id);
+    if (dst.size() != payload.size() + slack) return false;
+    std::memcpy(dst.data(), payload.data(), payload.size());
+    if (slack > 0 && shm.commit(dst.size() + 1)) return false; // acima do reservado: recusado
+    return shm.commit(payload.size());
+}
+
+void round_trip(StdoutCapture& out, const char* codec_name) {
+    SharedMemoryModule shm(nullptr);
+    json opts;
+    opts["codec"] = codec_name;
+    CHECK(shm.start(opts), "start %s", codec_name);
+    InflightWindow& win = shm.inflight();
+
+    // Conteúdo distinto por posição; abaixo do corte do "text" dos eventos (64 KiB)
+    std::string text(48 * 1024, '\0');
+    for (size_t i = 0; i < text.size(); ++i) text[i] = static_cast<char>('a' + (i * 7 + i / 251) % 26);
+
+    std::string payload = text;
+    if (shm.codec() == CodecKind::binary) {
+        Message m;
+        m.text = text;
+        payload.clear();
+        MessageCodec(CodecKind::binary).encode(m, payload);
+    }
+
+    const uint64_t id = 4242;
+    CHECK(send_zero_copy(shm, payload, id, 32), "reserve/commit %s", codec_name);
+    CHECK(wait_completed(win, 1, 5000), "eco de %s em 5 s", codec_name);
+
+    const auto events = out.events();
+    const json* s = find_event(events, "sent", id);
+    CHECK(s != nullptr && s->value("text", "") == text, "sent id=%llu com o texto (%s)",
+          static_cast<unsigned long long>(id), codec_name);
+    const json* r = find_event(events, "received", id);
+    CHECK(r != nullptr, "received id=%llu (%s)", static_cast<unsigned long long>(id), codec_name);
+    if (r) {
+        const std::string got = r->value("text", "");
+        CHECK(got == "ECHO: " + text, "texto do eco (%s): %zu bytes, esperado %zu",
+              codec_name, got.size(), text.size() + 6);
+        CHECK(r->contains("rtt_us"), "rtt_us no eco (%s)", codec_name);
+    }
+    shm.stop();
+}
+
+void window_slot(StdoutCapture&) {
+    SharedMemoryModule shm(nullptr);
+    json opts;
+    opts["inflight"] = 1;
+    CHECK(shm.start(opts), "start inflight=1");
+
+    // Reserva abandonada: o reserve() seguinte devolve a vaga dela em vez de esperar 5 s
+    CHECK(!shm.reserve(16).empty(), "primeira reserva");
+    const uint64_t t0 = mono_ns();
+    std::span<char> dst = shm.reserve(16);
+    CHECK(!dst.empty() && mono_ns() - t0 < 1'000'000'000ull, "segunda reserva sem esperar a janela");
+    CHECK(shm.inflight().in_flight() == 1, "uma vaga em uso: %zu", shm.inflight().in_flight());
+    if (!dst.empty()) {
+        std::memcpy(dst.data(), "0123456789abcdef", 16);
+        CHECK(shm.commit(16), "commit");
+        CHECK(wait_completed(shm.inflight(), 1, 5000), "eco com inflight=1");
+    }
+    CHECK(!shm.commit(16), "commit sem reserva aberta");
+    shm.stop();
+}
+
+} // namespace
+
+int main() {
+    StdoutCapture out;
+    round_trip(out, "json");
+    round_trip(out, "binary");
+    window_slot(out);
+    std::fprintf(stderr, "shm_zero_copy_test: %s\n", g_test_failures ? "FALHOU" : "ok");
+    return g_test_failures ? 1 : 0;
+}
@@ -0,0 +1,89 @@
+#pragma once
+// Apoio dos testes nativos (ctest): os módulos falam pelo stdout (EventSink), então o
+// teste redireciona o stdout do processo para um arquivo temporário e relê os eventos.
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "event_sink.hpp"
+#include "inflight_window.hpp"
+#include "shm_platform.hpp" // current_pid
+#include "timestamp.hpp"
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+inline int g_test_failures = 0;
+
+// Falha não aborta: o teste segue e o main devolve != 0 no fim
+#define CHECK(cond, ...)                                                        \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            ++g_test_failures;                                                  \
+            std::fprintf(stderr, "FALHOU %s:%d: %s ", __FILE__, __LINE__, #cond); \
+            std::fprintf(stderr, __VA_ARGS__);                                  \
+            std::fprintf(stderr, "\n");                                         \
+        }                                                                       \
+    } while (0)
+
+// Espera a janela do módulo fechar 'target' pedidos (ecos com o id de volta); false = timeout
+inline bool wait_completed(InflightWindow& win, uint64_t target, uint64_t timeout_ms) {
+    const uint64_t t0 = mono_ns();
+    while (win.completed() < target) {
+        if (mono_ns() - t0 > timeout_ms * 1'000'000ull) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+// Criar antes do primeiro evento (a thread escritora do EventSink usa o stdout do momento)
+class StdoutCapture {
+public:
+    StdoutCapture() {
+        path_ = std::filesystem::temp_directory_path() /
+                ("ra1_test_" + std::to_string(current_pid()) + ".jsonl");
+        std::fflush(stdout);
+#ifdef _WIN32
+        file_ = std::fopen(path_.string().c_str(), "wb");
+        if (file_) SetStdHandle(STD_OUTPUT_HANDLE, reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(file_))));
+#else
+        const int fd = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (fd >= 0) {
+            ::dup2(fd, STDOUT_FILENO);
+            ::close(fd);
+        }
+#endif
+    }
+    ~StdoutCapture() {
+        EventSink::instance().flush();
+        std::error_code ec;
+        std::filesystem::remove(path_, ec);
+    }
+
+    // Tudo que chegou ao stdout até agora, um evento JSON por linha
+    std::vector<nlohmann::json> events() const {
+        EventSink::instance().flush(10000);
+        std::vector<nlohmann::json> out;
+        std::ifstream in(path_, std::ios::binary);
+        std::string line;
+        while (std::getline(in, line)) {
+            auto j = nlohmann::json::parse(line, nullptr, false);
+            if (!j.is_discarded()) out.push_back(std::move(j));
+        }
+        return out;
+    }
+
+private:
+    std::filesystem::path path_;
+#ifdef _WIN32
+    FILE* file_{ nullptr };
+#endif
+};
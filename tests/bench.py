@@ -4,6 +4,7 @@ from pathlib import Path
 # Configura caminho relativo
 BASE_DIR = Path(__file__).resolve().parent.parent
 DEFAULT_EXE = BASE_DIR / "backend-cpp" / "build" / "bin" / "Release" / "ra1_ipc_backend.exe"
+DEFAULT_BENCH_EXE = DEFAULT_EXE.with_name("ra1_ipc_bench.exe")
 
 def spawn(exe, verbose):
     if verbose: print(f"[spawn] abrindo {exe}", flush=True)
@@ -61,7 +62,7 @@ def wait_for(q, pred, timeout, verbose, label):
         print(f"[timeout] {label} ({timeout}s)", flush=True)
     return None
 
-def bench_one(exe, mech, warmup, n, start_timeout, recv_timeout, verbose):
+def bench_one(exe, mech, warmup, n, start_opts, start_timeout, recv_timeout, verbose, log_level=None):
     proc = spawn(exe, verbose)
     q = queue.Queue()
     
@@ -69,15 +70,19 @@ def bench_one(exe, mech, warmup, n, start_timeout, recv_timeout, verbose):
     threading.Thread(target=reader, args=(proc, q, verbose), daemon=True).start()
     threading.Thread(target=stderr_reader, args=(proc, verbose), daemon=True).start()
 
+    # Nível do log de diagnóstico (stderr); só vale para o que o binário compilou
+    if log_level:
+        send(proc, {"cmd":"log_level","level":log_level}, verbose)
+
     # START
-    send(proc, {"cmd":"start","mechanism":mech}, verbose)
+    send(proc, dict({"cmd":"start","mechanism":mech}, **start_opts), verbose)
     
     # Espera pelo evento started com mechanism correto
     ev = wait_for(q, lambda e: e.get("event")=="started" and e.get("mechanism")==mech, 
                  start_timeout, verbose, f"{mech} started")
     
     if not ev:
-        if mech == "socket":
+        if mech.startswith("socket"):
             # Fallback para socket (pode ter listener_registered primeiro)
             ev = wait_for(q, lambda e: e.get("event")=="socket_listener_registered", 
                          start_timeout, verbose, "socket_listener_registered")
@@ -96,6 +101,7 @@ def bench_one(exe, mech, warmup, n, start_timeout, recv_timeout, verbose):
     # MEDIÇÃO
     if verbose: print(f"[measure] {mech} x{n}", flush=True)
     lats = []
+    rtts = []  # RTT medido no backend (sent_ns/recv_ns monotônicos), sem o stdin/stdout do Python
     for i in range(n):
         t0 = time.perf_counter()
         send(proc, {"cmd":"send","text":f"m{i}"}, verbose)
@@ -103,6 +109,8 @@ def bench_one(exe, mech, warmup, n, start_timeout, recv_timeout, verbose):
                      recv_timeout, verbose, "receive")
         if ev:
             lats.append((time.perf_counter()-t0)*1000.0)  # ms
+            if "rtt_us" in ev:
+                rtts.append(ev["rtt_us"])
 
     # STOP
     send(proc, {"cmd":"stop"}, verbose)
@@ -115,8 +123,124 @@ def bench_one(exe, mech, warmup, n, start_timeout, recv_timeout, verbose):
     p95 = lats_sorted[max(0, int(len(lats_sorted)*0.95)-1)]
     avg = statistics.mean(lats)
     thr = 1000.0/avg if avg > 0 else 0
-    return {"mechanism":mech, "n":len(lats), "lat_avg_ms":round(avg, 3), 
-            "lat_p95_ms":round(p95, 3), "throughput_msg_s":round(thr, 3)}
+    row = {"mechanism":mech, "n":len(lats), "lat_avg_ms":round(avg, 3), 
+           "lat_p95_ms":round(p95, 3), "throughput_msg_s":round(thr, 3)}
+    if rtts:
+        rtts.sort()
+        row.update({"rtt_avg_us":round(statistics.mean(rtts), 1),
+                    "rtt_p95_us":rtts[max(0, int(len(rtts)*0.95)-1)]})
+    return row
+
+def bench_burst(exe, mech, n, start_opts, start_timeout, recv_timeout, verbose):
+    """Rajada: n comandos send sem esperar o eco (pipelining); mede msg/s até o último received.
+    O RTT de cada pedido vem do backend ("rtt_us", casado pelo id de correlação)."""
+    proc = spawn(exe, False)
+    q = queue.Queue()
+    threading.Thread(target=reader, args=(proc, q, verbose), daemon=True).start()
+    threading.Thread(target=stderr_reader, args=(proc, verbose), daemon=True).start()
+
+    send(proc, dict({"cmd":"start","mechanism":mech}, **start_opts), verbose)
+    ready = "socket_listener_registered" if mech.startswith("socket") else "started"
+    ev = wait_for(q, lambda e: e.get("event")==ready and e.get("mechanism")==mech,
+                  start_timeout, verbose, f"{mech} {ready}")
+    row = {"mechanism":mech, "n":n, "elapsed_ms":0, "throughput_msg_s":0}
+    if not ev:
+        cleanup(proc, verbose)
+        return row
+
+    t0 = time.perf_counter()
+    for i in range(n):
+        send(proc, {"cmd":"send","text":f"b{i}"}, False)
+    got = 0
+    rtts = []
+    while got < n:
+        ev = wait_for(q, lambda e: e.get("event")=="received" and e.get("mechanism")==mech,
+                      recv_timeout, verbose, "burst receive")
+        if not ev:
+            break
+        got += 1
+        if "rtt_us" in ev:
+            rtts.append(ev["rtt_us"])
+    dt = time.perf_counter() - t0
+
+    send(proc, {"cmd":"stop"}, verbose)
+    cleanup(proc, verbose)
+    if got:
+        row.update({"n":got, "elapsed_ms":round(dt*1000.0, 3), "throughput_msg_s":round(got/dt, 3)})
+    if rtts:
+        rtts.sort()
+        row.update({"rtt_avg_us":round(statistics.mean(rtts), 1),
+                    "rtt_p95_us":rtts[max(0, int(len(rtts)*0.95)-1)]})
+    return row
+
+def bench_large(exe, mech, sizes_mb, start_opts, start_timeout, recv_timeout, verbose):
+    """Mensagens grandes (MB): mede o tempo de ida e volta e o throughput de payload"""
+    proc = spawn(exe, False)
+    q = queue.Queue()
+    threading.Thread(target=reader, args=(proc, q, verbose), daemon=True).start()
+    threading.Thread(target=stderr_reader, args=(proc, verbose), daemon=True).start()
+
+    send(proc, dict({"cmd":"start","mechanism":mech}, **start_opts), verbose)
+    ev = wait_for(q, lambda e: e.get("event")=="started" and e.get("mechanism")==mech,
+                  start_timeout, verbose, f"{mech} started")
+    rows = []
+    if not ev:
+        cleanup(proc, verbose)
+        return rows
+
+    for mb in sizes_mb:
+        size = int(mb * 1024 * 1024)
+        text = "x" * size
+        t0 = time.perf_counter()
+        send(proc, {"cmd":"send","text":text}, False)
+        # eventos de payload grande trazem "bytes" (texto cortado); o eco tem o prefixo "ECHO: "
+        ev = wait_for(q, lambda e: e.get("event")=="received" and e.get("mechanism")==mech
+                      and e.get("bytes", 0) >= size, recv_timeout + mb, verbose, f"receive {mb}MB")
+        dt = time.perf_counter() - t0
+        if ev:
+            rows.append({"mechanism":mech, "size_mb":mb, "rtt_ms":round(dt*1000.0, 3),
+                         "throughput_mb_s":round(mb/dt, 3)})
+        else:
+            rows.append({"mechanism":mech, "size_mb":mb, "rtt_ms":0, "throughput_mb_s":0})
+        print(json.dumps(rows[-1]), flush=True)
+
+    send(proc, {"cmd":"stop"}, verbose)
+    cleanup(proc, verbose)
+    return rows
+
+def bench_hub(exe, clients_list, start_opts, start_timeout, recv_timeout, verbose):
+    """Hub shm: N processos cliente simultâneos; agrega os client_done (o hub devolve o slot em seguida)"""
+    rows = []
+    for n in clients_list:
+        proc = spawn(exe, False)
+        q = queue.Queue()
+        threading.Thread(target=reader, args=(proc, q, verbose), daemon=True).start()
+        threading.Thread(target=stderr_reader, args=(proc, verbose), daemon=True).start()
+
+        # clientes rápidos terminam antes do "started": os client_done contam nas duas esperas
+        cl = []
+        def hub_event(name):
+            def pred(e):
+                if e.get("event") == "client_done":
+                    cl.append(e)
+                return e.get("event") == name and e.get("mechanism") == "shm_hub"
+            return pred
+
+        send(proc, dict({"cmd":"start","mechanism":"shm_hub","clients":n}, **start_opts), verbose)
+        ok = wait_for(q, hub_event("started"), start_timeout, verbose, "shm_hub started")
+        done = ok and wait_for(q, hub_event("hub_done"), recv_timeout + n, verbose, "hub_done")
+        send(proc, {"cmd":"stop"}, verbose)
+        cleanup(proc, verbose)
+
+        if not done or not cl:
+            rows.append({"clients":n, "requests":0, "throughput_msg_s":0, "avg_rtt_us":0, "max_rtt_us":0})
+        else:
+            rows.append({"clients":n, "requests":sum(c["requests"] for c in cl),
+                         "throughput_msg_s":round(sum(c["throughput_msg_s"] for c in cl), 1),
+                         "avg_rtt_us":round(statistics.mean(c["avg_rtt_us"] for c in cl), 3),
+                         "max_rtt_us":round(max(c["max_rtt_us"] for c in cl), 3)})
+        print(json.dumps(rows[-1]), flush=True)
+    return rows
 
 def cleanup(proc, verbose):
     try:
@@ -139,6 +263,33 @@ def main():
     ap.add_argument("--start-timeout", type=float, default=5.0)
     ap.add_argument("--recv-timeout", type=float, default=3.0)
     ap.add_argument("--verbose", action="store_true")
+    ap.add_argument("--burst", action="store_true", help="rajada de sends sem esperar o eco (pipelining)")
+    ap.add_argument("--connections", type=int, default=1, help="conexões persistentes do socket em --burst")
+    ap.add_argument("--unix-path", default=None, help="caminho do socket_unix ('@nome' = abstrato no Linux)")
+    ap.add_argument("--no-unix", action="store_true", help="não compara socket_unix com o socket TCP")
+    ap.add_argument("--framing", choices=["line", "binary"], default="line", help="enquadramento de pipe/socket")
+    ap.add_argument("--codec", choices=["json", "binary"], default="json", help="codec das mensagens entre os lados do IPC")
+    ap.add_argument("--batch-bytes", type=int, default=0, help="pipe: coalesce escritas até N bytes (0 = desligado)")
+    ap.add_argument("--batch-us", type=int, default=200, help="pipe: prazo máximo de uma mensagem no lote (us)")
+    ap.add_argument("--workers", type=int, default=1, help="pipe: processos filhos no pool")
+    ap.add_argument("--dispatch", choices=["round_robin", "least_outstanding", "hash"], default="round_robin",
+                    help="pipe: como o send escolhe o filho")
+    ap.add_argument("--work-us", type=int, default=0, help="pipe: custo de CPU simulado por mensagem no filho (us)")
+    ap.add_argument("--inflight", type=int, default=0, help="pedidos sem eco antes do send esperar (0 = sem limite)")
+    ap.add_argument("--log-level", default=None, help="nível do log de diagnóstico do backend (trace..off)")
+    ap.add_argument("--log-compare", action="store_true", help="RTT com o log de diagnóstico desligado x em trace")
+    ap.add_argument("--large", action="store_true", help="mede mensagens grandes (1..64 MB) via shm")
+    ap.add_argument("--large-mb", default="1,4,16,64", help="tamanhos em MB para --large")
+    ap.add_argument("--hub", action="store_true", help="escala de clientes simultâneos no hub shm")
+    ap.add_argument("--hub-clients", default="1,4,16,64", help="quantidades de clientes para --hub")
+    ap.add_argument("--hub-threads", type=int, default=2, help="threads servidoras do hub")
+    ap.add_argument("--sweep", action="store_true",
+                    help="grade tamanho x pedidos em voo x produtores no ra1_ipc_bench (results/native_sweep.csv)")
+    ap.add_argument("--bench-exe", default=str(DEFAULT_BENCH_EXE), help="caminho do ra1_ipc_bench.exe para --sweep")
+    ap.add_argument("--sweep-sizes", default=None, help="tamanhos em bytes (padrão 16 a 16777216, x4)")
+    ap.add_argument("--sweep-depths", default=None, help="pedidos em voo (padrão 1,4,16,64,256)")
+    ap.add_argument("--sweep-producers", default=None, help="threads produtoras (padrão 1,2,4)")
+    ap.add_argument("--sweep-cell", type=float, default=0.5, help="segundos por célula da grade")
     args = ap.parse_args()
 
     exe = os.path.normpath(args.exe)
@@ -152,23 +303,111 @@ def main():
     results_dir = BASE_DIR / "tests" / "results"
     os.makedirs(results_dir, exist_ok=True)
 
+    # socket_unix = mesmo módulo de socket sobre AF_UNIX, lado a lado com o TCP
+    mechs = ["pipe", "socket"] + ([] if args.no_unix else ["socket_unix"]) + ["shm"]
+    def start_opts(mech):
+        opts = {"framing":args.framing, "codec":args.codec, "inflight":args.inflight}
+        if mech == "socket_unix" and args.unix_path:
+            opts["path"] = args.unix_path
+        if mech == "pipe" and args.batch_bytes > 0:
+            opts.update(batch_bytes=args.batch_bytes, batch_us=args.batch_us)
+        if mech == "pipe":
+            opts.update(workers=args.workers, dispatch=args.dispatch, work_us=args.work_us)
+        return opts
+
     rows = []
     # Testa apenas mecanismos implementados
-    for mech in ["pipe", "socket"]:  # Removido "shm" até implementar
+    for mech in mechs:
         print(f"--- {mech.upper()} ---", flush=True)
-        res = bench_one(exe, mech, args.warmup, args.n, args.start_timeout, args.recv_timeout, args.verbose)
+        res = bench_one(exe, mech, args.warmup, args.n, start_opts(mech),
+                        args.start_timeout, args.recv_timeout, args.verbose, args.log_level)
         rows.append(res)
         print(json.dumps(res, indent=2), flush=True)
         print("", flush=True)
 
     out_csv = results_dir / "results.csv"
     with open(out_csv, "w", newline="", encoding="utf-8") as f:
-        w = csv.DictWriter(f, fieldnames=rows[0].keys())
+        # união das colunas: linhas sem eco não têm rtt_*, as com falha têm note
+        w = csv.DictWriter(f, fieldnames=list(dict.fromkeys(k for r in rows for k in r)))
         w.writeheader()
         w.writerows(rows)
     
     print(f"\n[ok] CSV salvo em: {out_csv}", flush=True)
+
+    if args.burst:
+        burst_rows = []
+        for mech in mechs:
+            print(f"--- {mech.upper()} (rajada) ---", flush=True)
+            opts = dict(start_opts(mech), connections=args.connections) if mech.startswith("socket") else start_opts(mech)
+            res = bench_burst(exe, mech, args.n, opts, args.start_timeout, args.recv_timeout, args.verbose)
+            burst_rows.append(res)
+            print(json.dumps(res), flush=True)
+        out_burst = results_dir / "burst.csv"
+        with open(out_burst, "w", newline="", encoding="utf-8") as f:
+            w = csv.DictWriter(f, fieldnames=list(dict.fromkeys(k for r in burst_rows for k in r)))
+            w.writeheader()
+            w.writerows(burst_rows)
+        print(f"[ok] CSV salvo em: {out_burst}", flush=True)
+
+    if args.log_compare:
+        # Mesmo binário, log desligado x ligado em tempo de execução. Num build Release o
+        # trace/debug já foi compilado fora: as duas colunas devem ficar iguais.
+        log_rows = []
+        for mech in mechs:
+            print(f"--- {mech.upper()} (log off x trace) ---", flush=True)
+            row = {"mechanism":mech}
+            for level in ("off", "trace"):
+                res = bench_one(exe, mech, args.warmup, args.n, start_opts(mech),
+                                args.start_timeout, args.recv_timeout, False, level)
+                row[f"lat_avg_ms_{level}"] = res["lat_avg_ms"]
+                row[f"lat_p95_ms_{level}"] = res["lat_p95_ms"]
+            log_rows.append(row)
+            print(json.dumps(row), flush=True)
+        out_log = results_dir / "logging.csv"
+        with open(out_log, "w", newline="", encoding="utf-8") as f:
+            w = csv.DictWriter(f, fieldnames=log_rows[0].keys())
+            w.writeheader()
+            w.writerows(log_rows)
+        print(f"[ok] CSV salvo em: {out_log}", flush=True)
+
+    if args.large:
+        print("--- SHM (mensagens grandes, processo filho) ---", flush=True)
+        sizes = [float(x) for x in args.large_mb.split(",") if x]
+        large_rows = bench_large(exe, "shm", sizes, {"mode":"process", "codec":args.codec},
+                                 args.start_timeout, args.recv_timeout, args.verbose)
+        if large_rows:
+            out_large = results_dir / "large_messages.csv"
+            with open(out_large, "w", newline="", encoding="utf-8") as f:
+                w = csv.DictWriter(f, fieldnames=large_rows[0].keys())
+                w.writeheader()
+                w.writerows(large_rows)
+            print(f"[ok] CSV salvo em: {out_large}", flush=True)
+
+    if args.hub:
+        print("--- SHM HUB (clientes simultâneos) ---", flush=True)
+        counts = [int(x) for x in args.hub_clients.split(",") if x]
+        hub_rows = bench_hub(exe, counts, {"threads":args.hub_threads, "messages":args.n},
+                             args.start_timeout, args.recv_timeout, args.verbose)
+        out_hub = results_dir / "hub_clients.csv"
+        with open(out_hub, "w", newline="", encoding="utf-8") as f:
+            w = csv.DictWriter(f, fieldnames=hub_rows[0].keys())
+            w.writeheader()
+            w.writerows(hub_rows)
+        print(f"[ok] CSV salvo em: {out_hub}", flush=True)
     
+    if args.sweep:
+        print("--- SWEEP (ra1_ipc_bench) ---", flush=True)
+        cmd = [os.path.normpath(args.bench_exe), "--mode", "sweep", "--mech", ",".join(mechs),
+               "--duration", str(args.sweep_cell), "--out", str(results_dir / "native"),
+               "--opts", json.dumps({"framing":args.framing, "codec":args.codec})]
+        for flag, val in (("--sizes", args.sweep_sizes), ("--depths", args.sweep_depths),
+                          ("--producers", args.sweep_producers)):
+            if val: cmd += [flag, val]
+        # eventos dos módulos no stdout (descartados); uma linha JSON por célula no stderr
+        rc = subprocess.run(cmd, stdout=subprocess.DEVNULL).returncode
+        print(f"[ok] CSV salvo em: {results_dir / 'native_sweep.csv'} (plot: python plot.py results/native_sweep.csv)"
+              if rc == 0 else f"[erro] ra1_ipc_bench saiu com {rc}", flush=True)
+
     # Exibe resumo
     print("\n=== RESUMO ===")
     for row in rows:
@@ -1,19 +1,65 @@
-﻿import csv, matplotlib.pyplot as plt
+﻿import csv, sys, pathlib, matplotlib.pyplot as plt
+
+# uso: python plot.py [csv]  (padrão results/results.csv do bench.py; ex.: results/native.csv
+# do ra1_ipc_bench). Outro CSV gera os PNGs com o nome dele como prefixo, na mesma pasta.
+# O <out>_sweep.csv do ra1_ipc_bench --mode sweep vira curvas por mecanismo (tamanho, pedidos
+# em voo, produtores) e a tabela do mais rápido por tamanho, com os cruzamentos marcados.
+src=pathlib.Path(sys.argv[1] if len(sys.argv) > 1 else "results/results.csv")
+prefix="" if src.stem == "results" else src.stem + "_"
 
 rows=[]
-with open("results/results.csv", encoding="utf-8") as f:
+with open(src, encoding="utf-8") as f:
     rows=list(csv.DictReader(f))
 
+def curves(x, y, where, title, name, logy=False):
+    """Uma curva por mecanismo (y em função de x) com as outras dimensões fixas em 'where'"""
+    sel=[r for r in rows if all(int(r[k]) == v for k, v in where.items())]
+    if not sel: return
+    plt.figure()
+    for mech in sorted({r["mechanism"] for r in sel}):
+        pts=sorted((int(r[x]), float(r[y])) for r in sel if r["mechanism"] == mech)
+        plt.plot([p[0] for p in pts], [p[1] for p in pts], marker="o", label=mech.upper())
+    plt.xscale("log", base=2)
+    if logy: plt.yscale("log")
+    fixed=", ".join(f"{k}={v}" for k, v in where.items())
+    plt.title(f"{title} ({fixed})"); plt.xlabel(x); plt.ylabel(y); plt.legend()
+    plt.savefig(src.parent / f"{prefix}{name}.png", bbox_inches="tight")
+
+if "producers" in rows[0]:
+    # sweep do ra1_ipc_bench (<out>_sweep.csv): onde as curvas se cruzam, muda o melhor mecanismo
+    axis=lambda k: sorted({int(r[k]) for r in rows})
+    sizes, depths, prods=axis("size"), axis("inflight"), axis("producers")
+    d0, d1, p0, p1, s0=depths[0], depths[-1], prods[0], prods[-1], sizes[0]
+    curves("size", "throughput_mb_s", {"inflight":d0, "producers":p0}, "Vazão (MB/s) x tamanho", "mb_s_by_size")
+    curves("size", "throughput_mb_s", {"inflight":d1, "producers":p0}, "Vazão (MB/s) x tamanho", "mb_s_by_size_deep")
+    curves("size", "lat_p99_us", {"inflight":d0, "producers":p0}, "Latência p99 (us) x tamanho", "p99_by_size", logy=True)
+    curves("size", "cpu_us_msg", {"inflight":d0, "producers":p0}, "CPU por mensagem (us) x tamanho", "cpu_by_size", logy=True)
+    curves("inflight", "throughput_msg_s", {"size":s0, "producers":p0}, "Vazão (msg/s) x pedidos em voo", "msg_s_by_inflight")
+    curves("inflight", "lat_p99_us", {"size":s0, "producers":p0}, "Latência p99 (us) x pedidos em voo", "p99_by_inflight", logy=True)
+    curves("producers", "throughput_msg_s", {"size":s0, "inflight":d1}, "Vazão (msg/s) x produtores", "msg_s_by_producers")
+
+    # cruzamentos: o mecanismo mais rápido por tamanho, marcando quando ele troca
+    best_prev=None
+    for size in sizes:
+        cell=[r for r in rows if int(r["size"]) == size and int(r["inflight"]) == d0 and int(r["producers"]) == p0]
+        if not cell: continue
+        best=max(cell, key=lambda r: float(r["throughput_mb_s"]))["mechanism"]
+        low=min(cell, key=lambda r: float(r["lat_p99_us"]) or float("inf"))["mechanism"]
+        mark=" <- cruzamento" if best_prev and best != best_prev else ""
+        print(f"{size:>9} B  vazão: {best:<12} p99: {low}{mark}")
+        best_prev=best
+    sys.exit(0)
+
 mechs=[r["mechanism"].upper() for r in rows]
 lat_avg=[float(r["lat_avg_ms"]) for r in rows]
 lat_p95=[float(r["lat_p95_ms"]) for r in rows]
 thr=[float(r["throughput_msg_s"]) for r in rows]
 
 plt.figure(); plt.bar(mechs, lat_avg); plt.title("Latência média (ms)"); plt.ylabel("ms")
-plt.savefig("results/latency_avg.png", bbox_inches="tight")
+plt.savefig(src.parent / f"{prefix}latency_avg.png", bbox_inches="tight")
 
 plt.figure(); plt.bar(mechs, lat_p95); plt.title("Latência p95 (ms)"); plt.ylabel("ms")
-plt.savefig("results/latency_p95.png", bbox_inches="tight")
+plt.savefig(src.parent / f"{prefix}latency_p95.png", bbox_inches="tight")
 
 plt.figure(); plt.bar(mechs, thr); plt.title("Throughput (msg/s)"); plt.ylabel("msg/s")
-plt.savefig("results/throughput.png", bbox_inches="tight")
+plt.savefig(src.parent / f"{prefix}throughput.png", bbox_inches="tight")